@@ -0,0 +1,146 @@
+// Accept and read latency of a running server under many connections: all
+// clients connect at once, each times its connect + startup (until the first
+// ReadyForQuery) and then its "SELECT 1" round trips. Run it against postduck
+// with --reactors 1 and with --reactors N [--reuse-port] to compare.
+//
+//   cmake -DPOSTDUCK_BUILD_BENCH=ON .. && make connect_bench
+//   ./connect_bench [host] [port] [connections] [queries] [client threads]
+#include <utility> // before asio: its awaitable.hpp uses std::exchange
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <boost/asio.hpp>
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+struct Samples
+{
+    std::vector<double> startup_us;
+    std::vector<double> query_us;
+    std::atomic<size_t> failed{0};
+};
+
+// Reads backend messages up to and including ReadyForQuery
+static asio::awaitable<void> read_until_ready(tcp::socket &sock)
+{
+    char head[5];
+    std::vector<char> body;
+    for (;;)
+    {
+        co_await asio::async_read(sock, asio::buffer(head, 5), asio::use_awaitable);
+        uint32_t len;
+        std::memcpy(&len, head + 1, 4);
+        len = ntohl(len);
+        if (len < 4) throw std::runtime_error("bad message length");
+        body.resize(len - 4);
+        co_await asio::async_read(sock, asio::buffer(body), asio::use_awaitable);
+        if (head[0] == 'E') throw std::runtime_error("server reported an error");
+        if (head[0] == 'Z') co_return;
+    }
+}
+
+static std::vector<char> startup_packet(const std::string &user, const std::string &db)
+{
+    std::vector<char> out(8);
+    uint32_t proto = htonl(196608);
+    std::memcpy(out.data() + 4, &proto, 4);
+    for (const std::string &s : {std::string("user"), user, std::string("database"), db})
+        out.insert(out.end(), s.c_str(), s.c_str() + s.size() + 1);
+    out.push_back('\0');
+    uint32_t len = htonl(static_cast<uint32_t>(out.size()));
+    std::memcpy(out.data(), &len, 4);
+    return out;
+}
+
+static asio::awaitable<void> client(tcp::endpoint ep, int queries, std::vector<double> &startup,
+                                    std::vector<double> &rtt, Samples &samples)
+{
+    static const char select1[] = "Q\0\0\0\x0dSELECT 1\0";
+    try
+    {
+        auto exec = co_await asio::this_coro::executor;
+        tcp::socket sock(exec);
+        auto t0 = Clock::now();
+        co_await sock.async_connect(ep, asio::use_awaitable);
+        sock.set_option(tcp::no_delay(true));
+        auto packet = startup_packet("postduck", "bench");
+        co_await asio::async_write(sock, asio::buffer(packet), asio::use_awaitable);
+        co_await read_until_ready(sock);
+        startup.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        for (int i = 0; i < queries; i++)
+        {
+            auto q0 = Clock::now();
+            co_await asio::async_write(sock, asio::buffer(select1, sizeof(select1) - 1), asio::use_awaitable);
+            co_await read_until_ready(sock);
+            rtt.push_back(std::chrono::duration<double, std::micro>(Clock::now() - q0).count());
+        }
+        static const char terminate[] = "X\0\0\0\x04";
+        co_await asio::async_write(sock, asio::buffer(terminate, sizeof(terminate) - 1), asio::use_awaitable);
+    }
+    catch (std::exception &)
+    {
+        samples.failed++;
+    }
+}
+
+static void report(const char *what, std::vector<double> &v)
+{
+    if (v.empty())
+    {
+        std::printf("%-10s no samples\n", what);
+        return;
+    }
+    std::sort(v.begin(), v.end());
+    auto at = [&](double q) { return v[std::min(v.size() - 1, static_cast<size_t>(q * v.size()))]; };
+    std::printf("%-10s n=%-8zu p50 %9.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us\n", what, v.size(),
+                at(0.5), at(0.99), at(0.999), v.back());
+}
+
+int main(int argc, char **argv)
+{
+    std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    unsigned short port = static_cast<unsigned short>(argc > 2 ? std::atoi(argv[2]) : 5432);
+    int connections = argc > 3 ? std::atoi(argv[3]) : 1000;
+    int queries = argc > 4 ? std::atoi(argv[4]) : 100;
+    int threads = argc > 5 ? std::atoi(argv[5]) : 4;
+
+    tcp::endpoint ep(asio::ip::make_address(host), port);
+    Samples samples;
+    // One io_context and sample buffer per client thread; merged at the end
+    std::vector<std::unique_ptr<asio::io_context>> ctxs;
+    std::vector<std::vector<double>> startup(threads), rtt(threads);
+    for (int t = 0; t < threads; t++) ctxs.emplace_back(new asio::io_context(1));
+    for (int c = 0; c < connections; c++)
+        asio::co_spawn(*ctxs[c % threads], client(ep, queries, startup[c % threads], rtt[c % threads], samples),
+                       asio::detached);
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) workers.emplace_back([&, t]() { ctxs[t]->run(); });
+    for (auto &w : workers) w.join();
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    for (int t = 0; t < threads; t++)
+    {
+        samples.startup_us.insert(samples.startup_us.end(), startup[t].begin(), startup[t].end());
+        samples.query_us.insert(samples.query_us.end(), rtt[t].begin(), rtt[t].end());
+    }
+    std::printf("%d connections x %d queries to %s:%u, %d client threads, %.2f s\n", connections, queries,
+                host.c_str(), port, threads, secs);
+    report("startup", samples.startup_us);
+    report("SELECT 1", samples.query_us);
+    std::printf("%.0f queries/s, %zu connections failed\n", samples.query_us.size() / secs, samples.failed.load());
+    return samples.failed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// Per-statement cost of rewrite_statement() for the statement shapes that
+// reach it: bootstrap queries, command forms, JDBC catalog queries and a
+// large generated INSERT that passes through untouched.
+//
+//   cmake -DPOSTDUCK_BUILD_BENCH=ON .. && make rewrite_bench && ./rewrite_bench
+#include "query_rewriter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static std::string generated_insert(size_t bytes)
+{
+    std::string sql = "INSERT INTO pgbench_history (tid, bid, aid, delta, mtime) VALUES ";
+    for (int i = 0; sql.size() < bytes; i++)
+    {
+        if (i > 0) sql += ", ";
+        sql += "(" + std::to_string(i % 10) + ", 1, " + std::to_string(i) + ", -42, '2024-01-01 00:00:00')";
+    }
+    return sql + ";";
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    std::vector<std::pair<const char *, std::string>> cases = {
+        {"select version()", "SELECT version();"},
+        {"show transaction_isolation", "SHOW transaction_isolation"},
+        {"set extra_float_digits", "SET extra_float_digits = 3"},
+        {"begin isolation level", "BEGIN ISOLATION LEVEL READ COMMITTED"},
+        {"drop table a, b, c", "DROP TABLE IF EXISTS pgbench_accounts, pgbench_branches, pgbench_history"},
+        {"point select", "SELECT abalance FROM pgbench_accounts WHERE aid = 4711"},
+        {"jdbc getTables",
+         "SELECT NULL AS TABLE_CAT, n.nspname AS TABLE_SCHEM, c.relname AS TABLE_NAME, "
+         "CASE n.nspname ~ '^pg_' OR n.nspname = 'information_schema' WHEN true THEN 'SYSTEM TABLE' END "
+         "AS TABLE_TYPE, d.description AS REMARKS FROM pg_catalog.pg_namespace n, pg_catalog.pg_class c "
+         "LEFT JOIN pg_catalog.pg_description d ON (c.oid = d.objoid AND d.objsubid = 0) "
+         "WHERE c.relnamespace = n.oid ORDER BY TABLE_TYPE,TABLE_SCHEM,TABLE_NAME"},
+        {"insert 50 KB", generated_insert(50 * 1024)},
+    };
+    std::printf("%-28s %12s %10s\n", "statement", "bytes", "ns/stmt");
+    for (auto &c : cases)
+    {
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++)
+        {
+            Rewrite r = rewrite_statement(c.second);
+            sink += r.sql.size() + r.end;
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::printf("%-28s %12zu %10.1f%s\n", c.first, c.second.size(), elapsed.count() / iterations,
+                    sink == 0 ? " (?)" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <duckdb.hpp>
+
+// A pooled DuckDB connection and the catalog it was last switched to
+struct PooledConnection
+{
+    std::shared_ptr<duckdb::Connection> conn;
+    std::string database;       // empty: none yet
+    // A borrower ran SET / USE / PRAGMA on it; release() replaces it
+    bool settings_changed = false;
+};
+
+// Transaction pooling (--pool-size): a bounded set of DuckDB connections
+// shared by all sessions. A session borrows one for a transaction, or for a
+// single statement in autocommit, and gives it back at ReadyForQuery. When
+// none is free the session is queued and handed the next one released, in
+// arrival order; nobody blocks a worker thread while waiting.
+class ConnectionPool
+{
+public:
+    struct Stats
+    {
+        size_t size = 0;        // upper bound
+        size_t open = 0;        // connections created so far
+        size_t idle = 0;
+        size_t waiting = 0;     // sessions queued for a connection
+        uint64_t acquires = 0;
+        uint64_t waits = 0;     // acquires that had to queue
+    };
+    using Ready = std::function<void(std::shared_ptr<PooledConnection>)>;
+
+    ConnectionPool(duckdb::DuckDB &db, size_t size);
+
+    // Calls ready with a connection: right away if one is idle (or may still
+    // be opened), otherwise from release() on the releasing thread.
+    void acquire(Ready ready);
+    // The connection must be back in autocommit mode. One whose settings
+    // were changed is replaced by a new connection, so that no borrower sees
+    // what another one set.
+    void release(std::shared_ptr<PooledConnection> conn);
+    // Runs a statement that applies to the whole database instance (ATTACH)
+    // on a connection of the pool's own; returns the error, empty on success.
+    std::string execute(const std::string &sql);
+    Stats stats();
+
+private:
+    duckdb::DuckDB &db_;
+    std::mutex mtx_;
+    std::vector<std::shared_ptr<PooledConnection>> idle_;
+    std::deque<Ready> waiters_;
+    Stats stats_;
+    std::mutex admin_mtx_;
+    std::unique_ptr<duckdb::Connection> admin_;
+};
+
+#endif // CONNECTION_POOL_HPP
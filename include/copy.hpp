@@ -0,0 +1,120 @@
+#ifndef COPY_HPP
+#define COPY_HPP
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <duckdb.hpp>
+
+#include "pg_codec.hpp"
+
+// Error raised while parsing or loading COPY data, with the SQLSTATE to report.
+struct CopyError : public std::runtime_error
+{
+    std::string sqlstate;
+    CopyError(const std::string &msg, const char *state) : std::runtime_error(msg), sqlstate(state) {}
+};
+
+// COPY ... FROM STDIN / TO STDOUT, as written by the client.
+struct CopyStatement
+{
+    enum Format { TEXT, CSV, BINARY };
+    bool from_stdin = false;        // else TO STDOUT
+    std::string schema;             // unquoted; empty = default schema
+    std::string table;              // unquoted; empty for COPY (query) TO
+    std::vector<std::string> columns;
+    std::string query;              // COPY (query) TO STDOUT
+    Format format = TEXT;
+    char delimiter = '\t';
+    std::string null_str = "\\N";
+    bool header = false;
+    char quote = '"';
+    char escape = '"';
+
+    // Quoted, schema-qualified table name for use in generated SQL
+    std::string qualified_table() const;
+};
+
+// Returns true and fills out when sql is a COPY to or from the client;
+// COPY from/to a server-side file returns false and is left to DuckDB.
+// Throws CopyError for malformed statements.
+bool parse_copy_statement(const std::string &sql, CopyStatement &out);
+
+std::string quote_ident(const std::string &name);
+
+// Incremental COPY FROM STDIN loader. CopyData payloads are split into rows
+// as they arrive (rows may straddle frames), decoded column-wise into a
+// VARCHAR chunk, cast to the table types once per chunk and appended with
+// a duckdb::Appender, so the input is never held in memory as a whole.
+// Runs inside its own transaction unless one is already open.
+class CopyInLoader
+{
+public:
+    CopyInLoader(duckdb::Connection &con, const CopyStatement &stmt);
+    ~CopyInLoader();
+
+    idx_t column_count() const { return types_.size(); }
+    const CopyStatement &statement() const { return stmt_; }
+    void feed(const char *data, size_t len);
+    // End of input: loads the remainder and commits; returns the row count.
+    idx_t finish();
+    // Discards everything loaded so far.
+    void abort();
+
+private:
+    size_t consume(const char *data, size_t len);
+    size_t find_row_end(const char *p, size_t n) const;
+    void handle_row(const char *p, size_t n);
+    void parse_text_row(const char *p, size_t n, idx_t row);
+    void parse_csv_row(const char *p, size_t n, idx_t row);
+    void set_field(idx_t col, idx_t row, const char *p, size_t n);
+    void flush_chunk();
+    CopyError row_error(const std::string &msg) const;
+
+    duckdb::Connection &con_;
+    CopyStatement stmt_;
+    duckdb::vector<duckdb::LogicalType> types_;
+    std::vector<std::string> names_;
+    std::string staging_;           // temp table used when loading a column subset
+    duckdb::unique_ptr<duckdb::Appender> appender_;
+    duckdb::DataChunk raw_;         // one VARCHAR column per target column
+    duckdb::DataChunk typed_;
+    std::string pending_;           // incomplete trailing row of the last frame
+    std::string scratch_;           // de-escaped field
+    std::string bytes_;             // hex-decoded bytea field
+    idx_t rows_ = 0;
+    idx_t line_ = 0;
+    bool own_txn_ = false;
+    bool skip_header_ = false;
+    bool end_marker_ = false;       // saw "\." terminator
+    bool finished_ = false;
+};
+
+// COPY TO STDOUT encoder: each result chunk becomes a single CopyData
+// message in text, CSV or PGCOPY binary format, reusing the DataRow cell
+// encoders of the matching wire format.
+class CopyOutEncoder
+{
+public:
+    CopyOutEncoder(const CopyStatement &stmt, const duckdb::vector<duckdb::LogicalType> &types,
+                   const std::vector<std::string> &names);
+
+    // Overall format of the CopyOutResponse: 0 text, 1 binary
+    int16_t wire_format() const { return stmt_.format == CopyStatement::BINARY ? 1 : 0; }
+    size_t column_count() const { return encoders_.size(); }
+    // Binary file header or CSV header line, if any
+    void begin(std::vector<char> &out);
+    void encode_chunk(std::vector<char> &out, duckdb::DataChunk &chunk);
+    // Binary file trailer, if any
+    void end(std::vector<char> &out);
+
+private:
+    void text_field(std::vector<char> &out, size_t start);
+    void csv_field(std::vector<char> &out, size_t start, bool only_column);
+
+    CopyStatement stmt_;
+    std::vector<std::string> names_;
+    std::vector<PGColumnEncoder> encoders_;
+    std::vector<char> scratch_;     // raw cell bytes while escaping
+};
+
+#endif // COPY_HPP
@@ -13,6 +13,9 @@ public:
     std::shared_ptr<duckdb::Connection> get_connection() {
         return std::make_shared<duckdb::Connection>(*db);
     }
+    duckdb::DuckDB &instance() {
+        return *db;
+    }
 private:
     duckdb::DuckDB* db = nullptr;
 };
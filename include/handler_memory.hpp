@@ -0,0 +1,91 @@
+#ifndef HANDLER_MEMORY_HPP
+#define HANDLER_MEMORY_HPP
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Memory for one asio completion handler at a time, owned by a session so
+// that the handler of an operation it starts over and over (the next write,
+// the next batch for its strand) reuses the same bytes instead of going to
+// the heap. A handler that does not fit, or arrives while the block is
+// taken, falls back to operator new.
+class HandlerMemory
+{
+public:
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory &) = delete;
+    HandlerMemory &operator=(const HandlerMemory &) = delete;
+
+    void *allocate(std::size_t size)
+    {
+        if (size <= sizeof(storage_) && !in_use_.exchange(true, std::memory_order_acquire))
+            return &storage_;
+        return ::operator new(size);
+    }
+
+    void deallocate(void *p)
+    {
+        if (p == &storage_)
+            in_use_.store(false, std::memory_order_release);
+        else
+            ::operator delete(p);
+    }
+
+private:
+    typename std::aligned_storage<1024>::type storage_;
+    std::atomic<bool> in_use_{false};
+};
+
+// Allocator handing out a HandlerMemory; the associated allocator of the
+// handlers wrapped by bind_memory()
+template <typename T>
+class HandlerAllocator
+{
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory &mem) : memory_(mem) {}
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U> &other) noexcept : memory_(other.memory_) {}
+
+    bool operator==(const HandlerAllocator &other) const noexcept { return &memory_ == &other.memory_; }
+    bool operator!=(const HandlerAllocator &other) const noexcept { return &memory_ != &other.memory_; }
+
+    T *allocate(std::size_t n) const { return static_cast<T *>(memory_.allocate(sizeof(T) * n)); }
+    void deallocate(T *p, std::size_t) const { memory_.deallocate(p); }
+
+private:
+    template <typename>
+    friend class HandlerAllocator;
+    HandlerMemory &memory_;
+};
+
+template <typename Handler>
+class MemoryBoundHandler
+{
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    MemoryBoundHandler(HandlerMemory &mem, Handler handler) : memory_(mem), handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(memory_); }
+
+    template <typename... Args>
+    void operator()(Args &&...args) { handler_(std::forward<Args>(args)...); }
+
+private:
+    HandlerMemory &memory_;
+    Handler handler_;
+};
+
+// The handler, with its operation's memory taken from mem. mem must
+// outlive the operation (handlers keep their session alive).
+template <typename Handler>
+MemoryBoundHandler<typename std::decay<Handler>::type> bind_memory(HandlerMemory &mem, Handler &&handler)
+{
+    return MemoryBoundHandler<typename std::decay<Handler>::type>(mem, std::forward<Handler>(handler));
+}
+
+#endif // HANDLER_MEMORY_HPP
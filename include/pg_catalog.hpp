@@ -0,0 +1,73 @@
+#ifndef PG_CATALOG_HPP
+#define PG_CATALOG_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <duckdb.hpp>
+
+// Materialized copy of DuckDB's pg_catalog views (pg_namespace, pg_class,
+// pg_attribute, pg_type, pg_index, pg_proc) in an attached in-memory
+// database. Sessions put it ahead of the views on their search_path, so
+// metadata queries from drivers and BI tools read plain tables instead of
+// recomputing the views from duckdb_tables() & co. on every call. The
+// tables a DDL statement can change are copied again once its transaction
+// has ended; until then the session that ran it reads the views, which show
+// its own uncommitted changes. Disabled (sessions use the views) until
+// enabled.
+class CatalogMirror
+{
+public:
+    // The catalog tables, as bits of a refresh mask
+    enum Table : unsigned
+    {
+        PG_NAMESPACE = 1,
+        PG_CLASS = 2,
+        PG_ATTRIBUTE = 4,
+        PG_TYPE = 8,
+        PG_INDEX = 16,
+        PG_PROC = 32,
+        ALL_TABLES = 63,
+    };
+
+    // Attaches the mirror and fills it; false (and stays disabled) when
+    // DuckDB refuses
+    bool enable(duckdb::DuckDB &db);
+    bool enabled() const { return admin_ != nullptr; }
+
+    // SET search_path statement for a session using database db: db's main
+    // schema first, for its own tables and as the default for new ones,
+    // then the mirror (unless mirror is false: pg_catalog is DuckDB's views)
+    std::string search_path_sql(const std::string &db, bool mirror = true) const;
+    // Copies the given tables again and returns once a copy that started
+    // after the call has finished. Concurrent calls share copies.
+    void refresh(unsigned tables);
+    // Refreshes everything the first time a database is seen attached
+    void note_database(const std::string &db);
+
+    // Tables a statement of this type and text may change (ALL_TABLES when
+    // the text does not tell). Temporary objects, which other connections do
+    // not see, change none; temporary is set for them.
+    static unsigned tables_changed_by(duckdb::StatementType type, const std::string &sql, bool &temporary);
+
+    static const char *database_name;
+
+private:
+    void copy_tables(unsigned tables);
+
+    std::unique_ptr<duckdb::Connection> admin_;
+    std::mutex refresh_mtx_;
+    std::condition_variable refreshed_;
+    unsigned pending_ = 0;                  // tables waiting to be copied
+    bool copying_ = false;
+    uint64_t copies_started_ = 0;
+    uint64_t copies_finished_ = 0;
+    std::mutex databases_mtx_;
+    std::unordered_set<std::string> databases_;
+};
+
+CatalogMirror &catalog_mirror();
+
+#endif // PG_CATALOG_HPP
@@ -0,0 +1,160 @@
+#ifndef PG_CODEC_HPP
+#define PG_CODEC_HPP
+#include <arpa/inet.h>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <duckdb.hpp>
+
+// DuckDB LogicalType -> PG type OID, and the matching pg_type.typlen
+uint32_t pg_type_oid(const duckdb::LogicalType &lt);
+int16_t pg_type_len(uint32_t oid);
+uint32_t pg_array_oid(uint32_t elem_oid);
+
+// --- writing primitives ---
+static inline void append_u8(std::vector<char> &buf, uint8_t v)
+{
+    buf.push_back(static_cast<char>(v));
+}
+static inline void append_u16(std::vector<char> &buf, uint16_t v)
+{
+    uint16_t n = htons(v);
+    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 2);
+}
+static inline void append_i16(std::vector<char> &buf, int16_t v)
+{
+    uint16_t n = htons(static_cast<uint16_t>(v));
+    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 2);
+}
+static inline void append_u32(std::vector<char> &buf, uint32_t v)
+{
+    uint32_t n = htonl(v);
+    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 4);
+}
+static inline void append_i32(std::vector<char> &buf, int32_t v)
+{
+    uint32_t n = htonl(static_cast<uint32_t>(v));
+    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 4);
+}
+static inline void append_u64(std::vector<char> &buf, uint64_t v)
+{
+    append_u32(buf, static_cast<uint32_t>(v >> 32));
+    append_u32(buf, static_cast<uint32_t>(v & 0xFFFFFFFFULL));
+}
+static inline void append_bytes(std::vector<char> &buf, const char *data, size_t len)
+{
+    buf.insert(buf.end(), data, data + len);
+}
+static inline void append_cstr(std::vector<char> &buf, const std::string &s)
+{
+    buf.insert(buf.end(), s.begin(), s.end());
+    buf.push_back('\0');
+}
+// Overwrite a previously reserved int32 (e.g. a length placeholder) at pos.
+static inline void patch_i32(std::vector<char> &buf, size_t pos, int32_t v)
+{
+    uint32_t n = htonl(static_cast<uint32_t>(v));
+    std::memcpy(buf.data() + pos, &n, 4);
+}
+// Start a backend message: type byte + length placeholder. Returns the
+// position of the length field, to be handed to end_message().
+static inline size_t begin_message(std::vector<char> &buf, char type)
+{
+    buf.push_back(type);
+    size_t len_pos = buf.size();
+    buf.insert(buf.end(), 4, 0);
+    return len_pos;
+}
+static inline void end_message(std::vector<char> &buf, size_t len_pos)
+{
+    patch_i32(buf, len_pos, static_cast<int32_t>(buf.size() - len_pos));
+}
+// A backend message without a body (ParseComplete, NoData, ...)
+static inline void append_empty_message(std::vector<char> &buf, char type)
+{
+    static const char len[4] = {0, 0, 0, 4};
+    buf.push_back(type);
+    buf.insert(buf.end(), len, len + 4);
+}
+
+// --- DataRow encoding ---
+// Per-chunk view of one result column, prepared once per chunk by
+// encode_data_rows() and handed to the column's writer for every row.
+struct PGColumn;
+
+// Appends the wire bytes of one non-NULL cell (without the length prefix).
+// idx is the physical index into the column's unified format.
+typedef void (*pg_value_writer)(std::vector<char> &out, const PGColumn &col, idx_t idx);
+
+// Type-specialised encoder for one result column, chosen once per result.
+struct PGColumnEncoder
+{
+    int16_t format = 0;           // 0 = text, 1 = binary
+    int32_t fixed_len = -1;       // wire length when constant, -1 = variable
+    bool cast_to_text = false;    // writer consumes a VARCHAR rendering of the vector
+    pg_value_writer write = nullptr;
+    int scale = 0;                // DECIMAL scale for binary numeric
+    // Lists/arrays: element type OID and encoder, fixed ARRAY length
+    uint32_t elem_oid = 0;
+    idx_t array_size = 0;
+    std::shared_ptr<PGColumnEncoder> element;
+};
+
+// Pick encoders for a result; formats are the Bind result-format codes
+// (empty = all text, one entry = applies to all columns, else per column).
+std::vector<PGColumnEncoder> make_column_encoders(const duckdb::vector<duckdb::LogicalType> &types,
+                                                  const std::vector<int16_t> &formats);
+
+// Append one DataRow message per row in [begin, end) of chunk.
+void encode_data_rows(std::vector<char> &out, duckdb::DataChunk &chunk,
+                      const std::vector<PGColumnEncoder> &encoders, idx_t begin, idx_t end);
+
+// Cell-level access for framings other than DataRow (COPY): the chunk's
+// columns are resolved once, then cells are written one at a time.
+class PGChunkCells
+{
+public:
+    PGChunkCells(duckdb::DataChunk &chunk, const std::vector<PGColumnEncoder> &encoders);
+    ~PGChunkCells();
+    // Appends the wire bytes of a cell (no length prefix); false if NULL.
+    bool write(std::vector<char> &out, idx_t col, idx_t row) const;
+
+private:
+    std::unique_ptr<PGColumn[]> cols_;
+};
+
+// --- Bind parameter decoding ---
+// PG type OID -> DuckDB type (INVALID if unknown); element OID of an array OID (0 if none)
+duckdb::LogicalType pg_oid_to_type(uint32_t oid);
+uint32_t pg_array_elem_oid(uint32_t array_oid);
+
+struct PGParamDecoder;
+
+// Decodes one non-NULL parameter straight out of the Bind message body.
+typedef duckdb::Value (*pg_param_reader)(const char *data, int32_t len, const PGParamDecoder &dec);
+
+// How to turn one parameter's wire bytes into the Value the statement expects.
+// Resolved once per (statement, parameter, format) and cached on the statement.
+struct PGParamDecoder
+{
+    pg_param_reader read = nullptr;
+    duckdb::LogicalType target;   // expected DuckDB type (INVALID = let DuckDB decide)
+    bool cast = false;            // reader output still needs a cast to target
+    std::shared_ptr<PGParamDecoder> element; // array element decoder
+};
+
+PGParamDecoder make_param_decoder(uint32_t type_oid, int16_t format, const duckdb::LogicalType &expected);
+
+// A parameter value that does not convert to the type the statement
+// expects; reported as SQLSTATE 22P02.
+struct ParamError : public std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+// len < 0 is SQL NULL; throws ParamError
+duckdb::Value decode_param(const PGParamDecoder &dec, const char *data, int32_t len);
+
+#endif // PG_CODEC_HPP
@@ -0,0 +1,84 @@
+#ifndef QUERY_REWRITER_HPP
+#define QUERY_REWRITER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rewrites applied to SQL from clients before DuckDB sees it: answers to
+// JDBC / psql bootstrap queries, PostgreSQL-only commands turned into
+// no-ops, and statement forms DuckDB lacks (multi-table DROP / TRUNCATE).
+//
+// A statement is looked at in one pass over its leading tokens, so the cost
+// does not grow with the size of e.g. a generated INSERT. Bootstrap queries
+// are found in a hash table of their exact text, command forms in a trie of
+// their leading keywords; rewrites that need to search the whole text (the
+// JDBC catalog queries) are memoized.
+enum class RewriteRule
+{
+    KEEP,                   // run the statement as it is
+    REPLACE,                // run Rewrite::sql instead
+    // SHOW commands answered from server state; the session builds the SQL
+    SHOW_RESULT_CACHE,
+    SHOW_STATEMENT_CACHE,
+    SHOW_WORKLOAD_CLASSES,
+    SHOW_CONNECTION_POOL,
+};
+
+// A one-row, one-column result known without running the statement:
+// connection-pool validation and driver bootstrap queries
+struct ConstantAnswer
+{
+    size_t index;           // in constant_answers()
+    const char *column;
+    uint32_t type_oid;      // PostgreSQL type of the column
+    const char *value;      // in text format
+};
+
+struct Rewrite
+{
+    RewriteRule rule = RewriteRule::KEEP;
+    std::string sql;        // REPLACE: the statement to run
+    // The statement without surrounding whitespace is [begin, end) of the
+    // input (begin == end: empty)
+    size_t begin = 0;
+    size_t end = 0;
+    // Result of the statement, when it is a constant
+    const ConstantAnswer *answer = nullptr;
+};
+
+Rewrite rewrite_statement(const std::string &query);
+const std::vector<ConstantAnswer> &constant_answers();
+
+// Tokens of SQL text: words lower-cased, quoted strings and identifiers as
+// they are, and the punctuation = , ; ( ) . one character each. Whitespace
+// and comments are skipped.
+class SqlLexer
+{
+public:
+    // Reads [p, end) or s in place: the text must outlive the lexer
+    SqlLexer(const char *p, const char *end) : p_(p), end_(end) {}
+    explicit SqlLexer(const std::string &s) : SqlLexer(s.data(), s.data() + s.size()) {}
+
+    // The next token into tok; false at the end of the text
+    bool next(std::string &tok);
+    // Just past the last token read
+    const char *pos() const { return p_; }
+
+private:
+    static bool is_punct(char c)
+    {
+        return c == '=' || c == ',' || c == ';' || c == '(' || c == ')' || c == '.';
+    }
+    void skip_space();
+
+    const char *p_;
+    const char *end_;
+};
+
+// 1 for BEGIN / START TRANSACTION, 2 for COMMIT / END, 3 for ROLLBACK /
+// ABORT (not to a savepoint), 0 for anything else including several
+// statements
+int transaction_kind(const std::string &sql);
+
+#endif // QUERY_REWRITER_HPP
@@ -0,0 +1,78 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Server-wide cache of encoded SELECT results (RowDescription/DataRow/
+// CommandComplete bytes), shared by all sessions. Entries are keyed by the
+// caller (database, rewritten SQL, parameters, formats), evicted LRU within
+// a byte budget and dropped when a write to one of the tables they read is
+// committed. Disabled until a capacity is set.
+class ResultCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t invalidations = 0; // entries dropped because a table changed
+        uint64_t evictions = 0;     // entries dropped for space
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    void set_capacity(size_t bytes);
+    bool enabled() const { return capacity_ > 0; }
+
+    // Appends the cached bytes for key to out; false on a miss.
+    bool lookup(const std::string &key, std::vector<char> &out);
+    // Taken before running a query; insert() refuses the result if any of its
+    // tables was invalidated after this point, since it may predate the write.
+    uint64_t stamp();
+    void insert(const std::string &key, const std::vector<std::string> &tables, uint64_t stamp,
+                const char *data, size_t len);
+    // Tables are normalized names (see result_cache_table_name)
+    void invalidate(const std::unordered_set<std::string> &tables);
+    void invalidate_all();
+    Stats stats();
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<std::string> tables;
+        std::shared_ptr<const std::vector<char>> bytes;
+    };
+    using EntryList = std::list<Entry>;
+
+    void erase(EntryList::iterator it);
+
+    size_t capacity_ = 0;
+    std::mutex mtx_;
+    EntryList lru_; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> entries_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> by_table_; // table -> keys
+    std::unordered_map<std::string, uint64_t> table_stamp_; // last invalidation per table
+    uint64_t clock_ = 0;
+    uint64_t all_stamp_ = 0; // last invalidate_all
+    Stats stats_;
+};
+
+ResultCache &result_cache();
+
+// False for SQL whose result may change without any table being written
+// (time, random and sequence functions, ...).
+bool result_cacheable_sql(const std::string &sql);
+
+// Table name as used for invalidation: unquoted, lower-cased, without
+// catalog or schema (tables of the same name share invalidations).
+std::string result_cache_table_name(const std::string &name);
+
+#endif // RESULT_CACHE_HPP
@@ -0,0 +1,54 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/thread_pool.hpp>
+
+// A workload class (--workload-class): sessions matching it run their
+// queries on a worker pool of its own, so e.g. long analytical queries
+// cannot occupy the workers of short lookups. Sessions matching no class
+// use the --thread pool ("default").
+struct WorkloadClass
+{
+    std::string name;
+    size_t threads = 4;
+    size_t queue_limit = 0;     // message batches waiting for a worker; 0 = unbounded
+    int priority = 0;           // workers run at nice -priority (raising needs CAP_SYS_NICE)
+    // Match criteria, empty = any. statement is the first keyword of the
+    // query ("select", "copy", ...).
+    std::string database;
+    std::string user;
+    std::string application_name;
+    std::string statement;
+
+    boost::asio::thread_pool *pool = nullptr;
+    std::atomic<size_t> queued{0};
+    std::atomic<uint64_t> admitted{0};
+    std::atomic<uint64_t> rejected{0};
+
+    // Counts a batch into the queue unless that is full
+    bool try_enqueue();
+    void dequeue() { queued--; }
+};
+
+// Parses "name:threads=N,queue=N,priority=N,database=..,user=..,
+// application_name=..,statement=.." and adds the class after the ones
+// added before; the first class that matches a query wins. Throws
+// std::invalid_argument for malformed specs.
+void add_workload_class(const std::string &spec);
+// Starts the worker pools of the added classes (after init_thread_pool,
+// which serves the default class with default_threads workers)
+void start_workload_classes(size_t default_threads);
+void stop_workload_classes();
+// The class for a query of a session with the given startup parameters
+WorkloadClass &select_workload_class(const std::map<std::string, std::string> &startup_params,
+                                     const std::string &statement);
+// All classes, "default" last
+std::vector<WorkloadClass *> workload_classes();
+
+#endif // SCHEDULER_HPP
@@ -1,14 +1,28 @@
 #ifndef SESSION_HPP
 #define SESSION_HPP
+#include <utility> // Boost 1.74's asio/awaitable.hpp uses std::exchange without including it
 #include <boost/asio.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <vector>
 #include <map>
+#include <list>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <deque>
+#include <unordered_set>
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <duckdb.hpp>
 
+#include "pg_codec.hpp"
+#include "copy.hpp"
+#include "connection_pool.hpp"
+#include "scheduler.hpp"
+#include "handler_memory.hpp"
+#include "query_rewriter.hpp"
+
 using boost::asio::ip::tcp;
 namespace asio = boost::asio;
 
@@ -20,12 +34,124 @@ struct ColumnDesc
     uint16_t col_num = 0;
 };
 
+// A prepared statement's result as sent for one Bind result-format list:
+// the RowDescription message and the column encoders, built on first use so
+// that Describe and Execute of a statement run over and over only copy bytes
+struct ResultLayout
+{
+    std::vector<int16_t> formats;           // as sent in Bind
+    duckdb::vector<duckdb::LogicalType> types;
+    std::vector<char> row_description;      // the whole 'T' message
+    std::vector<PGColumnEncoder> encoders;
+};
+
+// How pipelined Executes of one statement run as a batch
+enum class BatchKind
+{
+    UNKNOWN,        // not yet decided
+    NONE,           // never batched
+    ONE_BY_ONE,     // row by row in one transaction
+    MULTI_ROW,      // also as multi-row INSERT ... VALUES
+    APPENDER,       // appended to the table (--insert-appender)
+};
+
+// "INSERT INTO [schema.]table [(columns)] VALUES ($1, ..., $n)", optionally
+// followed by an ON CONFLICT clause without parameters: the INSERTs whose
+// pipelined Executes can run as one multi-row statement, or be appended
+struct InsertValues
+{
+    std::string schema;                 // unquoted; empty: the default schema
+    std::string table;                  // unquoted
+    std::vector<std::string> columns;   // unquoted; empty: all, in table order
+    idx_t width = 0;                    // parameters of the VALUES row
+    std::string head;                   // the text up to and including VALUES
+    std::string tail;                   // " ON CONFLICT ...", or empty
+
+    // Quoted, schema-qualified table name for use in generated SQL
+    std::string qualified_table() const;
+};
+
 // Cached prepared statement for extended query protocol
 struct PreparedStatementEntry
 {
     std::string query;
     duckdb::unique_ptr<duckdb::PreparedStatement> stmt;
     std::vector<uint32_t> param_type_oids;
+    // Types DuckDB expects for $1..$n (INVALID where it could not infer one)
+    std::vector<duckdb::LogicalType> param_types;
+    // Parameter decoders resolved on first Bind, indexed [format][param]
+    std::vector<PGParamDecoder> param_decoders[2];
+    // Statements deferred to Bind (no stmt): one plan per parameter type
+    // signature of the bound values; null when that signature failed to prepare
+    std::map<std::string, std::shared_ptr<duckdb::PreparedStatement>> typed_stmts;
+    // Pipelined Execute batching; MULTI_ROW and APPENDER run ONE_BY_ONE
+    // inside the client's transaction
+    BatchKind batch_kind = BatchKind::UNKNOWN;
+    InsertValues insert;        // MULTI_ROW and APPENDER: the statement's parts
+    std::map<idx_t, duckdb::unique_ptr<duckdb::PreparedStatement>> batch_stmts; // by VALUES rows
+    // APPENDER: the Appender, which holds no rows between batches
+    duckdb::unique_ptr<duckdb::Appender> appender;
+    // Result cache: whether the SQL may be cached and whether the tables it
+    // reads or writes are known (empty until checked)
+    std::optional<bool> result_cacheable;
+    std::optional<bool> tables_known;
+    std::vector<std::string> tables;
+    // Result layouts of stmt (row-returning statements), most recent last
+    std::vector<std::shared_ptr<const ResultLayout>> layouts;
+    // Connection stmt and the plans above were prepared on; under
+    // --pool-size they are prepared again when the session's differs
+    const duckdb::Connection *conn = nullptr;
+};
+
+struct StatementCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+// A result being encoded into out_buf_ for the result cache
+struct ResultCapture
+{
+    std::string key;            // empty: not captured
+    uint64_t stamp = 0;
+    size_t start = 0;           // out_buf_ offset of the first byte
+    uint64_t flushes = 0;       // out_buf_ must not be flushed meanwhile
+};
+
+// An Execute held back so that a run of them can be executed as one batch
+struct DeferredExecute
+{
+    duckdb::vector<duckdb::Value> values;
+    size_t tag_pos;             // out_buf_ offset its CommandComplete belongs at
+};
+
+// Result streams run in slices: STREAM_MORE goes on fetching, STREAM_YIELD
+// lets other work run first, STREAM_WAIT waits for the socket to drain and
+// STREAM_GONE means the client went away; STREAM_DONE ends the stream.
+enum StreamStatus { STREAM_DONE, STREAM_MORE, STREAM_YIELD, STREAM_WAIT, STREAM_GONE };
+
+// What one uninterrupted run of a result stream has used of its slice
+struct StreamSlice
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t chunks = 0;
+};
+
+// A protocol message body, in place in the session's receive buffer; valid
+// while the message is being handled.
+class MessageBody
+{
+public:
+    MessageBody(const char *data, size_t size) : data_(data), size_(size) {}
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char &operator[](size_t i) const { return data_[i]; }
+
+private:
+    const char *data_;
+    size_t size_;
 };
 
 // Portal: a bound prepared statement ready to execute
@@ -34,36 +160,113 @@ struct PortalEntry
     std::string prep_name;
     duckdb::vector<duckdb::Value> bind_values;
     std::vector<int16_t> result_formats;
+    // Plan of a deferred statement for these values' types; if null too,
+    // the values are inlined into the SQL text at Execute
+    std::shared_ptr<duckdb::PreparedStatement> typed_stmt;
     bool has_result_desc = false;
     std::vector<ColumnDesc> result_columns;
+    // Layout of the statement's own plan for result_formats (null for
+    // deferred statements)
+    std::shared_ptr<const ResultLayout> layout;
+    // Execution state kept across Execute messages (max_rows > 0 suspends
+    // the portal with the DuckDB result still open)
+    duckdb::unique_ptr<duckdb::QueryResult> result;
+    duckdb::unique_ptr<duckdb::DataChunk> pending_chunk; // fetched, not fully sent
+    idx_t pending_offset = 0;
+    duckdb::StatementType stmt_type = duckdb::StatementType::SELECT_STATEMENT;
+    std::shared_ptr<const std::vector<PGColumnEncoder>> encoders;
+    bool exhausted = false;     // ran to completion; further Executes return no rows
 };
 
 class PGSession : public std::enable_shared_from_this<PGSession>
 {
+    // Completion of a batch of messages handed to the strand; resumes run()
+    using BatchHandler = asio::async_result<asio::use_awaitable_t<>, void()>::handler_type;
+
     tcp::socket socket_;
-    std::vector<char> msg_buf_;   // current message body buffer
+    std::vector<char> msg_buf_;   // startup packet buffer
+    // Receive buffer: [recv_begin_, recv_end_) is unhandled input; recv_need_
+    // is how much of it an incomplete message needs in total
+    std::vector<char> recv_buf_;
+    size_t recv_begin_ = 0;
+    size_t recv_end_ = 0;
+    size_t recv_need_ = 0;
     std::vector<char> out_buf_;   // output accumulation buffer
-    std::mutex write_mtx_;        // serialize writes on socket
+    // Output handed to the socket and not yet written (guarded by write_mtx_)
+    std::mutex write_mtx_;
+    std::deque<std::vector<char>> send_queue_;
+    std::vector<asio::const_buffer> gather_; // buffers of the write in flight
+    size_t send_queued_bytes_ = 0;
+    bool write_in_flight_ = false;
+    bool write_failed_ = false;
+    bool resume_on_write_ = false; // a stream waits for send_queue_ to drain
+    // Set while run() waits for the strand to handle a batch
+    std::optional<BatchHandler> batch_done_;
+    // Recycled handler memory of the operations a session keeps repeating
+    HandlerMemory write_mem_;     // async_write of the send queue
+    HandlerMemory wake_mem_;      // flush_output() starting a write
+    HandlerMemory strand_mem_;    // batches and stream slices posted to strand_
     // Per-session strand to serialise message handling (extended protocol must run in order).
     std::shared_ptr<boost::asio::strand<boost::asio::thread_pool::executor_type>> strand_;
+    WorkloadClass *strand_class_ = nullptr; // whose worker pool strand_ runs on
 
     std::vector<char> startup_packet_;
+    // Current DuckDB connection. With a pool it is only set while borrowed
+    // (lease_), and swapped with std::atomic_store since Cancel() reads it
+    // from other sessions' threads.
     std::shared_ptr<duckdb::Connection> connection_;
+    std::shared_ptr<ConnectionPool> pool_;
+    std::shared_ptr<PooledConnection> lease_;
+    std::string use_db_ = "memory"; // catalog the session uses (a borrowed connection must USE)
+    // SET / USE / PRAGMA statements the session ran, run again on every
+    // connection it borrows; keep_connection_ when one could not be recorded
+    std::vector<std::string> session_settings_;
+    bool keep_connection_ = false;
     std::map<std::string, std::string> startup_params_;
     uint32_t backend_pid_ = 0;
     uint32_t backend_secret_ = 0;
+    std::string db_name_;
+    uint64_t out_flushes_ = 0;
 
     // Extended protocol state
     std::map<std::string, std::shared_ptr<PreparedStatementEntry>> prep_map_;
     std::map<std::string, std::shared_ptr<PortalEntry>> portal_map_;
+    // Prepared statements by rewritten SQL + parameter OIDs, most recently
+    // used first, so that re-parsing the same text skips DuckDB's planner
+    std::list<std::pair<std::string, std::shared_ptr<PreparedStatementEntry>>> stmt_lru_;
+    std::unordered_map<std::string, decltype(stmt_lru_)::iterator> stmt_cache_;
+    StatementCacheStats stmt_cache_stats_;
 
     // In-transaction status
     char tx_status_ = 'I'; // 'I' idle, 'T' in transaction, 'E' failed transaction
     bool in_error_ = false; // whether we're in a failed extended protocol sequence until Sync
+    // Executes of one INSERT/UPDATE/DELETE statement pending within the Sync window
+    std::shared_ptr<PreparedStatementEntry> batch_stmt_;
+    std::vector<DeferredExecute> batch_;
+    // Result being streamed to the client; the messages after the one that
+    // started it (up to stream_end_) are handled once it is done
+    std::function<StreamStatus()> stream_;
+    char stream_msg_ = 'Q';
+    size_t stream_end_ = 0;
+    // Active COPY FROM STDIN (copy-in mode until CopyDone/CopyFail)
+    std::unique_ptr<CopyInLoader> copy_in_;
+    // Result cache: tables written by this session and not yet invalidated
+    // (their transaction is still open); written_all_ for unknown writes
+    std::unordered_set<std::string> written_tables_;
+    bool written_all_ = false;
+    bool result_cache_bypass_ = false; // session settings differ from the defaults
+    // pg_catalog mirror tables changed by DDL of the open transaction
+    unsigned catalog_changes_ = 0;
+    // search_path points at DuckDB's views while that DDL is uncommitted,
+    // and for good once the session has created temporary objects
+    bool catalog_views_ = false;
+    bool temp_objects_ = false;
 
 public:
-    PGSession(tcp::socket socket, std::shared_ptr<duckdb::Connection> conn)
-        : socket_(std::move(socket)), connection_(conn) {}
+    // Either a connection of its own, or a pool to borrow one from per transaction
+    PGSession(tcp::socket socket, std::shared_ptr<duckdb::Connection> conn,
+              std::shared_ptr<ConnectionPool> pool = nullptr)
+        : socket_(std::move(socket)), connection_(conn), pool_(pool) {}
 
     ~PGSession();
 
@@ -71,38 +274,95 @@ public:
 
     // append an ErrorResponse message to out_buf_
     void enqueue_error(const std::string &message, const std::string &sqlstate = "XX000");
+    // append a NoticeResponse (WARNING) message to out_buf_
+    void enqueue_notice(const std::string &message, const std::string &sqlstate);
 
+    // Runs the session on its socket's executor
     void start()
     {
-        handle_ssl_negotiation();
+        asio::co_spawn(socket_.get_executor(), run(shared_from_this()), asio::detached);
     }
 
+    // The first reactor (see init_reactors)
     static boost::asio::io_context &get_io_context();
 
 private:
+    // The socket side of the session; self keeps it alive meanwhile
+    asio::awaitable<void> run(std::shared_ptr<PGSession> self);
+    asio::awaitable<bool> read_startup();
     void parse_startup_params(const char *data, size_t length);
-    void handle_ssl_negotiation();
-    void handle_startup();
     void handle_authentication();
     void send_auth_ok();
     void append_parameter_status(const std::string &name, const std::string &value);
 
     // Message reading loop
-    void read_message();
-    void dispatch_message(char msg_type, std::vector<char> &&body);
+    asio::awaitable<size_t> read_messages();
+    asio::awaitable<void> handle_batch(size_t end);
+    void handle_messages(size_t end);
+    void finish_batch();
+    std::string batch_statement(size_t end) const;
+    void reject_messages(size_t end, const WorkloadClass &wc);
+    // rewrite: rewrite_statement() of a 'Q' body, done while batching
+    void dispatch_message(char msg_type, const MessageBody &body, Rewrite *rewrite = nullptr);
+
+    // Transaction pooling
+    bool autocommit() const { return !connection_ || connection_->IsAutoCommit(); }
+    void borrow_connection(size_t end);
+    void use_connection(std::shared_ptr<PooledConnection> lease);
+    void release_connection();
+    void rebind_statement(PreparedStatementEntry &prep);
 
     // Simple query
-    void handle_simple_query(const std::string &query);
+    void handle_simple_query(const std::string &query, Rewrite rewrite);
+
+    // Transaction state
+    void sync_tx_status();
+    bool run_transaction_control(int kind);
 
     // Extended query protocol
-    void handle_parse(const std::vector<char> &body);
-    void handle_bind(const std::vector<char> &body);
-    void handle_describe(const std::vector<char> &body);
-    void handle_execute(const std::vector<char> &body);
-    void handle_close(const std::vector<char> &body);
+    void handle_parse(const MessageBody &body);
+    void handle_bind(const MessageBody &body);
+    void handle_describe(const MessageBody &body);
+    void handle_execute(const MessageBody &body);
+    void handle_close(const MessageBody &body);
     void handle_sync();
     void handle_flush();
 
+    // COPY to/from the client
+    bool start_copy(const std::string &query);
+    void run_copy_out(const CopyStatement &stmt);
+    void handle_copy_data(const MessageBody &body);
+    void handle_copy_done();
+    void handle_copy_fail(const MessageBody &body);
+    void fail_copy_in(const std::string &message, const std::string &sqlstate);
+    void stream_portal(std::shared_ptr<PortalEntry> portal, int32_t max_rows, std::function<void()> on_exhausted);
+    bool run_stream();
+    void resume_stream();
+    StreamStatus stream_pause(StreamSlice &slice);
+    BatchKind batch_kind(PreparedStatementEntry &prep);
+    void flush_batch(bool rollback = false);
+    void run_batch(PreparedStatementEntry &prep, std::vector<DeferredExecute> &batch, BatchKind kind,
+                   std::vector<std::string> &tags);
+    void park_open_portals(const PortalEntry *keep = nullptr);
+    std::shared_ptr<PreparedStatementEntry> cached_statement(const std::string &key);
+    void cache_statement(const std::string &key, std::shared_ptr<PreparedStatementEntry> entry);
+    std::shared_ptr<PreparedStatementEntry> auto_prepared(const std::string &shape);
+    std::shared_ptr<const ResultLayout> result_layout(PreparedStatementEntry &prep,
+                                                      const std::vector<int16_t> &formats);
+    std::shared_ptr<duckdb::PreparedStatement> typed_statement(PreparedStatementEntry &prep,
+                                                               const duckdb::vector<duckdb::Value> &values);
+
+    // Result cache
+    bool serve_cached_result(ResultCapture &cap, const std::string &sql, PreparedStatementEntry *prep,
+                             const PortalEntry *portal);
+    void store_cached_result(const ResultCapture &cap, const std::string &sql, PreparedStatementEntry *prep);
+    const std::vector<std::string> *statement_tables(const std::string &sql, PreparedStatementEntry *prep,
+                                                     std::vector<std::string> &scratch);
+    void note_statement(duckdb::StatementType type, const std::string &sql, PreparedStatementEntry *prep = nullptr);
+    void note_written_tables(const std::vector<std::string> &tables);
+    void publish_writes();
+    void use_catalog_views(bool views);
+
     // writers (append into out_buf_)
     void enqueue_row_description(const std::vector<ColumnDesc> &columns,
                                  const std::vector<int16_t> *result_formats = nullptr);
@@ -112,24 +372,42 @@ private:
     void enqueue_bind_complete();
     void enqueue_close_complete();
     void enqueue_portal_suspended();
+    void enqueue_copy_in_response(int16_t ncols);
     void enqueue_empty_query_response();
     void enqueue_data_row_text(const std::vector<std::string> &values);
-    void enqueue_data_row_chunk(duckdb::DataChunk &chunk, idx_t row_idx,
-                                const std::vector<int16_t> &formats);
+    void enqueue_data_rows(duckdb::DataChunk &chunk, const std::vector<PGColumnEncoder> &encoders);
     void enqueue_command_complete(const std::string &tag);
     void enqueue_ready_for_query();
     void flush_output();
+    void write_next();
 
     void process_materialized_result(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &result,
                                      const std::string &original_query);
 
     std::string statement_tag_for(duckdb::StatementType t, idx_t row_count) const;
 
-    // Rewrite queries that reference pg_catalog/system info not provided by DuckDB
-    std::string rewrite_query(const std::string &query) const;
+    // Rewrite queries that reference pg_catalog/system info not provided by DuckDB;
+    // answer is set for statements with a constant result
+    std::string rewrite_query(const std::string &query, const ConstantAnswer **answer = nullptr) const;
+    std::string rewritten_sql(Rewrite &r, const std::string &query) const;
+    void enqueue_constant_answer(const ConstantAnswer &answer);
 };
 
 void set_data_directory(const std::string &dir);
+void set_output_high_water_mark(size_t bytes);
+void set_statement_cache_size(size_t entries);
+void set_auto_parameterize(bool enable);
+void set_insert_appender(bool enable);
+void set_stream_slice(size_t chunks, uint64_t micros);
+
+// Socket I/O reactors: init_reactors() before creating sockets, then
+// run_reactors() drives reactor 0 on the calling thread and the others on
+// threads of their own (pinned to CPUs 0..count-1 with pin_cpus) until
+// reactor 0 runs out of work.
+void init_reactors(size_t count, bool pin_cpus);
+size_t reactor_count();
+boost::asio::io_context &get_reactor(size_t index);
+void run_reactors();
 
 void init_thread_pool(size_t thread_count);
 boost::asio::thread_pool& get_thread_pool();
@@ -0,0 +1,98 @@
+#include "connection_pool.hpp"
+#include "log.hpp"
+
+ConnectionPool::ConnectionPool(duckdb::DuckDB &db, size_t size) : db_(db)
+{
+    stats_.size = size;
+}
+
+void ConnectionPool::acquire(Ready ready)
+{
+    std::shared_ptr<PooledConnection> conn;
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        stats_.acquires++;
+        if (!idle_.empty())
+        {
+            conn = std::move(idle_.back());
+            idle_.pop_back();
+        }
+        else if (stats_.open < stats_.size)
+        {
+            // Opened lazily, so a large pool costs nothing until it is used
+            stats_.open++;
+        }
+        else
+        {
+            stats_.waits++;
+            waiters_.push_back(std::move(ready));
+            return;
+        }
+    }
+    if (!conn)
+    {
+        conn = std::make_shared<PooledConnection>();
+        try { conn->conn = std::make_shared<duckdb::Connection>(db_); }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            stats_.open--;
+            throw;
+        }
+        PDEBUG << "connection pool: opened a connection";
+    }
+    ready(std::move(conn));
+}
+
+void ConnectionPool::release(std::shared_ptr<PooledConnection> conn)
+{
+    if (conn->settings_changed)
+    {
+        try
+        {
+            conn->conn = std::make_shared<duckdb::Connection>(db_);
+            conn->database.clear();
+            conn->settings_changed = false;
+        }
+        catch (std::exception &e)
+        {
+            PWARNING << "connection pool: could not replace a connection with changed settings: " << e.what();
+        }
+    }
+    Ready next;
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        if (waiters_.empty())
+        {
+            idle_.push_back(std::move(conn));
+            return;
+        }
+        next = std::move(waiters_.front());
+        waiters_.pop_front();
+    }
+    next(std::move(conn));
+}
+
+std::string ConnectionPool::execute(const std::string &sql)
+{
+    std::lock_guard<std::mutex> lg(admin_mtx_);
+    try
+    {
+        if (!admin_) admin_.reset(new duckdb::Connection(db_));
+        auto res = admin_->Query(sql);
+        return res->HasError() ? res->GetError() : std::string();
+    }
+    catch (std::exception &e)
+    {
+        return e.what();
+    }
+}
+
+ConnectionPool::Stats ConnectionPool::stats()
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    Stats st = stats_;
+    st.idle = idle_.size();
+    st.waiting = waiters_.size();
+    return st;
+}
@@ -0,0 +1,885 @@
+#include "copy.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <boost/algorithm/string.hpp>
+
+std::string quote_ident(const std::string &name)
+{
+    std::string out = "\"";
+    for (char c : name)
+    {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+std::string CopyStatement::qualified_table() const
+{
+    if (schema.empty()) return quote_ident(table);
+    return quote_ident(schema) + "." + quote_ident(table);
+}
+
+// --- statement parsing ---
+namespace
+{
+// Just enough of a SQL lexer for the COPY grammar: identifiers, string
+// literals, punctuation and a raw parenthesized query.
+class CopyLexer
+{
+public:
+    explicit CopyLexer(const std::string &s) : s_(s) {}
+
+    void skip_ws()
+    {
+        while (pos_ < s_.size())
+        {
+            if (std::isspace((unsigned char)s_[pos_]))
+                pos_++;
+            else if (s_.compare(pos_, 2, "--") == 0)
+                while (pos_ < s_.size() && s_[pos_] != '\n') pos_++;
+            else
+                break;
+        }
+    }
+    bool at_end()
+    {
+        skip_ws();
+        return pos_ >= s_.size();
+    }
+    bool accept(char c)
+    {
+        skip_ws();
+        if (pos_ < s_.size() && s_[pos_] == c) { pos_++; return true; }
+        return false;
+    }
+    // Identifier or keyword; unquoted words are folded to lower case
+    bool word(std::string &out, bool *quoted = nullptr)
+    {
+        skip_ws();
+        if (pos_ >= s_.size()) return false;
+        if (s_[pos_] == '"')
+        {
+            out.clear();
+            size_t i = pos_ + 1;
+            for (; i < s_.size(); i++)
+            {
+                if (s_[i] == '"')
+                {
+                    if (i + 1 < s_.size() && s_[i + 1] == '"') { out += '"'; i++; continue; }
+                    break;
+                }
+                out += s_[i];
+            }
+            if (i >= s_.size()) throw CopyError("unterminated quoted identifier", "42601");
+            pos_ = i + 1;
+            if (quoted) *quoted = true;
+            return true;
+        }
+        size_t i = pos_;
+        while (i < s_.size() && (std::isalnum((unsigned char)s_[i]) || s_[i] == '_' || s_[i] == '$')) i++;
+        if (i == pos_) return false;
+        out = boost::algorithm::to_lower_copy(s_.substr(pos_, i - pos_));
+        pos_ = i;
+        if (quoted) *quoted = false;
+        return true;
+    }
+    bool keyword(const char *kw)
+    {
+        size_t save = pos_;
+        std::string w;
+        bool quoted = false;
+        if (word(w, &quoted) && !quoted && w == kw) return true;
+        pos_ = save;
+        return false;
+    }
+    // 'text' or E'text'
+    bool string_literal(std::string &out)
+    {
+        skip_ws();
+        size_t i = pos_;
+        bool escapes = false;
+        if (i + 1 < s_.size() && (s_[i] == 'E' || s_[i] == 'e') && s_[i + 1] == '\'')
+        {
+            escapes = true;
+            i++;
+        }
+        if (i >= s_.size() || s_[i] != '\'') return false;
+        out.clear();
+        for (i++; i < s_.size(); i++)
+        {
+            char c = s_[i];
+            if (c == '\'')
+            {
+                if (i + 1 < s_.size() && s_[i + 1] == '\'') { out += '\''; i++; continue; }
+                pos_ = i + 1;
+                return true;
+            }
+            if (escapes && c == '\\' && i + 1 < s_.size())
+            {
+                c = s_[++i];
+                if (c == 't') c = '\t';
+                else if (c == 'n') c = '\n';
+                else if (c == 'r') c = '\r';
+            }
+            out += c;
+        }
+        throw CopyError("unterminated quoted string", "42601");
+    }
+    // Text up to the ')' matching an already consumed '('
+    std::string parenthesized()
+    {
+        size_t start = pos_;
+        int depth = 1;
+        char in_quote = 0;
+        for (; pos_ < s_.size(); pos_++)
+        {
+            char c = s_[pos_];
+            if (in_quote)
+            {
+                if (c == in_quote) in_quote = 0;
+                continue;
+            }
+            if (c == '\'' || c == '"') in_quote = c;
+            else if (c == '(') depth++;
+            else if (c == ')' && --depth == 0)
+            {
+                std::string inner = s_.substr(start, pos_ - start);
+                pos_++;
+                return inner;
+            }
+        }
+        throw CopyError("syntax error in COPY: unbalanced parentheses", "42601");
+    }
+
+private:
+    const std::string &s_;
+    size_t pos_ = 0;
+};
+
+CopyError copy_syntax_error(const std::string &what)
+{
+    return CopyError("syntax error in COPY: " + what, "42601");
+}
+
+bool bool_option(const std::string &name, const std::string &v)
+{
+    if (v.empty() || v == "true" || v == "on" || v == "1") return true;
+    if (v == "false" || v == "off" || v == "0") return false;
+    throw CopyError(name + " requires a Boolean value", "22023");
+}
+
+char char_option(const std::string &name, const std::string &v)
+{
+    if (v.size() != 1)
+        throw CopyError("COPY " + name + " must be a single one-byte character", "0A000");
+    return v[0];
+}
+
+// Options as given; defaults depend on the final format and are applied last
+struct CopyOptionValues
+{
+    std::string delimiter, null_str, quote, escape;
+    bool has_delimiter = false, has_null = false, has_quote = false, has_escape = false;
+};
+
+void apply_copy_option(CopyStatement &st, CopyOptionValues &vals, const std::string &name, const std::string &value)
+{
+    if (name == "format")
+    {
+        if (value == "text") st.format = CopyStatement::TEXT;
+        else if (value == "csv") st.format = CopyStatement::CSV;
+        else if (value == "binary") st.format = CopyStatement::BINARY;
+        else throw CopyError("COPY format \"" + value + "\" not recognized", "22023");
+    }
+    else if (name == "delimiter") { vals.delimiter = value; vals.has_delimiter = true; }
+    else if (name == "null") { vals.null_str = value; vals.has_null = true; }
+    else if (name == "quote") { vals.quote = value; vals.has_quote = true; }
+    else if (name == "escape") { vals.escape = value; vals.has_escape = true; }
+    else if (name == "header") st.header = value == "match" || bool_option(name, value);
+    else if (name == "freeze" || name == "encoding" || name == "force_quote" ||
+             name == "force_not_null" || name == "force_null")
+    {
+        // accepted for compatibility; no effect here
+    }
+    else
+        throw CopyError("option \"" + name + "\" not recognized", "42601");
+}
+} // namespace
+
+bool parse_copy_statement(const std::string &sql, CopyStatement &out)
+{
+    CopyLexer lx(sql);
+    if (!lx.keyword("copy")) return false;
+
+    CopyStatement st;
+    CopyOptionValues vals;
+    if (lx.keyword("binary")) st.format = CopyStatement::BINARY;
+    if (lx.accept('('))
+        st.query = lx.parenthesized();
+    else
+    {
+        if (!lx.word(st.table)) throw copy_syntax_error("expected table name");
+        if (lx.accept('.'))
+        {
+            st.schema = st.table;
+            if (!lx.word(st.table)) throw copy_syntax_error("expected table name");
+        }
+        // PG's default schema is DuckDB's main
+        if (st.schema == "public") st.schema.clear();
+        if (lx.accept('('))
+        {
+            do
+            {
+                std::string col;
+                if (!lx.word(col)) throw copy_syntax_error("expected column name");
+                st.columns.push_back(col);
+            } while (lx.accept(','));
+            if (!lx.accept(')')) throw copy_syntax_error("expected \")\" after column list");
+        }
+    }
+    if (lx.keyword("from")) st.from_stdin = true;
+    else if (!lx.keyword("to")) throw copy_syntax_error("expected FROM or TO");
+    // A server-side file or program is DuckDB's business
+    if (!lx.keyword(st.from_stdin ? "stdin" : "stdout")) return false;
+    if (st.from_stdin && !st.query.empty()) throw copy_syntax_error("COPY (query) cannot be used with FROM");
+
+    lx.keyword("with");
+    if (lx.accept('('))
+    {
+        do
+        {
+            std::string name, value;
+            if (!lx.word(name)) throw copy_syntax_error("expected option name");
+            if (lx.accept('('))
+                lx.parenthesized();             // FORCE_* column lists
+            else if (!lx.accept('*') && !lx.string_literal(value))
+                lx.word(value);
+            apply_copy_option(st, vals, name, value);
+        } while (lx.accept(','));
+        if (!lx.accept(')')) throw copy_syntax_error("expected \")\" after options");
+    }
+    else
+    {
+        // Pre-9.0 syntax, still used by psycopg2's copy_from/copy_to:
+        // [BINARY] [DELIMITER [AS] 'c'] [NULL [AS] 's'] [CSV [HEADER] [QUOTE [AS] 'q'] [ESCAPE [AS] 'e'] [FORCE ...]]
+        std::string kw;
+        while (lx.word(kw))
+        {
+            if (kw == "binary" || kw == "csv")
+                apply_copy_option(st, vals, "format", kw);
+            else if (kw == "header")
+                st.header = true;
+            else if (kw == "delimiter" || kw == "null" || kw == "quote" || kw == "escape")
+            {
+                std::string value;
+                lx.keyword("as");
+                if (!lx.string_literal(value)) throw copy_syntax_error("expected string after " + kw);
+                apply_copy_option(st, vals, kw, value);
+            }
+            else if (kw == "force")
+            {
+                lx.keyword("not");
+                if (!lx.keyword("quote") && !lx.keyword("null")) throw copy_syntax_error("expected QUOTE or NULL after FORCE");
+                if (!lx.accept('*'))
+                {
+                    std::string col;
+                    do
+                    {
+                        if (!lx.word(col)) throw copy_syntax_error("expected column name");
+                    } while (lx.accept(','));
+                }
+            }
+            else
+                throw copy_syntax_error("unexpected \"" + kw + "\"");
+        }
+    }
+    lx.accept(';');
+    if (!lx.at_end()) throw copy_syntax_error("unexpected text after options");
+
+    if (st.format == CopyStatement::CSV)
+    {
+        st.delimiter = vals.has_delimiter ? char_option("delimiter", vals.delimiter) : ',';
+        st.null_str = vals.has_null ? vals.null_str : "";
+        st.quote = vals.has_quote ? char_option("quote", vals.quote) : '"';
+        st.escape = vals.has_escape ? char_option("escape", vals.escape) : st.quote;
+    }
+    else
+    {
+        if (vals.has_quote || vals.has_escape)
+            throw CopyError("COPY quote and escape are available only in CSV mode", "0A000");
+        st.delimiter = vals.has_delimiter ? char_option("delimiter", vals.delimiter) : '\t';
+        st.null_str = vals.has_null ? vals.null_str : "\\N";
+    }
+    if (st.delimiter == '\n' || st.delimiter == '\r')
+        throw CopyError("COPY delimiter cannot be newline or carriage return", "22023");
+    out = std::move(st);
+    return true;
+}
+
+// --- COPY FROM STDIN ---
+CopyInLoader::CopyInLoader(duckdb::Connection &con, const CopyStatement &stmt) : con_(con), stmt_(stmt)
+{
+    if (stmt_.format == CopyStatement::BINARY)
+        throw CopyError("COPY FROM STDIN in binary format is not supported", "0A000");
+
+    std::string target = stmt_.qualified_table();
+    std::string cols = "*";
+    if (!stmt_.columns.empty())
+    {
+        cols.clear();
+        for (size_t i = 0; i < stmt_.columns.size(); i++)
+            cols += (i ? ", " : "") + quote_ident(stmt_.columns[i]);
+    }
+    auto desc = con_.Prepare("SELECT " + cols + " FROM " + target + " LIMIT 0");
+    if (desc->HasError()) throw CopyError(desc->GetError(), "42P01");
+    types_ = desc->GetTypes();
+    names_ = desc->GetNames();
+
+    // The Appender fills every column in table order; anything else is
+    // loaded into a staging table and moved over with one INSERT at the end.
+    bool direct = stmt_.columns.empty();
+    if (!direct)
+    {
+        auto all = con_.Prepare("SELECT * FROM " + target + " LIMIT 0");
+        if (!all->HasError() && all->GetNames().size() == names_.size())
+        {
+            direct = true;
+            for (size_t i = 0; i < names_.size() && direct; i++)
+                direct = boost::algorithm::iequals(all->GetNames()[i], names_[i]);
+        }
+    }
+
+    if (con_.IsAutoCommit())
+    {
+        con_.BeginTransaction();
+        own_txn_ = true;
+    }
+    try
+    {
+        if (direct)
+        {
+            if (stmt_.schema.empty())
+                appender_ = duckdb::make_uniq<duckdb::Appender>(con_, stmt_.table);
+            else
+                appender_ = duckdb::make_uniq<duckdb::Appender>(con_, stmt_.schema, stmt_.table);
+        }
+        else
+        {
+            static std::atomic<uint64_t> staging_seq{0};
+            staging_ = "__postduck_copy_" + std::to_string(++staging_seq);
+            auto res = con_.Query("CREATE TEMP TABLE " + quote_ident(staging_) + " AS SELECT " + cols +
+                                  " FROM " + target + " LIMIT 0");
+            if (res->HasError()) throw CopyError(res->GetError(), "XX000");
+            appender_ = duckdb::make_uniq<duckdb::Appender>(con_, staging_);
+        }
+    }
+    catch (...)
+    {
+        if (own_txn_)
+        {
+            try { con_.Rollback(); } catch (...) {}
+            own_txn_ = false;
+        }
+        throw;
+    }
+
+    // BLOB columns are filled with the decoded bytes directly; everything
+    // else is parsed from text by DuckDB's casts, a chunk at a time.
+    duckdb::vector<duckdb::LogicalType> raw_types;
+    for (auto &t : types_)
+        raw_types.push_back(t.id() == duckdb::LogicalTypeId::BLOB ? t : duckdb::LogicalType::VARCHAR);
+    raw_.Initialize(duckdb::Allocator::DefaultAllocator(), raw_types);
+    typed_.Initialize(duckdb::Allocator::DefaultAllocator(), types_);
+    skip_header_ = stmt_.header;
+}
+
+CopyInLoader::~CopyInLoader()
+{
+    abort();
+}
+
+void CopyInLoader::feed(const char *data, size_t len)
+{
+    if (end_marker_) return;
+    if (pending_.empty())
+    {
+        size_t used = consume(data, len);
+        pending_.assign(data + used, len - used);
+    }
+    else
+    {
+        pending_.append(data, len);
+        size_t used = consume(pending_.data(), pending_.size());
+        pending_.erase(0, used);
+    }
+}
+
+idx_t CopyInLoader::finish()
+{
+    if (!pending_.empty() && !end_marker_)
+    {
+        // last row without a trailing newline
+        size_t n = pending_.size();
+        if (pending_[n - 1] == '\r') n--;
+        handle_row(pending_.data(), n);
+        pending_.clear();
+    }
+    flush_chunk();
+    appender_->Close();
+    appender_.reset();
+    if (!staging_.empty())
+    {
+        std::string cols;
+        for (size_t i = 0; i < stmt_.columns.size(); i++)
+            cols += (i ? ", " : "") + quote_ident(stmt_.columns[i]);
+        auto res = con_.Query("INSERT INTO " + stmt_.qualified_table() + " (" + cols + ") SELECT * FROM " +
+                              quote_ident(staging_));
+        if (res->HasError()) throw CopyError(res->GetError(), "XX000");
+        con_.Query("DROP TABLE " + quote_ident(staging_));
+    }
+    if (own_txn_)
+    {
+        own_txn_ = false;
+        con_.Commit();
+    }
+    finished_ = true;
+    return rows_;
+}
+
+void CopyInLoader::abort()
+{
+    if (finished_) return;
+    finished_ = true;
+    // Destroying the Appender flushes what it buffered; rolling back our own
+    // transaction discards it again. An enclosing transaction is left to the
+    // client, which the session now holds in the failed state until ROLLBACK.
+    try { appender_.reset(); } catch (...) {}
+    try
+    {
+        if (own_txn_) con_.Rollback();
+    }
+    catch (...) {}
+    own_txn_ = false;
+}
+
+// Complete rows in data are loaded; returns the number of bytes consumed.
+size_t CopyInLoader::consume(const char *data, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len && !end_marker_)
+    {
+        size_t end = find_row_end(data + pos, len - pos);
+        if (end == std::string::npos) break;
+        size_t n = end;
+        if (n > 0 && data[pos + n - 1] == '\r') n--;
+        handle_row(data + pos, n);
+        pos += end + 1;
+    }
+    return end_marker_ ? len : pos;
+}
+
+// Offset of the newline ending the first row, npos if the row is incomplete.
+// In CSV a quoted newline is data.
+size_t CopyInLoader::find_row_end(const char *p, size_t n) const
+{
+    if (stmt_.format != CopyStatement::CSV)
+    {
+        auto nl = static_cast<const char *>(std::memchr(p, '\n', n));
+        return nl ? size_t(nl - p) : std::string::npos;
+    }
+    const char quote = stmt_.quote, escape = stmt_.escape;
+    bool in_quote = false;
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = p[i];
+        if (in_quote)
+        {
+            if (c == escape && escape != quote && i + 1 < n) i++;
+            else if (c == quote) in_quote = false;
+        }
+        else if (c == quote)
+            in_quote = true;
+        else if (c == '\n')
+            return i;
+    }
+    return std::string::npos;
+}
+
+void CopyInLoader::handle_row(const char *p, size_t n)
+{
+    line_++;
+    if (skip_header_)
+    {
+        skip_header_ = false;
+        return;
+    }
+    if (n == 2 && p[0] == '\\' && p[1] == '.')
+    {
+        end_marker_ = true;
+        return;
+    }
+    idx_t row = raw_.size();
+    if (stmt_.format == CopyStatement::CSV)
+        parse_csv_row(p, n, row);
+    else
+        parse_text_row(p, n, row);
+    raw_.SetCardinality(row + 1);
+    if (row + 1 == STANDARD_VECTOR_SIZE) flush_chunk();
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Backslash sequences of the text format
+static void text_unescape(const char *p, size_t n, std::string &out)
+{
+    out.clear();
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = p[i];
+        if (c != '\\' || i + 1 >= n)
+        {
+            out += c;
+            continue;
+        }
+        c = p[++i];
+        switch (c)
+        {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'v': out += '\v'; break;
+        case 'x':
+        {
+            int v = 0, digits = 0, d;
+            while (digits < 2 && i + 1 < n && (d = hex_digit(p[i + 1])) >= 0)
+            {
+                v = v * 16 + d;
+                digits++;
+                i++;
+            }
+            out += digits ? (char)v : 'x';
+            break;
+        }
+        default:
+            if (c >= '0' && c <= '7')
+            {
+                int v = c - '0', digits = 1;
+                while (digits < 3 && i + 1 < n && p[i + 1] >= '0' && p[i + 1] <= '7')
+                {
+                    v = v * 8 + (p[++i] - '0');
+                    digits++;
+                }
+                out += (char)v;
+            }
+            else
+                out += c;
+        }
+    }
+}
+
+void CopyInLoader::parse_text_row(const char *p, size_t n, idx_t row)
+{
+    const char delim = stmt_.delimiter;
+    const std::string &null_str = stmt_.null_str;
+    idx_t col = 0;
+    size_t i = 0;
+    while (true)
+    {
+        if (col >= types_.size()) throw row_error("extra data after last expected column");
+        size_t start = i;
+        bool escaped = false;
+        while (i < n && p[i] != delim)
+        {
+            if (p[i] == '\\')
+            {
+                escaped = true;
+                i++;
+            }
+            i++;
+        }
+        if (i > n) i = n;
+        size_t len = i - start;
+        if (len == null_str.size() && std::memcmp(p + start, null_str.data(), len) == 0)
+            duckdb::FlatVector::SetNull(raw_.data[col], row, true);
+        else if (!escaped)
+            set_field(col, row, p + start, len);
+        else
+        {
+            text_unescape(p + start, len, scratch_);
+            set_field(col, row, scratch_.data(), scratch_.size());
+        }
+        col++;
+        if (i >= n) break;
+        i++; // delimiter
+    }
+    if (col < types_.size()) throw row_error("missing data for column \"" + names_[col] + "\"");
+}
+
+void CopyInLoader::parse_csv_row(const char *p, size_t n, idx_t row)
+{
+    const char delim = stmt_.delimiter, quote = stmt_.quote, escape = stmt_.escape;
+    const std::string &null_str = stmt_.null_str;
+    idx_t col = 0;
+    size_t i = 0;
+    while (true)
+    {
+        if (col >= types_.size()) throw row_error("extra data after last expected column");
+        size_t start = i;
+        while (i < n && p[i] != delim && p[i] != quote) i++;
+        if (i >= n || p[i] == delim)
+        {
+            // unquoted field, used in place; only unquoted text can be NULL
+            size_t len = i - start;
+            if (len == null_str.size() && std::memcmp(p + start, null_str.data(), len) == 0)
+                duckdb::FlatVector::SetNull(raw_.data[col], row, true);
+            else
+                set_field(col, row, p + start, len);
+        }
+        else
+        {
+            scratch_.assign(p + start, i - start);
+            bool in_quote = false;
+            while (i < n)
+            {
+                char c = p[i];
+                if (in_quote)
+                {
+                    if (c == escape && i + 1 < n && (p[i + 1] == quote || p[i + 1] == escape))
+                    {
+                        scratch_ += p[i + 1];
+                        i += 2;
+                        continue;
+                    }
+                    if (c == quote)
+                    {
+                        in_quote = false;
+                        i++;
+                        continue;
+                    }
+                }
+                else if (c == delim)
+                    break;
+                else if (c == quote)
+                {
+                    in_quote = true;
+                    i++;
+                    continue;
+                }
+                scratch_ += c;
+                i++;
+            }
+            if (in_quote) throw row_error("unterminated CSV quoted field");
+            set_field(col, row, scratch_.data(), scratch_.size());
+        }
+        col++;
+        if (i >= n) break;
+        i++; // delimiter
+    }
+    if (col < types_.size()) throw row_error("missing data for column \"" + names_[col] + "\"");
+}
+
+void CopyInLoader::set_field(idx_t col, idx_t row, const char *p, size_t n)
+{
+    auto &vec = raw_.data[col];
+    if (types_[col].id() == duckdb::LogicalTypeId::BLOB && n >= 2 && p[0] == '\\' && p[1] == 'x')
+    {
+        // bytea hex format
+        if (n % 2 != 0) throw row_error("invalid hexadecimal data: odd number of digits");
+        bytes_.clear();
+        for (size_t i = 2; i < n; i += 2)
+        {
+            int hi = hex_digit(p[i]), lo = hex_digit(p[i + 1]);
+            if (hi < 0 || lo < 0) throw row_error("invalid hexadecimal digit");
+            bytes_ += (char)(hi * 16 + lo);
+        }
+        p = bytes_.data();
+        n = bytes_.size();
+    }
+    duckdb::FlatVector::GetData<duckdb::string_t>(vec)[row] = duckdb::StringVector::AddString(vec, p, n);
+}
+
+// Cast the buffered text columns to the table types and append them.
+void CopyInLoader::flush_chunk()
+{
+    idx_t count = raw_.size();
+    if (count == 0) return;
+    for (idx_t c = 0; c < types_.size(); c++)
+    {
+        if (raw_.data[c].GetType() == types_[c])
+        {
+            typed_.data[c].Reference(raw_.data[c]);
+            continue;
+        }
+        std::string err;
+        if (!duckdb::VectorOperations::DefaultTryCast(raw_.data[c], typed_.data[c], count, &err, true))
+            throw CopyError("invalid input for column \"" + names_[c] + "\": " + err, "22P02");
+    }
+    typed_.SetCardinality(count);
+    appender_->AppendDataChunk(typed_);
+    rows_ += count;
+    typed_.Reset();
+    raw_.Reset();
+}
+
+CopyError CopyInLoader::row_error(const std::string &msg) const
+{
+    std::string where = stmt_.table.empty() ? std::string("STDIN") : stmt_.table;
+    return CopyError(msg + " (COPY " + where + ", line " + std::to_string(line_) + ")", "22P04");
+}
+
+// --- COPY TO STDOUT ---
+CopyOutEncoder::CopyOutEncoder(const CopyStatement &stmt, const duckdb::vector<duckdb::LogicalType> &types,
+                               const std::vector<std::string> &names)
+    : stmt_(stmt), names_(names)
+{
+    encoders_ = make_column_encoders(types, std::vector<int16_t>(1, wire_format()));
+}
+
+void CopyOutEncoder::begin(std::vector<char> &out)
+{
+    if (stmt_.format == CopyStatement::BINARY)
+    {
+        static const char signature[] = "PGCOPY\n\377\r\n";
+        size_t len_pos = begin_message(out, 'd');
+        append_bytes(out, signature, sizeof(signature)); // includes the trailing \0
+        append_i32(out, 0); // flags
+        append_i32(out, 0); // header extension length
+        end_message(out, len_pos);
+    }
+    else if (stmt_.header)
+    {
+        size_t len_pos = begin_message(out, 'd');
+        for (size_t c = 0; c < names_.size(); c++)
+        {
+            if (c > 0) out.push_back(stmt_.delimiter);
+            size_t start = out.size();
+            append_bytes(out, names_[c].data(), names_[c].size());
+            if (stmt_.format == CopyStatement::CSV)
+                csv_field(out, start, names_.size() == 1);
+            else
+                text_field(out, start);
+        }
+        out.push_back('\n');
+        end_message(out, len_pos);
+    }
+}
+
+void CopyOutEncoder::end(std::vector<char> &out)
+{
+    if (stmt_.format != CopyStatement::BINARY) return;
+    size_t len_pos = begin_message(out, 'd');
+    append_i16(out, -1);
+    end_message(out, len_pos);
+}
+
+void CopyOutEncoder::encode_chunk(std::vector<char> &out, duckdb::DataChunk &chunk)
+{
+    idx_t ncols = chunk.ColumnCount();
+    idx_t count = chunk.size();
+    if (count == 0) return;
+    PGChunkCells cells(chunk, encoders_);
+    size_t len_pos = begin_message(out, 'd');
+    if (stmt_.format == CopyStatement::BINARY)
+    {
+        for (idx_t row = 0; row < count; row++)
+        {
+            append_i16(out, static_cast<int16_t>(ncols));
+            for (idx_t c = 0; c < ncols; c++)
+            {
+                size_t field_pos = out.size();
+                append_i32(out, 0);
+                if (cells.write(out, c, row))
+                    patch_i32(out, field_pos, static_cast<int32_t>(out.size() - field_pos - 4));
+                else
+                    patch_i32(out, field_pos, -1);
+            }
+        }
+    }
+    else
+    {
+        bool csv = stmt_.format == CopyStatement::CSV;
+        for (idx_t row = 0; row < count; row++)
+        {
+            for (idx_t c = 0; c < ncols; c++)
+            {
+                if (c > 0) out.push_back(stmt_.delimiter);
+                size_t start = out.size();
+                if (!cells.write(out, c, row))
+                    append_bytes(out, stmt_.null_str.data(), stmt_.null_str.size());
+                else if (csv)
+                    csv_field(out, start, ncols == 1);
+                else
+                    text_field(out, start);
+            }
+            out.push_back('\n');
+        }
+    }
+    end_message(out, len_pos);
+}
+
+// Escape the cell written at out[start..] in place (text format).
+void CopyOutEncoder::text_field(std::vector<char> &out, size_t start)
+{
+    const char delim = stmt_.delimiter;
+    size_t i = start;
+    for (; i < out.size(); i++)
+    {
+        char c = out[i];
+        if (c == '\\' || c == delim || (unsigned char)c < 0x20) break;
+    }
+    if (i == out.size()) return; // nothing to escape: the common case
+    scratch_.assign(out.begin() + i, out.end());
+    out.resize(i);
+    for (char c : scratch_)
+    {
+        switch (c)
+        {
+        case '\b': out.push_back('\\'); out.push_back('b'); break;
+        case '\f': out.push_back('\\'); out.push_back('f'); break;
+        case '\n': out.push_back('\\'); out.push_back('n'); break;
+        case '\r': out.push_back('\\'); out.push_back('r'); break;
+        case '\t': out.push_back('\\'); out.push_back('t'); break;
+        case '\v': out.push_back('\\'); out.push_back('v'); break;
+        default:
+            if (c == '\\' || c == delim) out.push_back('\\');
+            out.push_back(c);
+        }
+    }
+}
+
+// Quote the cell written at out[start..] if CSV requires it.
+void CopyOutEncoder::csv_field(std::vector<char> &out, size_t start, bool only_column)
+{
+    const char delim = stmt_.delimiter, quote = stmt_.quote, escape = stmt_.escape;
+    size_t n = out.size() - start;
+    bool need_quote = (n == stmt_.null_str.size() &&
+                       std::memcmp(out.data() + start, stmt_.null_str.data(), n) == 0) ||
+                      (only_column && n == 2 && out[start] == '\\' && out[start + 1] == '.');
+    for (size_t i = start; i < out.size() && !need_quote; i++)
+    {
+        char c = out[i];
+        need_quote = c == delim || c == quote || c == escape || c == '\n' || c == '\r';
+    }
+    if (!need_quote) return;
+    scratch_.assign(out.begin() + start, out.end());
+    out.resize(start);
+    out.push_back(quote);
+    for (char c : scratch_)
+    {
+        if (c == quote || c == escape) out.push_back(escape);
+        out.push_back(c);
+    }
+    out.push_back(quote);
+}
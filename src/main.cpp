@@ -1,3 +1,4 @@
+#include <utility> // Boost 1.74's asio/awaitable.hpp uses std::exchange without including it
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/program_options.hpp>
@@ -11,6 +12,10 @@
 #include "session.hpp"
 #include "log.hpp"
 #include "db.hpp"
+#include "result_cache.hpp"
+#include "connection_pool.hpp"
+#include "scheduler.hpp"
+#include "pg_catalog.hpp"
 
 using boost::asio::ip::tcp;
 namespace asio = boost::asio;
@@ -20,35 +25,69 @@ namespace po = boost::program_options;
 class Server
 {
 	DB duckdb_;
+	std::shared_ptr<ConnectionPool> pool_;
 
 public:
-	Server(boost::asio::io_context &io_context, short port)
-		: acceptor_(io_context, tcp::endpoint(tcp::v4(), port))
+	// With reuse_port every reactor listens on the port itself and the kernel
+	// spreads the connections; otherwise reactor 0 accepts for all of them.
+	Server(short port, size_t pool_size, bool reuse_port, bool mirror_catalog)
 	{
-		accept();
+		if (mirror_catalog && catalog_mirror().enable(duckdb_.instance()))
+			PINFO << "pg_catalog mirrored in " << CatalogMirror::database_name;
+		if (pool_size > 0)
+			pool_ = std::make_shared<ConnectionPool>(duckdb_.instance(), pool_size);
+		tcp::endpoint endpoint(tcp::v4(), port);
+		size_t listeners = reuse_port ? reactor_count() : 1;
+		for (size_t i = 0; i < listeners; i++)
+		{
+			acceptors_.emplace_back(new tcp::acceptor(get_reactor(i)));
+			tcp::acceptor &acceptor = *acceptors_.back();
+			acceptor.open(endpoint.protocol());
+			acceptor.set_option(tcp::acceptor::reuse_address(true));
+			if (reuse_port)
+			{
+#ifdef SO_REUSEPORT
+				acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+				throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+			}
+			acceptor.bind(endpoint);
+			acceptor.listen();
+		}
+		for (size_t i = 0; i < acceptors_.size(); i++)
+			accept(i);
 	}
 
 private:
-	void accept()
+	// Acceptor i runs on reactor i
+	void accept(size_t i)
 	{
-		acceptor_.async_accept(
-			[this](boost::system::error_code ec, tcp::socket socket)
+		// A single acceptor hands the sessions to the reactors round-robin
+		asio::io_context &reactor = get_reactor(acceptors_.size() == 1 ? next_reactor_++ : i);
+		acceptors_[i]->async_accept(
+			reactor,
+			[this, i](boost::system::error_code ec, tcp::socket socket)
 			{
 				if (!ec)
 				{
 					PINFO << "New connection from " << socket.remote_endpoint();
-					auto session = std::make_shared<PGSession>(std::move(socket), duckdb_.get_connection());
-					session->start();
+					auto executor = socket.get_executor();
+					auto session = pool_ ? std::make_shared<PGSession>(std::move(socket), nullptr, pool_)
+					                     : std::make_shared<PGSession>(std::move(socket), duckdb_.get_connection());
+					// Start on the reactor that owns the socket
+					asio::post(executor, [session]() { session->start(); });
 				}
 				else
 				{
 					PERROR << "Accept error: " << ec.message();
 				}
-				accept(); // 继续接受新连接
+				accept(i); // 继续接受新连接
 			});
 	}
 
-	tcp::acceptor acceptor_;
+	std::vector<std::unique_ptr<tcp::acceptor>> acceptors_;
+	size_t next_reactor_ = 0;
 };
 
 int main(int argc, char *argv[])
@@ -57,12 +96,29 @@ int main(int argc, char *argv[])
 	{
 		int port = 5432;
 		int thread_count = 4;  // 默认线程数为4
+		int pool_size = 0;
+		int reactors = 1;
 		po::options_description desc("options");
 		desc.add_options()
 			("help,h", "show help message")
 			("port,p", po::value<int>(), "server listen port, default is 5432")
 			("thread,t", po::value<int>(), "thread pool size, default is 4")
 			("data,d", po::value<std::string>(), "database dir path, default is .")
+			("output-buffer", po::value<int>(), "flush result rows to the client every N KB, default is 256")
+			("stream-slice", po::value<int>(), "a result stream lets other queries run after N microseconds, default is 10000 (0 = no limit)")
+			("stream-slice-chunks", po::value<int>(), "... or after N chunks of 2048 rows, default is 16 (0 = no limit)")
+			("statement-cache", po::value<int>(), "prepared statements each session keeps for re-parsed queries, default is 64")
+			("auto-parameterize", "run simple queries that differ only in literals through one cached plan")
+			("insert-appender", "append the rows of prepared single-row INSERT ... VALUES statements outside transactions instead of executing them")
+			("result-cache", po::value<int>(), "cache SELECT results in up to N MB shared by all sessions, default is 0 (off)")
+			("reactors", po::value<int>(), "threads doing socket I/O, default is 1")
+			("reuse-port", "give every reactor its own SO_REUSEPORT listener instead of one shared acceptor")
+			("pin-reactors", "pin reactor threads to CPUs 0..N-1")
+			("workload-class", po::value<std::vector<std::string>>()->composing(),
+			 "name:threads=N,queue=N,priority=N[,database=|user=|application_name=|statement=...]: "
+			 "run matching queries on a worker pool of their own (repeatable, first match wins)")
+			("pool-size", po::value<int>(), "share N DuckDB connections among all clients, per transaction, default is 0 (one per client)")
+			("catalog-mirror", "answer pg_catalog queries from a copy of DuckDB's views refreshed after DDL")
 			("log,l", po::value<std::string>(), "server log level: {TRACE, DEBUG, INFO, WARNING, ERROR, FATAL}");
 
 		po::variables_map vm;
@@ -95,6 +151,86 @@ int main(int argc, char *argv[])
 			set_data_directory(dir);
 		}
 
+		if (vm.count("output-buffer"))
+		{
+			int kb = vm["output-buffer"].as<int>();
+			if (kb <= 0) {
+				std::cerr << "Output buffer size must be greater than 0" << std::endl;
+				return 1;
+			}
+			set_output_high_water_mark(static_cast<size_t>(kb) * 1024);
+		}
+
+		if (vm.count("stream-slice") || vm.count("stream-slice-chunks"))
+		{
+			int us = vm.count("stream-slice") ? vm["stream-slice"].as<int>() : 10000;
+			int chunks = vm.count("stream-slice-chunks") ? vm["stream-slice-chunks"].as<int>() : 16;
+			if (us < 0 || chunks < 0) {
+				std::cerr << "Stream slice must not be negative" << std::endl;
+				return 1;
+			}
+			set_stream_slice(static_cast<size_t>(chunks), static_cast<uint64_t>(us));
+		}
+
+		if (vm.count("statement-cache"))
+		{
+			int n = vm["statement-cache"].as<int>();
+			if (n < 0) {
+				std::cerr << "Statement cache size must not be negative" << std::endl;
+				return 1;
+			}
+			set_statement_cache_size(static_cast<size_t>(n));
+		}
+
+		if (vm.count("auto-parameterize"))
+		{
+			set_auto_parameterize(true);
+		}
+
+		if (vm.count("insert-appender"))
+		{
+			set_insert_appender(true);
+		}
+
+		if (vm.count("result-cache"))
+		{
+			int mb = vm["result-cache"].as<int>();
+			if (mb < 0) {
+				std::cerr << "Result cache size must not be negative" << std::endl;
+				return 1;
+			}
+			result_cache().set_capacity(static_cast<size_t>(mb) * 1024 * 1024);
+		}
+
+		if (vm.count("reactors"))
+		{
+			reactors = vm["reactors"].as<int>();
+			if (reactors <= 0) {
+				std::cerr << "Reactor count must be greater than 0" << std::endl;
+				return 1;
+			}
+		}
+
+		if (vm.count("pool-size"))
+		{
+			pool_size = vm["pool-size"].as<int>();
+			if (pool_size < 0) {
+				std::cerr << "Pool size must not be negative" << std::endl;
+				return 1;
+			}
+		}
+
+		if (vm.count("workload-class"))
+		{
+			try {
+				for (auto &spec : vm["workload-class"].as<std::vector<std::string>>())
+					add_workload_class(spec);
+			} catch (std::invalid_argument &e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+		}
+
 		if (vm.count("log"))
 		{
 			std::string log_level = vm["log"].as<std::string>();
@@ -122,18 +258,24 @@ int main(int argc, char *argv[])
 		
 		PINFO << "Initializing thread pool with " << thread_count << " threads";
 		init_thread_pool(thread_count);
+		start_workload_classes(static_cast<size_t>(thread_count));
 		PINFO << "Start on port " << port;
 
-		Server server(PGSession::get_io_context(), port);
-		PGSession::get_io_context().run();
+		init_reactors(static_cast<size_t>(reactors), vm.count("pin-reactors") > 0);
+		PINFO << "Running " << reactors << " reactor(s)";
+		Server server(port, static_cast<size_t>(pool_size), vm.count("reuse-port") > 0,
+		              vm.count("catalog-mirror") > 0);
+		run_reactors();
 		
 		// 清理线程池资源
+		stop_workload_classes();
 		cleanup_thread_pool();
 	}
 	catch (std::exception &e)
 	{
 		PFATAL << "Exception: " << e.what();
 		// 清理线程池资源
+		stop_workload_classes();
 		cleanup_thread_pool();
 	}
 
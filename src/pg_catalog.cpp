@@ -0,0 +1,171 @@
+#include "pg_catalog.hpp"
+#include "log.hpp"
+#include "query_rewriter.hpp"
+
+const char *CatalogMirror::database_name = "postduck_catalog";
+
+CatalogMirror &catalog_mirror()
+{
+    static CatalogMirror mirror;
+    return mirror;
+}
+
+// The mirror's own tables show up in DuckDB's views too; they are left out
+struct MirroredTable
+{
+    CatalogMirror::Table bit;
+    const char *name;
+    const char *filter;
+};
+
+static const MirroredTable mirrored_tables[] = {
+    {CatalogMirror::PG_NAMESPACE, "pg_namespace",
+     "oid NOT IN (SELECT oid FROM duckdb_schemas() WHERE database_name = 'postduck_catalog')"},
+    {CatalogMirror::PG_CLASS, "pg_class",
+     "relnamespace NOT IN (SELECT oid FROM duckdb_schemas() WHERE database_name = 'postduck_catalog')"},
+    {CatalogMirror::PG_ATTRIBUTE, "pg_attribute",
+     "attrelid NOT IN (SELECT table_oid FROM duckdb_tables() WHERE database_name = 'postduck_catalog')"},
+    {CatalogMirror::PG_TYPE, "pg_type", nullptr},
+    {CatalogMirror::PG_INDEX, "pg_index",
+     "indrelid NOT IN (SELECT table_oid FROM duckdb_tables() WHERE database_name = 'postduck_catalog')"},
+    {CatalogMirror::PG_PROC, "pg_proc", nullptr},
+};
+
+bool CatalogMirror::enable(duckdb::DuckDB &db)
+{
+    try
+    {
+        std::unique_ptr<duckdb::Connection> conn(new duckdb::Connection(db));
+        auto res = conn->Query(std::string("ATTACH IF NOT EXISTS ':memory:' AS ") + database_name +
+                               "; CREATE SCHEMA IF NOT EXISTS " + database_name + ".pg_catalog;");
+        if (res->HasError())
+        {
+            PWARNING << "pg_catalog mirror disabled: " << res->GetError();
+            return false;
+        }
+        admin_ = std::move(conn);
+    }
+    catch (std::exception &e)
+    {
+        PWARNING << "pg_catalog mirror disabled: " << e.what();
+        return false;
+    }
+    refresh(ALL_TABLES);
+    return true;
+}
+
+std::string CatalogMirror::search_path_sql(const std::string &db, bool mirror) const
+{
+    if (!mirror) return "SET search_path = '\"" + db + "\".main';";
+    return "SET search_path = '\"" + db + "\".main," + database_name + ".pg_catalog';";
+}
+
+void CatalogMirror::refresh(unsigned tables)
+{
+    if (!enabled() || tables == 0) return;
+    std::unique_lock<std::mutex> lk(refresh_mtx_);
+    pending_ |= tables;
+    // A copy already running may have read the views before the caller's
+    // changes: wait for the next one, which takes whatever is pending then.
+    // Copies run one at a time, on whichever waiting thread finds none running.
+    uint64_t wanted = copies_started_ + 1;
+    while (copies_finished_ < wanted)
+    {
+        if (copying_)
+        {
+            refreshed_.wait(lk);
+            continue;
+        }
+        copying_ = true;
+        copies_started_++;
+        unsigned copy = pending_;
+        pending_ = 0;
+        lk.unlock();
+        copy_tables(copy);
+        lk.lock();
+        copying_ = false;
+        copies_finished_++;
+        refreshed_.notify_all();
+    }
+}
+
+void CatalogMirror::note_database(const std::string &db)
+{
+    if (!enabled()) return;
+    {
+        std::lock_guard<std::mutex> lg(databases_mtx_);
+        if (!databases_.insert(db).second) return;
+    }
+    refresh(ALL_TABLES);
+}
+
+// Replaces the tables in one transaction, so readers see either the old or
+// the new copy of all of them
+void CatalogMirror::copy_tables(unsigned tables)
+{
+    if (tables == 0) return;
+    std::string sql = "BEGIN; ";
+    for (auto &t : mirrored_tables)
+    {
+        if (!(tables & t.bit)) continue;
+        sql += std::string("CREATE OR REPLACE TABLE ") + database_name + ".pg_catalog." + t.name +
+               " AS SELECT * FROM system.pg_catalog." + t.name;
+        if (t.filter) sql += std::string(" WHERE ") + t.filter;
+        sql += "; ";
+    }
+    sql += "COMMIT;";
+    try
+    {
+        auto res = admin_->Query(sql);
+        if (res->HasError())
+        {
+            PWARNING << "pg_catalog mirror refresh failed: " << res->GetError();
+            if (!admin_->IsAutoCommit()) admin_->Query("ROLLBACK;");
+        }
+        else
+            PDEBUG << "pg_catalog mirror refreshed, tables 0x" << std::hex << tables;
+    }
+    catch (std::exception &e)
+    {
+        PWARNING << "pg_catalog mirror refresh failed: " << e.what();
+    }
+}
+
+unsigned CatalogMirror::tables_changed_by(duckdb::StatementType type, const std::string &sql, bool &temporary)
+{
+    switch (type)
+    {
+    case duckdb::StatementType::CREATE_STATEMENT:
+    case duckdb::StatementType::DROP_STATEMENT:
+    case duckdb::StatementType::ALTER_STATEMENT:
+        break;
+    case duckdb::StatementType::CREATE_FUNC_STATEMENT:
+        return PG_PROC;
+    case duckdb::StatementType::ATTACH_STATEMENT:
+    case duckdb::StatementType::DETACH_STATEMENT:
+    case duckdb::StatementType::LOAD_STATEMENT:
+    case duckdb::StatementType::COPY_DATABASE_STATEMENT:
+    case duckdb::StatementType::EXECUTE_STATEMENT:
+    case duckdb::StatementType::MULTI_STATEMENT:
+        return ALL_TABLES;
+    default:
+        return 0;
+    }
+    // CREATE [OR REPLACE] [TEMP | TEMPORARY] [UNIQUE] kind, DROP kind, ALTER kind
+    SqlLexer lex(sql);
+    std::string kind;
+    if (!lex.next(kind) || !lex.next(kind)) return ALL_TABLES;
+    if (kind == "or" && !(lex.next(kind) && kind == "replace" && lex.next(kind))) return ALL_TABLES;
+    if (kind == "temp" || kind == "temporary")
+    {
+        temporary = true;
+        return 0;
+    }
+    if (kind == "unique" && !lex.next(kind)) return ALL_TABLES;
+    if (kind == "table" || kind == "view" || kind == "sequence")
+        return PG_CLASS | PG_ATTRIBUTE | PG_INDEX;
+    if (kind == "index") return PG_CLASS | PG_INDEX;
+    if (kind == "type") return PG_TYPE;
+    if (kind == "macro" || kind == "function") return PG_PROC;
+    return ALL_TABLES;
+}
@@ -0,0 +1,1247 @@
+#include "pg_codec.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+// PG array type OID for an element type OID; 0 if there is none (e.g. the
+// element is itself an array), in which case the list is sent as text.
+uint32_t pg_array_oid(uint32_t elem_oid)
+{
+    switch (elem_oid)
+    {
+    case 16:   return 1000; // _bool
+    case 17:   return 1001; // _bytea
+    case 18:   return 1002; // _char
+    case 20:   return 1016; // _int8
+    case 21:   return 1005; // _int2
+    case 23:   return 1007; // _int4
+    case 25:   return 1009; // _text
+    case 26:   return 1028; // _oid
+    case 700:  return 1021; // _float4
+    case 701:  return 1022; // _float8
+    case 1042: return 1014; // _bpchar
+    case 1043: return 1015; // _varchar
+    case 1082: return 1182; // _date
+    case 1083: return 1183; // _time
+    case 1114: return 1115; // _timestamp
+    case 1184: return 1185; // _timestamptz
+    case 1186: return 1187; // _interval
+    case 1266: return 1270; // _timetz
+    case 1700: return 1231; // _numeric
+    case 2950: return 2951; // _uuid
+    default:   return 0;
+    }
+}
+
+// DuckDB LogicalTypeId -> PG type OID
+// Based on duckdb::LogicalTypeId enum values.
+uint32_t pg_type_oid(const duckdb::LogicalType &lt)
+{
+    switch (lt.id())
+    {
+    case duckdb::LogicalTypeId::BOOLEAN:  return 16;   // bool
+    case duckdb::LogicalTypeId::TINYINT:  return 21;   // int2 (no int1 in PG)
+    case duckdb::LogicalTypeId::SMALLINT: return 21;   // int2
+    case duckdb::LogicalTypeId::INTEGER:  return 23;   // int4
+    case duckdb::LogicalTypeId::BIGINT:   return 20;   // int8
+    case duckdb::LogicalTypeId::UTINYINT: return 21;
+    case duckdb::LogicalTypeId::USMALLINT:return 23;
+    case duckdb::LogicalTypeId::UINTEGER: return 20;
+    case duckdb::LogicalTypeId::UBIGINT:  return 1700; // numeric (fit)
+    case duckdb::LogicalTypeId::HUGEINT:  return 1700; // numeric
+    case duckdb::LogicalTypeId::UHUGEINT: return 1700; // numeric
+    case duckdb::LogicalTypeId::FLOAT:    return 700;  // float4
+    case duckdb::LogicalTypeId::DOUBLE:   return 701;  // float8
+    case duckdb::LogicalTypeId::DECIMAL:  return 1700; // numeric
+    case duckdb::LogicalTypeId::VARCHAR:  return 25;   // text (better for JDBC generic)
+    case duckdb::LogicalTypeId::CHAR:     return 1042; // bpchar
+    case duckdb::LogicalTypeId::BLOB:     return 17;   // bytea
+    case duckdb::LogicalTypeId::DATE:     return 1082;
+    case duckdb::LogicalTypeId::TIME:     return 1083;
+    case duckdb::LogicalTypeId::TIMESTAMP:     return 1114;
+    case duckdb::LogicalTypeId::TIMESTAMP_TZ:  return 1184;
+    case duckdb::LogicalTypeId::TIMESTAMP_SEC:
+    case duckdb::LogicalTypeId::TIMESTAMP_MS:
+    case duckdb::LogicalTypeId::TIMESTAMP_NS:  return 1114;
+    case duckdb::LogicalTypeId::TIME_TZ:        return 1266;
+    case duckdb::LogicalTypeId::INTERVAL:       return 1186;
+    case duckdb::LogicalTypeId::UUID:           return 2950;
+    case duckdb::LogicalTypeId::LIST:
+    {
+        uint32_t arr = pg_array_oid(pg_type_oid(duckdb::ListType::GetChildType(lt)));
+        return arr ? arr : 25;
+    }
+    case duckdb::LogicalTypeId::ARRAY:
+    {
+        uint32_t arr = pg_array_oid(pg_type_oid(duckdb::ArrayType::GetChildType(lt)));
+        return arr ? arr : 25;
+    }
+    case duckdb::LogicalTypeId::MAP:
+    case duckdb::LogicalTypeId::STRUCT:
+    case duckdb::LogicalTypeId::UNION:
+    case duckdb::LogicalTypeId::ENUM:           return 25; // text repr
+    default:                                    return 25;
+    }
+}
+
+// Pick reasonable type length for a type OID; -1 = var length
+int16_t pg_type_len(uint32_t oid)
+{
+    switch (oid)
+    {
+    case 16:   return 1;   // bool
+    case 17:   return -1;  // bytea
+    case 18:   return 1;   // char
+    case 20:   return 8;
+    case 21:   return 2;
+    case 23:   return 4;
+    case 26:   return 4;   // oid
+    case 700:  return 4;
+    case 701:  return 8;
+    case 1082: return 4;
+    case 1083: return 8;
+    case 1114: return 8;
+    case 1184: return 8;
+    case 1266: return 12;
+    case 1186: return 16;
+    case 2950: return 16;
+    default:   return -1;
+    }
+}
+
+struct PGColumn
+{
+    const PGColumnEncoder *encoder = nullptr;
+    duckdb::UnifiedVectorFormat format;
+    duckdb::unique_ptr<duckdb::Vector> text; // VARCHAR rendering for cast_to_text encoders
+    duckdb::unique_ptr<PGColumn> element;    // list/array child column
+};
+
+// PG epoch (2000-01-01) relative to the Unix epoch DuckDB uses
+static const int32_t PG_EPOCH_DAYS = 10957;
+static const int64_t PG_EPOCH_MICROS = 946684800000000LL;
+
+// --- text writers ---
+template <class T>
+static void write_integer_text(std::vector<char> &out, T v)
+{
+    typedef typename std::make_unsigned<T>::type U;
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    bool neg = v < 0;
+    U u = neg ? static_cast<U>(U(0) - static_cast<U>(v)) : static_cast<U>(v);
+    do
+    {
+        *--p = static_cast<char>('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (neg) *--p = '-';
+    append_bytes(out, p, end - p);
+}
+
+template <class T>
+static void text_integer(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    write_integer_text(out, duckdb::UnifiedVectorFormat::GetData<T>(col.format)[idx]);
+}
+
+static void text_bool(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    out.push_back(duckdb::UnifiedVectorFormat::GetData<bool>(col.format)[idx] ? 't' : 'f');
+}
+
+// VARCHAR/BLOB columns in binary, and anything rendered through the VARCHAR cast
+static void write_string(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &s = duckdb::UnifiedVectorFormat::GetData<duckdb::string_t>(col.format)[idx];
+    append_bytes(out, s.GetData(), s.GetSize());
+}
+
+// bytea hex format: \x0a1b...
+static void text_bytea(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    static const char hex[] = "0123456789abcdef";
+    const auto &s = duckdb::UnifiedVectorFormat::GetData<duckdb::string_t>(col.format)[idx];
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(s.GetData());
+    size_t n = s.GetSize();
+    size_t pos = out.size();
+    out.resize(pos + 2 + n * 2);
+    char *dst = out.data() + pos;
+    *dst++ = '\\';
+    *dst++ = 'x';
+    for (size_t i = 0; i < n; i++)
+    {
+        *dst++ = hex[p[i] >> 4];
+        *dst++ = hex[p[i] & 0x0F];
+    }
+}
+
+// Array element needs double quotes in a PG array literal?
+static bool array_elem_needs_quotes(const char *p, size_t n)
+{
+    if (n == 0) return true;
+    if (n == 4 && (p[0] == 'N' || p[0] == 'n') && (p[1] == 'U' || p[1] == 'u') &&
+        (p[2] == 'L' || p[2] == 'l') && (p[3] == 'L' || p[3] == 'l'))
+        return true;
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = p[i];
+        if (c == '{' || c == '}' || c == ',' || c == '"' || c == '\\' ||
+            c == ' ' || c == '\t' || c == '\n' || c == '\r')
+            return true;
+    }
+    return false;
+}
+
+// One-dimensional PG array literal: {1,2,NULL,"a b"}
+static void text_array(std::vector<char> &out, const PGColumn &col, idx_t offset, idx_t length)
+{
+    const PGColumn &elem = *col.element;
+    out.push_back('{');
+    for (idx_t i = 0; i < length; i++)
+    {
+        if (i > 0) out.push_back(',');
+        idx_t eidx = elem.format.sel->get_index(offset + i);
+        if (!elem.format.validity.RowIsValid(eidx))
+        {
+            append_bytes(out, "NULL", 4);
+            continue;
+        }
+        size_t start = out.size();
+        elem.encoder->write(out, elem, eidx);
+        if (!array_elem_needs_quotes(out.data() + start, out.size() - start))
+            continue;
+        std::string raw(out.data() + start, out.size() - start);
+        out.resize(start);
+        out.push_back('"');
+        for (char c : raw)
+        {
+            if (c == '"' || c == '\\') out.push_back('\\');
+            out.push_back(c);
+        }
+        out.push_back('"');
+    }
+    out.push_back('}');
+}
+
+static void text_list(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &entry = duckdb::UnifiedVectorFormat::GetData<duckdb::list_entry_t>(col.format)[idx];
+    text_array(out, col, entry.offset, entry.length);
+}
+
+static void text_fixed_array(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    idx_t size = col.encoder->array_size;
+    text_array(out, col, idx * size, size);
+}
+
+// --- binary writers (network byte order) ---
+static void binary_bool(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    out.push_back(duckdb::UnifiedVectorFormat::GetData<bool>(col.format)[idx] ? 1 : 0);
+}
+
+// int2/int4/int8 from any integer that fits (unsigned types widen one step)
+template <class T>
+static void binary_int2(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    append_i16(out, static_cast<int16_t>(duckdb::UnifiedVectorFormat::GetData<T>(col.format)[idx]));
+}
+
+template <class T>
+static void binary_int4(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    append_i32(out, static_cast<int32_t>(duckdb::UnifiedVectorFormat::GetData<T>(col.format)[idx]));
+}
+
+template <class T>
+static void binary_int8(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    int64_t v = static_cast<int64_t>(duckdb::UnifiedVectorFormat::GetData<T>(col.format)[idx]);
+    append_u64(out, static_cast<uint64_t>(v));
+}
+
+static void binary_float4(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    float f = duckdb::UnifiedVectorFormat::GetData<float>(col.format)[idx];
+    uint32_t i;
+    std::memcpy(&i, &f, 4);
+    append_u32(out, i);
+}
+
+static void binary_float8(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    double d = duckdb::UnifiedVectorFormat::GetData<double>(col.format)[idx];
+    uint64_t u;
+    std::memcpy(&u, &d, 8);
+    append_u64(out, u);
+}
+
+static void binary_date(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    int32_t days = duckdb::UnifiedVectorFormat::GetData<duckdb::date_t>(col.format)[idx].days;
+    // DuckDB's +/-infinity sentinels map onto PG's INT32_MAX / INT32_MIN
+    if (days == INT32_MAX) append_i32(out, INT32_MAX);
+    else if (days == -INT32_MAX) append_i32(out, INT32_MIN);
+    else append_i32(out, days - PG_EPOCH_DAYS);
+}
+
+static void write_pg_timestamp(std::vector<char> &out, int64_t unix_micros)
+{
+    if (unix_micros == INT64_MAX) append_u64(out, static_cast<uint64_t>(INT64_MAX));
+    else if (unix_micros == -INT64_MAX) append_u64(out, static_cast<uint64_t>(INT64_MIN));
+    else append_u64(out, static_cast<uint64_t>(unix_micros - PG_EPOCH_MICROS));
+}
+
+// TIMESTAMP / TIMESTAMP_TZ store microseconds; _SEC/_MS/_NS are rescaled.
+template <int64_t MUL, int64_t DIV>
+static void binary_timestamp(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    int64_t v = duckdb::UnifiedVectorFormat::GetData<duckdb::timestamp_t>(col.format)[idx].value;
+    if (v == INT64_MAX || v == -INT64_MAX)
+    {
+        write_pg_timestamp(out, v);
+        return;
+    }
+    if (DIV > 1)
+    {
+        int64_t q = v / DIV;
+        if (v % DIV < 0) q--; // floor towards -inf
+        v = q;
+    }
+    write_pg_timestamp(out, v * MUL);
+}
+
+static void binary_time(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    append_u64(out, static_cast<uint64_t>(duckdb::UnifiedVectorFormat::GetData<duckdb::dtime_t>(col.format)[idx].micros));
+}
+
+static void binary_timetz(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &v = duckdb::UnifiedVectorFormat::GetData<duckdb::dtime_tz_t>(col.format)[idx];
+    append_u64(out, static_cast<uint64_t>(v.time().micros));
+    // PG stores the zone as seconds *west* of UTC; DuckDB's offset is east.
+    append_i32(out, -v.offset());
+}
+
+static void binary_interval(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &v = duckdb::UnifiedVectorFormat::GetData<duckdb::interval_t>(col.format)[idx];
+    append_u64(out, static_cast<uint64_t>(v.micros));
+    append_i32(out, v.days);
+    append_i32(out, v.months);
+}
+
+static void binary_uuid(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &v = duckdb::UnifiedVectorFormat::GetData<duckdb::hugeint_t>(col.format)[idx];
+    // DuckDB flips the top bit so UUIDs sort as signed hugeints
+    append_u64(out, static_cast<uint64_t>(v.upper) ^ (uint64_t(1) << 63));
+    append_u64(out, v.lower);
+}
+
+// PG numeric: int16 ndigits, int16 weight, uint16 sign, int16 dscale,
+// then ndigits base-10000 digits. digits/ndigits is the decimal magnitude
+// without sign or point; the last scale digits are the fraction.
+static void write_pg_numeric(std::vector<char> &out, bool negative, const char *digits, size_t ndigits, int scale)
+{
+    int int_len = static_cast<int>(ndigits) - scale; // digits before the point, may be <= 0
+    // Decimal digit at position p relative to the point: p < 0 is the integer
+    // part (-1 = units), p >= 0 the fraction. Out-of-range positions are zero
+    // padding, which aligns both sides on base-10000 group boundaries.
+    auto digit_at = [&](int p) -> int
+    {
+        int i = int_len + p;
+        return (i < 0 || i >= static_cast<int>(ndigits)) ? 0 : digits[i] - '0';
+    };
+    int int_groups = int_len > 0 ? (int_len + 3) / 4 : 0;
+    int frac_groups = (scale + 3) / 4;
+    int16_t groups[32];
+    int ngroups = 0;
+    for (int g = 0; g < int_groups + frac_groups && ngroups < 32; g++)
+    {
+        int p0 = (g - int_groups) * 4;
+        int v = 0;
+        for (int k = 0; k < 4; k++)
+            v = v * 10 + digit_at(p0 + k);
+        groups[ngroups++] = static_cast<int16_t>(v);
+    }
+    int weight = int_groups - 1;
+    int first = 0;
+    while (first < ngroups && groups[first] == 0)
+    {
+        first++;
+        weight--;
+    }
+    int last = ngroups;
+    while (last > first && groups[last - 1] == 0) last--;
+    if (first == last)
+    {
+        weight = 0;
+        negative = false;
+    }
+    append_i16(out, static_cast<int16_t>(last - first));
+    append_i16(out, static_cast<int16_t>(weight));
+    append_u16(out, negative ? 0x4000 : 0x0000);
+    append_i16(out, static_cast<int16_t>(scale));
+    for (int g = first; g < last; g++)
+        append_i16(out, groups[g]);
+}
+
+// Integer-backed DECIMALs (and UBIGINT with scale 0) without going through text
+template <class T>
+static void binary_numeric_integer(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    typedef typename std::make_unsigned<T>::type U;
+    T v = duckdb::UnifiedVectorFormat::GetData<T>(col.format)[idx];
+    bool neg = v < 0;
+    U u = neg ? static_cast<U>(U(0) - static_cast<U>(v)) : static_cast<U>(v);
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    do
+    {
+        *--p = static_cast<char>('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    write_pg_numeric(out, neg, p, end - p, col.encoder->scale);
+}
+
+// HUGEINT/UHUGEINT and hugeint-backed DECIMALs, from their VARCHAR rendering
+static void binary_numeric_text(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &s = duckdb::UnifiedVectorFormat::GetData<duckdb::string_t>(col.format)[idx];
+    const char *p = s.GetData();
+    size_t n = s.GetSize();
+    bool neg = false;
+    if (n > 0 && (*p == '-' || *p == '+'))
+    {
+        neg = *p == '-';
+        p++;
+        n--;
+    }
+    char buf[48];
+    size_t nd = 0;
+    int scale = 0;
+    bool frac = false;
+    for (size_t i = 0; i < n && nd < sizeof(buf); i++)
+    {
+        if (p[i] == '.') { frac = true; continue; }
+        buf[nd++] = p[i];
+        if (frac) scale++;
+    }
+    write_pg_numeric(out, neg, buf, nd, scale);
+}
+
+// One-dimensional PG binary array: ndim, has_null, elem oid, [size, lbound], elements
+static void binary_array(std::vector<char> &out, const PGColumn &col, idx_t offset, idx_t length)
+{
+    const PGColumn &elem = *col.element;
+    const PGColumnEncoder &enc = *elem.encoder;
+    bool has_null = false;
+    for (idx_t i = 0; i < length; i++)
+    {
+        if (!elem.format.validity.RowIsValid(elem.format.sel->get_index(offset + i)))
+        {
+            has_null = true;
+            break;
+        }
+    }
+    append_i32(out, length > 0 ? 1 : 0);
+    append_i32(out, has_null ? 1 : 0);
+    append_u32(out, col.encoder->elem_oid);
+    if (length == 0) return;
+    append_i32(out, static_cast<int32_t>(length));
+    append_i32(out, 1);
+    for (idx_t i = 0; i < length; i++)
+    {
+        idx_t eidx = elem.format.sel->get_index(offset + i);
+        if (!elem.format.validity.RowIsValid(eidx))
+        {
+            append_i32(out, -1);
+            continue;
+        }
+        if (enc.fixed_len >= 0)
+        {
+            append_i32(out, enc.fixed_len);
+            enc.write(out, elem, eidx);
+            continue;
+        }
+        size_t len_pos = out.size();
+        append_i32(out, 0);
+        enc.write(out, elem, eidx);
+        patch_i32(out, len_pos, static_cast<int32_t>(out.size() - len_pos - 4));
+    }
+}
+
+static void binary_list(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    const auto &entry = duckdb::UnifiedVectorFormat::GetData<duckdb::list_entry_t>(col.format)[idx];
+    binary_array(out, col, entry.offset, entry.length);
+}
+
+static void binary_fixed_array(std::vector<char> &out, const PGColumn &col, idx_t idx)
+{
+    idx_t size = col.encoder->array_size;
+    binary_array(out, col, idx * size, size);
+}
+
+static PGColumnEncoder make_encoder(const duckdb::LogicalType &type, int16_t format);
+
+// Lists/arrays of scalars become one-dimensional PG arrays; anything
+// nested deeper keeps the text OID and DuckDB's own rendering.
+static bool make_array_encoder(PGColumnEncoder &enc, const duckdb::LogicalType &type)
+{
+    bool is_list = type.id() == duckdb::LogicalTypeId::LIST;
+    const auto &child = is_list ? duckdb::ListType::GetChildType(type) : duckdb::ArrayType::GetChildType(type);
+    uint32_t elem_oid = pg_type_oid(child);
+    if (pg_array_oid(elem_oid) == 0) return false;
+    enc.elem_oid = elem_oid;
+    enc.element = std::make_shared<PGColumnEncoder>(make_encoder(child, enc.format));
+    if (is_list)
+        enc.write = enc.format == 0 ? text_list : binary_list;
+    else
+    {
+        enc.array_size = duckdb::ArrayType::GetSize(type);
+        enc.write = enc.format == 0 ? text_fixed_array : binary_fixed_array;
+    }
+    return true;
+}
+
+static PGColumnEncoder make_text_encoder(const duckdb::LogicalType &type)
+{
+    PGColumnEncoder enc;
+    enc.format = 0;
+    switch (type.id())
+    {
+    case duckdb::LogicalTypeId::BOOLEAN:   enc.fixed_len = 1; enc.write = text_bool; return enc;
+    case duckdb::LogicalTypeId::TINYINT:   enc.write = text_integer<int8_t>; return enc;
+    case duckdb::LogicalTypeId::SMALLINT:  enc.write = text_integer<int16_t>; return enc;
+    case duckdb::LogicalTypeId::INTEGER:   enc.write = text_integer<int32_t>; return enc;
+    case duckdb::LogicalTypeId::BIGINT:    enc.write = text_integer<int64_t>; return enc;
+    case duckdb::LogicalTypeId::UTINYINT:  enc.write = text_integer<uint8_t>; return enc;
+    case duckdb::LogicalTypeId::USMALLINT: enc.write = text_integer<uint16_t>; return enc;
+    case duckdb::LogicalTypeId::UINTEGER:  enc.write = text_integer<uint32_t>; return enc;
+    case duckdb::LogicalTypeId::UBIGINT:   enc.write = text_integer<uint64_t>; return enc;
+    case duckdb::LogicalTypeId::VARCHAR:   enc.write = write_string; return enc;
+    case duckdb::LogicalTypeId::BLOB:      enc.write = text_bytea; return enc;
+    case duckdb::LogicalTypeId::LIST:
+    case duckdb::LogicalTypeId::ARRAY:
+        if (make_array_encoder(enc, type)) return enc;
+        break;
+    default:
+        break;
+    }
+    // Everything else is rendered by DuckDB's vectorised VARCHAR cast,
+    // which matches Value::ToString() without boxing each cell.
+    enc.cast_to_text = true;
+    enc.write = write_string;
+    return enc;
+}
+
+static PGColumnEncoder make_binary_encoder(const duckdb::LogicalType &type)
+{
+    PGColumnEncoder enc;
+    enc.format = 1;
+    switch (type.id())
+    {
+    case duckdb::LogicalTypeId::BOOLEAN:   enc.fixed_len = 1; enc.write = binary_bool; return enc;
+    case duckdb::LogicalTypeId::TINYINT:   enc.fixed_len = 2; enc.write = binary_int2<int8_t>; return enc;
+    case duckdb::LogicalTypeId::UTINYINT:  enc.fixed_len = 2; enc.write = binary_int2<uint8_t>; return enc;
+    case duckdb::LogicalTypeId::SMALLINT:  enc.fixed_len = 2; enc.write = binary_int2<int16_t>; return enc;
+    case duckdb::LogicalTypeId::USMALLINT: enc.fixed_len = 4; enc.write = binary_int4<uint16_t>; return enc;
+    case duckdb::LogicalTypeId::INTEGER:   enc.fixed_len = 4; enc.write = binary_int4<int32_t>; return enc;
+    case duckdb::LogicalTypeId::UINTEGER:  enc.fixed_len = 8; enc.write = binary_int8<uint32_t>; return enc;
+    case duckdb::LogicalTypeId::BIGINT:    enc.fixed_len = 8; enc.write = binary_int8<int64_t>; return enc;
+    case duckdb::LogicalTypeId::FLOAT:     enc.fixed_len = 4; enc.write = binary_float4; return enc;
+    case duckdb::LogicalTypeId::DOUBLE:    enc.fixed_len = 8; enc.write = binary_float8; return enc;
+    case duckdb::LogicalTypeId::DATE:      enc.fixed_len = 4; enc.write = binary_date; return enc;
+    case duckdb::LogicalTypeId::TIME:      enc.fixed_len = 8; enc.write = binary_time; return enc;
+    case duckdb::LogicalTypeId::TIME_TZ:   enc.fixed_len = 12; enc.write = binary_timetz; return enc;
+    case duckdb::LogicalTypeId::TIMESTAMP:
+    case duckdb::LogicalTypeId::TIMESTAMP_TZ:
+        enc.fixed_len = 8; enc.write = binary_timestamp<1, 1>; return enc;
+    case duckdb::LogicalTypeId::TIMESTAMP_SEC:
+        enc.fixed_len = 8; enc.write = binary_timestamp<1000000, 1>; return enc;
+    case duckdb::LogicalTypeId::TIMESTAMP_MS:
+        enc.fixed_len = 8; enc.write = binary_timestamp<1000, 1>; return enc;
+    case duckdb::LogicalTypeId::TIMESTAMP_NS:
+        enc.fixed_len = 8; enc.write = binary_timestamp<1, 1000>; return enc;
+    case duckdb::LogicalTypeId::INTERVAL:  enc.fixed_len = 16; enc.write = binary_interval; return enc;
+    case duckdb::LogicalTypeId::UUID:      enc.fixed_len = 16; enc.write = binary_uuid; return enc;
+    case duckdb::LogicalTypeId::VARCHAR:
+    case duckdb::LogicalTypeId::BLOB:
+        enc.write = write_string;
+        return enc;
+    case duckdb::LogicalTypeId::UBIGINT:
+        enc.write = binary_numeric_integer<uint64_t>;
+        return enc;
+    case duckdb::LogicalTypeId::DECIMAL:
+        enc.scale = duckdb::DecimalType::GetScale(type);
+        switch (type.InternalType())
+        {
+        case duckdb::PhysicalType::INT16: enc.write = binary_numeric_integer<int16_t>; return enc;
+        case duckdb::PhysicalType::INT32: enc.write = binary_numeric_integer<int32_t>; return enc;
+        case duckdb::PhysicalType::INT64: enc.write = binary_numeric_integer<int64_t>; return enc;
+        default: break;
+        }
+        enc.cast_to_text = true;
+        enc.write = binary_numeric_text;
+        return enc;
+    case duckdb::LogicalTypeId::HUGEINT:
+    case duckdb::LogicalTypeId::UHUGEINT:
+        enc.cast_to_text = true;
+        enc.write = binary_numeric_text;
+        return enc;
+    case duckdb::LogicalTypeId::LIST:
+    case duckdb::LogicalTypeId::ARRAY:
+        if (make_array_encoder(enc, type)) return enc;
+        break;
+    default:
+        break;
+    }
+    // Types advertised as text (ENUM, STRUCT, MAP, nested lists, ...): the
+    // binary form of text is its bytes.
+    enc.cast_to_text = true;
+    enc.write = write_string;
+    return enc;
+}
+
+static PGColumnEncoder make_encoder(const duckdb::LogicalType &type, int16_t format)
+{
+    return format == 0 ? make_text_encoder(type) : make_binary_encoder(type);
+}
+
+std::vector<PGColumnEncoder> make_column_encoders(const duckdb::vector<duckdb::LogicalType> &types,
+                                                  const std::vector<int16_t> &formats)
+{
+    std::vector<PGColumnEncoder> encoders;
+    encoders.reserve(types.size());
+    for (size_t i = 0; i < types.size(); i++)
+    {
+        int16_t fmt = 0;
+        if (formats.size() == 1) fmt = formats[0];
+        else if (i < formats.size()) fmt = formats[i];
+        encoders.push_back(make_encoder(types[i], fmt));
+    }
+    return encoders;
+}
+
+// Resolve a vector (and, for lists/arrays, its child) into unified format.
+static void prepare_column(PGColumn &col, duckdb::Vector &vec, idx_t count, const PGColumnEncoder &enc)
+{
+    col.encoder = &enc;
+    if (enc.cast_to_text)
+    {
+        col.text = duckdb::make_uniq<duckdb::Vector>(duckdb::LogicalType::VARCHAR, count);
+        duckdb::VectorOperations::DefaultCast(vec, *col.text, count);
+        col.text->ToUnifiedFormat(count, col.format);
+        return;
+    }
+    vec.ToUnifiedFormat(count, col.format);
+    if (enc.element)
+    {
+        col.element = duckdb::make_uniq<PGColumn>();
+        if (vec.GetType().id() == duckdb::LogicalTypeId::LIST)
+            prepare_column(*col.element, duckdb::ListVector::GetEntry(vec),
+                           duckdb::ListVector::GetListSize(vec), *enc.element);
+        else
+            prepare_column(*col.element, duckdb::ArrayVector::GetEntry(vec),
+                           duckdb::ArrayVector::GetTotalSize(vec), *enc.element);
+    }
+}
+
+void encode_data_rows(std::vector<char> &out, duckdb::DataChunk &chunk,
+                      const std::vector<PGColumnEncoder> &encoders, idx_t begin, idx_t end)
+{
+    idx_t ncols = chunk.ColumnCount();
+    idx_t count = chunk.size();
+    std::vector<PGColumn> cols(ncols);
+    for (idx_t c = 0; c < ncols; c++)
+        prepare_column(cols[c], chunk.data[c], count, encoders[c]);
+
+    for (idx_t row = begin; row < end; row++)
+    {
+        size_t msg_pos = begin_message(out, 'D');
+        append_u16(out, static_cast<uint16_t>(ncols));
+        for (idx_t c = 0; c < ncols; c++)
+        {
+            const auto &col = cols[c];
+            const auto &enc = encoders[c];
+            idx_t idx = col.format.sel->get_index(row);
+            if (!col.format.validity.RowIsValid(idx))
+            {
+                append_i32(out, -1);
+                continue;
+            }
+            if (enc.fixed_len >= 0)
+            {
+                append_i32(out, enc.fixed_len);
+                enc.write(out, col, idx);
+                continue;
+            }
+            size_t len_pos = out.size();
+            append_i32(out, 0);
+            enc.write(out, col, idx);
+            patch_i32(out, len_pos, static_cast<int32_t>(out.size() - len_pos - 4));
+        }
+        end_message(out, msg_pos);
+    }
+}
+
+PGChunkCells::PGChunkCells(duckdb::DataChunk &chunk, const std::vector<PGColumnEncoder> &encoders)
+    : cols_(new PGColumn[chunk.ColumnCount()])
+{
+    for (idx_t c = 0; c < chunk.ColumnCount(); c++)
+        prepare_column(cols_[c], chunk.data[c], chunk.size(), encoders[c]);
+}
+
+PGChunkCells::~PGChunkCells() = default;
+
+bool PGChunkCells::write(std::vector<char> &out, idx_t col, idx_t row) const
+{
+    const auto &column = cols_[col];
+    idx_t idx = column.format.sel->get_index(row);
+    if (!column.format.validity.RowIsValid(idx)) return false;
+    column.encoder->write(out, column, idx);
+    return true;
+}
+
+// --- Bind parameter decoding ---
+duckdb::LogicalType pg_oid_to_type(uint32_t oid)
+{
+    switch (oid)
+    {
+    case 16:   return duckdb::LogicalType::BOOLEAN;
+    case 17:   return duckdb::LogicalType::BLOB;
+    case 20:   return duckdb::LogicalType::BIGINT;
+    case 21:   return duckdb::LogicalType::SMALLINT;
+    case 23:   return duckdb::LogicalType::INTEGER;
+    case 700:  return duckdb::LogicalType::FLOAT;
+    case 701:  return duckdb::LogicalType::DOUBLE;
+    case 18:
+    case 19:
+    case 25:
+    case 1042:
+    case 1043: return duckdb::LogicalType::VARCHAR;
+    case 1082: return duckdb::LogicalType::DATE;
+    case 1083: return duckdb::LogicalType::TIME;
+    case 1114: return duckdb::LogicalType::TIMESTAMP;
+    case 1184: return duckdb::LogicalType::TIMESTAMP_TZ;
+    case 1186: return duckdb::LogicalType::INTERVAL;
+    case 1266: return duckdb::LogicalType::TIME_TZ;
+    case 2950: return duckdb::LogicalType::UUID;
+    case 1700: return duckdb::LogicalType::DECIMAL(38, 10);
+    default:   break;
+    }
+    switch (oid)
+    {
+    case 1000: case 1001: case 1005: case 1007: case 1009: case 1014: case 1015: case 1016:
+    case 1021: case 1022: case 1115: case 1182: case 1183: case 1185: case 1187: case 1231:
+    case 1270: case 2951:
+        return duckdb::LogicalType::LIST(pg_oid_to_type(pg_array_elem_oid(oid)));
+    default:
+        return duckdb::LogicalType(duckdb::LogicalTypeId::INVALID);
+    }
+}
+
+uint32_t pg_array_elem_oid(uint32_t array_oid)
+{
+    static const uint32_t elems[] = {16, 17, 18, 20, 21, 23, 25, 26, 700, 701, 1042, 1043,
+                                     1082, 1083, 1114, 1184, 1186, 1266, 1700, 2950};
+    for (uint32_t e : elems)
+        if (pg_array_oid(e) == array_oid) return e;
+    return 0;
+}
+
+static bool type_is_known(const duckdb::LogicalType &t)
+{
+    return t.id() != duckdb::LogicalTypeId::INVALID && t.id() != duckdb::LogicalTypeId::UNKNOWN &&
+           t.id() != duckdb::LogicalTypeId::ANY && t.id() != duckdb::LogicalTypeId::SQLNULL;
+}
+
+static inline uint16_t read_u16(const char *p)
+{
+    uint16_t n;
+    std::memcpy(&n, p, 2);
+    return ntohs(n);
+}
+static inline uint32_t read_u32(const char *p)
+{
+    uint32_t n;
+    std::memcpy(&n, p, 4);
+    return ntohl(n);
+}
+static inline uint64_t read_u64(const char *p)
+{
+    return (static_cast<uint64_t>(read_u32(p)) << 32) | read_u32(p + 4);
+}
+
+// Parse a (possibly signed, blank-padded) decimal integer without copying.
+static bool parse_int64(const char *p, size_t n, int64_t &out)
+{
+    size_t i = 0;
+    while (i < n && std::isspace(static_cast<unsigned char>(p[i]))) i++;
+    while (n > i && std::isspace(static_cast<unsigned char>(p[n - 1]))) n--;
+    bool neg = false;
+    if (i < n && (p[i] == '-' || p[i] == '+'))
+    {
+        neg = p[i] == '-';
+        i++;
+    }
+    if (i == n) return false;
+    uint64_t v = 0;
+    for (; i < n; i++)
+    {
+        if (p[i] < '0' || p[i] > '9') return false;
+        uint64_t d = static_cast<uint64_t>(p[i] - '0');
+        if (v > (static_cast<uint64_t>(INT64_MAX) + (neg ? 1 : 0) - d) / 10) return false;
+        v = v * 10 + d;
+    }
+    out = neg ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+    return true;
+}
+
+static bool parse_double(const char *p, size_t n, double &out)
+{
+    char buf[64];
+    std::string big;
+    const char *s;
+    if (n < sizeof(buf))
+    {
+        std::memcpy(buf, p, n);
+        buf[n] = '\0';
+        s = buf;
+    }
+    else
+    {
+        big.assign(p, n);
+        s = big.c_str();
+    }
+    char *end = nullptr;
+    out = std::strtod(s, &end);
+    if (end == s) return false;
+    while (*end && std::isspace(static_cast<unsigned char>(*end))) end++;
+    return *end == '\0';
+}
+
+static duckdb::Value read_string(const char *data, int32_t len, const PGParamDecoder &)
+{
+    return duckdb::Value(std::string(data, len));
+}
+
+// --- text format readers ---
+static duckdb::Value read_text_bool(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len > 0)
+    {
+        switch (data[0])
+        {
+        case 't': case 'T': case 'y': case 'Y': case '1':
+            return duckdb::Value::BOOLEAN(true);
+        case 'f': case 'F': case 'n': case 'N': case '0':
+            return duckdb::Value::BOOLEAN(false);
+        case 'o': case 'O': // on / off
+            if (len > 1) return duckdb::Value::BOOLEAN(data[1] == 'n' || data[1] == 'N');
+            break;
+        default:
+            break;
+        }
+    }
+    return read_string(data, len, dec);
+}
+
+template <class T>
+static duckdb::Value make_integer_value(T v);
+template <> duckdb::Value make_integer_value<int8_t>(int8_t v) { return duckdb::Value::TINYINT(v); }
+template <> duckdb::Value make_integer_value<int16_t>(int16_t v) { return duckdb::Value::SMALLINT(v); }
+template <> duckdb::Value make_integer_value<int32_t>(int32_t v) { return duckdb::Value::INTEGER(v); }
+template <> duckdb::Value make_integer_value<int64_t>(int64_t v) { return duckdb::Value::BIGINT(v); }
+
+template <class T>
+static duckdb::Value read_text_integer(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    int64_t v;
+    if (parse_int64(data, len, v) && v >= std::numeric_limits<T>::min() && v <= std::numeric_limits<T>::max())
+        return make_integer_value<T>(static_cast<T>(v));
+    return read_string(data, len, dec);
+}
+
+static duckdb::Value read_text_float4(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    double d;
+    if (parse_double(data, len, d)) return duckdb::Value::FLOAT(static_cast<float>(d));
+    return read_string(data, len, dec);
+}
+
+static duckdb::Value read_text_float8(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    double d;
+    if (parse_double(data, len, d)) return duckdb::Value::DOUBLE(d);
+    return read_string(data, len, dec);
+}
+
+// Unknown type (OID 0, no expected type): infer integers and floats from the
+// text, since they get mis-parsed as strings otherwise.
+static duckdb::Value read_text_infer(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    int64_t v;
+    if (parse_int64(data, len, v))
+    {
+        if (v >= INT32_MIN && v <= INT32_MAX) return duckdb::Value::INTEGER(static_cast<int32_t>(v));
+        return duckdb::Value::BIGINT(v);
+    }
+    bool numeric = len > 0;
+    bool has_digit = false;
+    for (int32_t i = 0; i < len && numeric; i++)
+    {
+        char c = data[i];
+        if (c >= '0' && c <= '9') has_digit = true;
+        else if (c != '.' && c != 'e' && c != 'E' && c != '-' && c != '+') numeric = false;
+    }
+    double d;
+    if (numeric && has_digit && parse_double(data, len, d)) return duckdb::Value::DOUBLE(d);
+    return read_string(data, len, dec);
+}
+
+// Text array literal {a,"b c",NULL}; one dimension, elements decoded with
+// the element decoder.
+static duckdb::Value read_text_array(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    const PGParamDecoder &elem = *dec.element;
+    duckdb::vector<duckdb::Value> values;
+    int32_t i = 0;
+    while (i < len && data[i] != '{') i++;
+    if (i == len) return read_string(data, len, dec);
+    i++;
+    std::string item;
+    while (i < len && data[i] != '}')
+    {
+        while (i < len && std::isspace(static_cast<unsigned char>(data[i]))) i++;
+        item.clear();
+        bool quoted = false;
+        if (i < len && data[i] == '"')
+        {
+            quoted = true;
+            i++;
+            while (i < len && data[i] != '"')
+            {
+                if (data[i] == '\\' && i + 1 < len) i++;
+                item.push_back(data[i++]);
+            }
+            i++; // closing quote
+        }
+        else
+        {
+            while (i < len && data[i] != ',' && data[i] != '}')
+            {
+                if (data[i] == '\\' && i + 1 < len) i++;
+                item.push_back(data[i++]);
+            }
+            while (!item.empty() && std::isspace(static_cast<unsigned char>(item.back()))) item.pop_back();
+        }
+        if (!quoted && (item == "NULL" || item == "null"))
+            values.push_back(duckdb::Value(elem.target));
+        else
+            values.push_back(decode_param(elem, item.data(), static_cast<int32_t>(item.size())));
+        while (i < len && data[i] != ',' && data[i] != '}') i++;
+        if (i < len && data[i] == ',') i++;
+    }
+    return duckdb::Value::LIST(elem.target, std::move(values));
+}
+
+// --- binary format readers ---
+static duckdb::Value read_binary_bool(const char *data, int32_t len, const PGParamDecoder &)
+{
+    return duckdb::Value::BOOLEAN(len > 0 && data[0] != 0);
+}
+
+static duckdb::Value read_binary_int2(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 2) return read_string(data, len, dec);
+    return duckdb::Value::SMALLINT(static_cast<int16_t>(read_u16(data)));
+}
+
+static duckdb::Value read_binary_int4(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 4) return read_string(data, len, dec);
+    return duckdb::Value::INTEGER(static_cast<int32_t>(read_u32(data)));
+}
+
+static duckdb::Value read_binary_int8(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 8) return read_string(data, len, dec);
+    return duckdb::Value::BIGINT(static_cast<int64_t>(read_u64(data)));
+}
+
+static duckdb::Value read_binary_float4(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 4) return read_string(data, len, dec);
+    uint32_t i = read_u32(data);
+    float f;
+    std::memcpy(&f, &i, 4);
+    return duckdb::Value::FLOAT(f);
+}
+
+static duckdb::Value read_binary_float8(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 8) return read_string(data, len, dec);
+    uint64_t i = read_u64(data);
+    double d;
+    std::memcpy(&d, &i, 8);
+    return duckdb::Value::DOUBLE(d);
+}
+
+static duckdb::Value read_binary_bytea(const char *data, int32_t len, const PGParamDecoder &)
+{
+    return duckdb::Value::BLOB(reinterpret_cast<duckdb::const_data_ptr_t>(data), static_cast<idx_t>(len));
+}
+
+static duckdb::Value read_binary_date(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 4) return read_string(data, len, dec);
+    int32_t days = static_cast<int32_t>(read_u32(data));
+    if (days == INT32_MAX) return duckdb::Value::DATE(duckdb::date_t(INT32_MAX));
+    if (days == INT32_MIN) return duckdb::Value::DATE(duckdb::date_t(-INT32_MAX));
+    return duckdb::Value::DATE(duckdb::date_t(days + PG_EPOCH_DAYS));
+}
+
+static int64_t pg_to_unix_micros(int64_t pg_micros)
+{
+    if (pg_micros == INT64_MAX) return INT64_MAX;
+    if (pg_micros == INT64_MIN) return -INT64_MAX;
+    return pg_micros + PG_EPOCH_MICROS;
+}
+
+static duckdb::Value read_binary_timestamp(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 8) return read_string(data, len, dec);
+    return duckdb::Value::TIMESTAMP(duckdb::timestamp_t(pg_to_unix_micros(static_cast<int64_t>(read_u64(data)))));
+}
+
+static duckdb::Value read_binary_timestamptz(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 8) return read_string(data, len, dec);
+    duckdb::timestamp_t ts(pg_to_unix_micros(static_cast<int64_t>(read_u64(data))));
+    return duckdb::Value::TIMESTAMPTZ(duckdb::timestamp_tz_t(ts));
+}
+
+static duckdb::Value read_binary_time(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 8) return read_string(data, len, dec);
+    return duckdb::Value::TIME(duckdb::dtime_t(static_cast<int64_t>(read_u64(data))));
+}
+
+static duckdb::Value read_binary_interval(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 16) return read_string(data, len, dec);
+    duckdb::interval_t iv;
+    iv.micros = static_cast<int64_t>(read_u64(data));
+    iv.days = static_cast<int32_t>(read_u32(data + 8));
+    iv.months = static_cast<int32_t>(read_u32(data + 12));
+    return duckdb::Value::INTERVAL(iv);
+}
+
+static duckdb::Value read_binary_uuid(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len != 16) return read_string(data, len, dec);
+    duckdb::hugeint_t v;
+    v.upper = static_cast<int64_t>(read_u64(data) ^ (uint64_t(1) << 63));
+    v.lower = read_u64(data + 8);
+    return duckdb::Value::UUID(v);
+}
+
+// Binary numeric -> decimal text, then cast to the expected DECIMAL (exact).
+static duckdb::Value read_binary_numeric(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    if (len < 8) return read_string(data, len, dec);
+    int ndigits = static_cast<int16_t>(read_u16(data));
+    int weight = static_cast<int16_t>(read_u16(data + 2));
+    uint16_t sign = read_u16(data + 4);
+    int dscale = static_cast<int16_t>(read_u16(data + 6));
+    // Special values carry no digits
+    if (sign == 0xC000) return duckdb::Value(std::string("NaN"));
+    if (sign == 0xD000) return duckdb::Value(std::string("Infinity"));
+    if (sign == 0xF000) return duckdb::Value(std::string("-Infinity"));
+    if ((sign != 0 && sign != 0x4000) || ndigits < 0 || len < 8 + ndigits * 2)
+        return read_string(data, len, dec);
+    std::string s;
+    if (sign == 0x4000) s.push_back('-');
+    // integer part: groups 0..weight
+    if (weight < 0) s.push_back('0');
+    for (int g = 0; g <= weight; g++)
+    {
+        int v = g < ndigits ? static_cast<int16_t>(read_u16(data + 8 + g * 2)) : 0;
+        char buf[5];
+        snprintf(buf, sizeof(buf), g == 0 ? "%d" : "%04d", v);
+        s += buf;
+    }
+    if (dscale > 0)
+    {
+        s.push_back('.');
+        std::string frac;
+        for (int g = weight + 1; static_cast<int>(frac.size()) < dscale; g++)
+        {
+            int v = (g >= 0 && g < ndigits) ? static_cast<int16_t>(read_u16(data + 8 + g * 2)) : 0;
+            char buf[5];
+            snprintf(buf, sizeof(buf), "%04d", v);
+            frac += buf;
+        }
+        s.append(frac, 0, dscale);
+    }
+    return duckdb::Value(s);
+}
+
+// One-dimensional binary array: ndim, has_null, elem oid, [size, lbound], elements
+static duckdb::Value read_binary_array(const char *data, int32_t len, const PGParamDecoder &dec)
+{
+    const PGParamDecoder &elem = *dec.element;
+    duckdb::vector<duckdb::Value> values;
+    if (len < 12) return read_string(data, len, dec);
+    int32_t ndim = static_cast<int32_t>(read_u32(data));
+    int32_t pos = 12;
+    if (ndim > 1) return read_string(data, len, dec);
+    int32_t count = 0;
+    if (ndim == 1)
+    {
+        if (len < 20) return read_string(data, len, dec);
+        count = static_cast<int32_t>(read_u32(data + 12));
+        pos = 20;
+    }
+    values.reserve(count);
+    for (int32_t i = 0; i < count; i++)
+    {
+        if (pos + 4 > len) break;
+        int32_t elen = static_cast<int32_t>(read_u32(data + pos));
+        pos += 4;
+        if (elen < 0)
+        {
+            values.push_back(duckdb::Value(elem.target));
+            continue;
+        }
+        if (pos + elen > len) break;
+        values.push_back(decode_param(elem, data + pos, elen));
+        pos += elen;
+    }
+    return duckdb::Value::LIST(elem.target, std::move(values));
+}
+
+static pg_param_reader text_reader_for(const duckdb::LogicalType &t)
+{
+    switch (t.id())
+    {
+    case duckdb::LogicalTypeId::BOOLEAN:  return read_text_bool;
+    case duckdb::LogicalTypeId::TINYINT:  return read_text_integer<int8_t>;
+    case duckdb::LogicalTypeId::SMALLINT: return read_text_integer<int16_t>;
+    case duckdb::LogicalTypeId::INTEGER:  return read_text_integer<int32_t>;
+    case duckdb::LogicalTypeId::BIGINT:   return read_text_integer<int64_t>;
+    case duckdb::LogicalTypeId::FLOAT:    return read_text_float4;
+    case duckdb::LogicalTypeId::DOUBLE:   return read_text_float8;
+    case duckdb::LogicalTypeId::LIST:     return read_text_array;
+    default:                              return read_string;
+    }
+}
+
+static pg_param_reader binary_reader_for(uint32_t oid)
+{
+    switch (oid)
+    {
+    case 16:   return read_binary_bool;
+    case 17:   return read_binary_bytea;
+    case 20:   return read_binary_int8;
+    case 21:   return read_binary_int2;
+    case 23:   return read_binary_int4;
+    case 700:  return read_binary_float4;
+    case 701:  return read_binary_float8;
+    case 1082: return read_binary_date;
+    case 1083: return read_binary_time;
+    case 1114: return read_binary_timestamp;
+    case 1184: return read_binary_timestamptz;
+    case 1186: return read_binary_interval;
+    case 1700: return read_binary_numeric;
+    case 2950: return read_binary_uuid;
+    default:   break;
+    }
+    if (pg_array_elem_oid(oid) != 0) return read_binary_array;
+    // text-like types, and unknown ones: bytes as string
+    return read_string;
+}
+
+PGParamDecoder make_param_decoder(uint32_t type_oid, int16_t format, const duckdb::LogicalType &expected)
+{
+    PGParamDecoder dec;
+    bool expected_known = type_is_known(expected);
+    // Binary values left unspecified (OID 0) are in the expected type's format
+    if (format != 0 && type_oid == 0 && expected_known) type_oid = pg_type_oid(expected);
+    // What the wire value natively decodes to; the expected type wins when
+    // the statement told us one.
+    duckdb::LogicalType wire = pg_oid_to_type(type_oid);
+    if (format == 0)
+    {
+        if (expected_known)
+        {
+            dec.read = text_reader_for(expected);
+            dec.target = expected;
+        }
+        else if (type_oid == 0)
+        {
+            dec.read = read_text_infer;
+            return dec; // nothing to cast to
+        }
+        else
+        {
+            dec.read = text_reader_for(wire);
+            dec.target = wire;
+        }
+    }
+    else
+    {
+        dec.read = binary_reader_for(type_oid);
+        dec.target = expected_known ? expected : wire;
+    }
+    duckdb::LogicalType produced = format == 0 ? dec.target : wire;
+    if (dec.read == read_text_array || dec.read == read_binary_array)
+    {
+        uint32_t elem_oid = pg_array_elem_oid(type_oid);
+        duckdb::LogicalType elem_type = dec.target.id() == duckdb::LogicalTypeId::LIST
+                                            ? duckdb::ListType::GetChildType(dec.target)
+                                            : pg_oid_to_type(elem_oid);
+        dec.element = std::make_shared<PGParamDecoder>(make_param_decoder(elem_oid, format, elem_type));
+        if (!type_is_known(dec.element->target))
+            dec.element->target = duckdb::LogicalType::VARCHAR;
+        produced = duckdb::LogicalType::LIST(dec.element->target);
+    }
+    else if (dec.read == read_string || dec.read == read_binary_numeric)
+    {
+        produced = duckdb::LogicalType::VARCHAR;
+    }
+    else if (dec.read == read_binary_bytea)
+    {
+        produced = duckdb::LogicalType::BLOB;
+    }
+    // Resolve the cast once: readers that already produce the target type
+    // skip it entirely.
+    dec.cast = type_is_known(dec.target) && produced != dec.target;
+    return dec;
+}
+
+duckdb::Value decode_param(const PGParamDecoder &dec, const char *data, int32_t len)
+{
+    if (len < 0) return duckdb::Value(); // NULL
+    duckdb::Value v = dec.read(data, len, dec);
+    if (dec.cast && v.type() != dec.target)
+    {
+        duckdb::Value casted;
+        std::string err;
+        if (!v.DefaultTryCastAs(dec.target, casted, &err))
+            throw ParamError(err.empty() ? "cannot convert " + v.ToString() + " to " + dec.target.ToString() : err);
+        return casted;
+    }
+    return v;
+}
@@ -0,0 +1,505 @@
+#include "query_rewriter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+bool SqlLexer::next(std::string &tok)
+{
+    tok.clear();
+    skip_space();
+    if (p_ == end_) return false;
+    char c = *p_;
+    if (is_punct(c))
+    {
+        tok.push_back(c);
+        p_++;
+    }
+    else if (c == '\'' || c == '"')
+    {
+        // Up to the closing quote; doubled quotes are part of the token
+        const char *start = p_++;
+        while (p_ < end_)
+        {
+            if (*p_++ != c) continue;
+            if (p_ < end_ && *p_ == c) p_++;
+            else break;
+        }
+        tok.assign(start, p_);
+    }
+    else
+    {
+        while (p_ < end_ && !std::isspace((unsigned char)*p_) && !is_punct(*p_) && *p_ != '\'' && *p_ != '"')
+            tok.push_back((char)std::tolower((unsigned char)*p_++));
+    }
+    return true;
+}
+
+void SqlLexer::skip_space()
+{
+    while (p_ < end_)
+    {
+        if (std::isspace((unsigned char)*p_))
+            p_++;
+        else if (*p_ == '-' && p_ + 1 < end_ && p_[1] == '-')
+        {
+            auto nl = static_cast<const char *>(std::memchr(p_, '\n', end_ - p_));
+            p_ = nl ? nl + 1 : end_;
+        }
+        else if (*p_ == '/' && p_ + 1 < end_ && p_[1] == '*')
+        {
+            std::string_view rest(p_ + 2, end_ - p_ - 2);
+            size_t close = rest.find("*/");
+            p_ = close == std::string_view::npos ? end_ : p_ + 2 + close + 2;
+        }
+        else
+            break;
+    }
+}
+
+namespace
+{
+
+// Command forms, by their leading keywords
+enum Form
+{
+    NO_FORM,
+    BEGIN_FORM,             // BEGIN ..., START TRANSACTION ...
+    COMMIT_FORM,            // COMMIT ...
+    END_FORM,               // END
+    ROLLBACK_FORM,          // ROLLBACK ...
+    ABORT_FORM,             // ABORT
+    SET_FORM,
+    RESET_FORM,
+    DROP_TABLE_FORM,
+    TRUNCATE_FORM,
+};
+
+struct TrieNode
+{
+    std::unordered_map<std::string, std::unique_ptr<TrieNode>> next;
+    Form form = NO_FORM;
+};
+
+struct ExactRule
+{
+    RewriteRule rule;
+    std::string sql;
+    const ConstantAnswer *answer;
+};
+
+struct RuleTable
+{
+    // Bootstrap queries by their lower-cased text (trailing ; removed)
+    std::unordered_map<std::string, ExactRule> exact;
+    size_t max_exact_length = 0;
+    TrieNode commands;
+
+    void add(std::string text, RewriteRule rule, std::string sql = std::string(),
+             const ConstantAnswer *answer = nullptr)
+    {
+        max_exact_length = std::max(max_exact_length, text.size());
+        exact.emplace(std::move(text), ExactRule{rule, std::move(sql), answer});
+    }
+
+    void add(std::initializer_list<const char *> keywords, Form form)
+    {
+        TrieNode *node = &commands;
+        for (auto kw : keywords)
+        {
+            auto &child = node->next[kw];
+            if (!child) child.reset(new TrieNode());
+            node = child.get();
+        }
+        node->form = form;
+    }
+};
+
+const RuleTable &rule_table()
+{
+    static const RuleTable table = []()
+    {
+        RuleTable t;
+        const ConstantAnswer *answer = constant_answers().data();
+        t.add("select 1", RewriteRule::KEEP, std::string(), &answer[0]);
+        t.add("select reset_val from pg_settings where name='polar_compatibility_mode'", RewriteRule::REPLACE,
+              "SELECT 'pg' AS reset_val", &answer[1]);
+        t.add("show transaction isolation level", RewriteRule::REPLACE,
+              "SELECT 'read committed' AS transaction_isolation", &answer[2]);
+        t.add("show transaction_isolation", RewriteRule::REPLACE,
+              "SELECT 'read committed' AS transaction_isolation", &answer[2]);
+        t.add("show standard_conforming_strings", RewriteRule::REPLACE,
+              "SELECT 'on' AS standard_conforming_strings", &answer[3]);
+        t.add("show server_version", RewriteRule::REPLACE, "SELECT '14.0 (PostDuck)' AS server_version",
+              &answer[4]);
+        t.add("show postduck_result_cache", RewriteRule::SHOW_RESULT_CACHE);
+        t.add("show postduck_statement_cache", RewriteRule::SHOW_STATEMENT_CACHE);
+        t.add("show postduck_workload_classes", RewriteRule::SHOW_WORKLOAD_CLASSES);
+        t.add("show postduck_connection_pool", RewriteRule::SHOW_CONNECTION_POOL);
+        t.add("select current_schema()", RewriteRule::REPLACE, "SELECT 'main' AS current_schema", &answer[5]);
+        t.add("select version()", RewriteRule::REPLACE,
+              "SELECT 'PostgreSQL 14.0 (PostDuck on DuckDB) on x86_64-pc-linux-gnu' AS version", &answer[6]);
+
+        t.add({"begin"}, BEGIN_FORM);
+        t.add({"start", "transaction"}, BEGIN_FORM);
+        t.add({"commit"}, COMMIT_FORM);
+        t.add({"end"}, END_FORM);
+        t.add({"rollback"}, ROLLBACK_FORM);
+        t.add({"abort"}, ABORT_FORM);
+        t.add({"set"}, SET_FORM);
+        t.add({"reset"}, RESET_FORM);
+        t.add({"drop", "table"}, DROP_TABLE_FORM);
+        t.add({"truncate"}, TRUNCATE_FORM);
+        return t;
+    }();
+    return table;
+}
+
+// The longest command form starting with tok, the statement's first token;
+// leaves lex after the form's keywords
+Form match_command(SqlLexer &lex, std::string &tok)
+{
+    const TrieNode *node = &rule_table().commands;
+    Form form = NO_FORM;
+    SqlLexer at_form = lex;
+    do
+    {
+        auto it = node->next.find(tok);
+        if (it == node->next.end()) break;
+        node = it->second.get();
+        if (node->form != NO_FORM)
+        {
+            form = node->form;
+            at_form = lex;
+        }
+    } while (lex.next(tok));
+    lex = at_form;
+    return form;
+}
+
+// transaction_kind() of a single statement of the given form
+int transaction_form_kind(Form form, SqlLexer lex)
+{
+    std::string tok;
+    switch (form)
+    {
+    case BEGIN_FORM:
+        return 1;
+    case COMMIT_FORM:
+        return 2;
+    case END_FORM:
+        return lex.next(tok) ? 0 : 2;
+    case ABORT_FORM:
+        return lex.next(tok) ? 0 : 3;
+    case ROLLBACK_FORM:
+        // ROLLBACK TO [SAVEPOINT] name goes through
+        if (lex.next(tok))
+        {
+            if (tok == "to") return 0;
+            do
+                if (tok == "savepoint") return 0;
+            while (lex.next(tok));
+        }
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+bool single_statement(const char *begin, const char *end)
+{
+    return !std::memchr(begin, ';', end - begin);
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && std::isspace((unsigned char)s.front())) s.remove_prefix(1);
+    while (!s.empty() && std::isspace((unsigned char)s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// "a, b, c" in one statement each: prefix + name + ";". False for one name.
+bool split_names(std::string_view names, const char *prefix, std::string &out)
+{
+    if (names.find(',') == std::string_view::npos) return false;
+    out.clear();
+    while (true)
+    {
+        size_t comma = names.find(',');
+        std::string_view name = trim(names.substr(0, comma));
+        if (!name.empty())
+        {
+            if (!out.empty()) out += ' ';
+            out += prefix;
+            out.append(name.data(), name.size());
+            out += ';';
+        }
+        if (comma == std::string_view::npos) break;
+        names.remove_prefix(comma + 1);
+    }
+    return true;
+}
+
+// Settings DuckDB understands; other SETs from PostgreSQL clients (JDBC
+// sends SET extra_float_digits = 3, SET application_name, ...) are no-ops
+const std::unordered_set<std::string> duckdb_settings = {
+    "timezone", "search_path", "memory_limit", "threads",
+    "temp_directory", "allow_unsigned_extensions", "enable_progress_bar",
+    "errors_as_json", "disabled_optimizers"
+};
+
+const char *no_op = "SELECT 1 WHERE FALSE;";
+
+// Rewrites the command of the given form in [begin, end) (trailing ;
+// removed); lex is after the form's keywords
+bool command_rewrite(Form form, SqlLexer lex, const char *begin, const char *end, std::string &out)
+{
+    std::string tok;
+    switch (form)
+    {
+    case BEGIN_FORM:
+    case COMMIT_FORM:
+    case END_FORM:
+    case ROLLBACK_FORM:
+    case ABORT_FORM:
+        // Normalised into forms DuckDB accepts; the session answers them
+        // itself from its transaction state. Several statements in one query
+        // are passed through as they are.
+        if (!single_statement(begin, end)) return false;
+        switch (transaction_form_kind(form, lex))
+        {
+        case 1: out = "BEGIN;"; return true;
+        case 2: out = "COMMIT;"; return true;
+        case 3: out = "ROLLBACK;"; return true;
+        }
+        return false;
+    case SET_FORM:
+        if (!lex.next(tok)) return false;
+        if (tok == "session" || tok == "local")
+        {
+            if (!lex.next(tok)) return false;
+        }
+        if (duckdb_settings.count(tok)) return false;
+        out = no_op;
+        return true;
+    case RESET_FORM:
+        if (!lex.next(tok)) return false;
+        out = no_op;
+        return true;
+    case DROP_TABLE_FORM:
+    {
+        // DuckDB drops one object per DROP (pgbench drops several)
+        bool if_exists = false;
+        SqlLexer probe = lex;
+        if (probe.next(tok) && tok == "if" && probe.next(tok) && tok == "exists")
+        {
+            if_exists = true;
+            lex = probe;
+        }
+        return split_names(std::string_view(lex.pos(), end - lex.pos()),
+                           if_exists ? "DROP TABLE IF EXISTS " : "DROP TABLE ", out);
+    }
+    case TRUNCATE_FORM:
+    {
+        SqlLexer probe = lex;
+        if (probe.next(tok) && tok == "table") lex = probe;
+        return split_names(std::string_view(lex.pos(), end - lex.pos()), "DELETE FROM ", out);
+    }
+    default:
+        return false;
+    }
+}
+
+const char *jdbc_get_tables =
+    "SELECT NULL AS TABLE_CAT, schema_name AS TABLE_SCHEM, table_name AS TABLE_NAME, "
+    "'TABLE' AS TABLE_TYPE, NULL AS REMARKS, "
+    "'' AS TYPE_CAT, '' AS TYPE_SCHEM, '' AS TYPE_NAME, "
+    "'' AS SELF_REFERENCING_COL_NAME, '' AS REF_GENERATION "
+    "FROM duckdb_tables() "
+    "UNION ALL "
+    "SELECT NULL, schema_name, view_name, 'VIEW', NULL, '', '', '', '', '' FROM duckdb_views() WHERE internal = false "
+    "ORDER BY TABLE_TYPE, TABLE_SCHEM, TABLE_NAME";
+
+const char *jdbc_get_schemas =
+    "SELECT schema_name AS TABLE_SCHEM, catalog_name AS TABLE_CATALOG FROM duckdb_schemas() ORDER BY TABLE_SCHEM";
+
+const char *jdbc_get_columns =
+    "SELECT NULL AS TABLE_CAT, table_schema AS TABLE_SCHEM, table_name AS TABLE_NAME, "
+    "column_name AS COLUMN_NAME, 0 AS DATA_TYPE, data_type AS TYPE_NAME, "
+    "NULL AS COLUMN_SIZE, NULL AS BUFFER_LENGTH, NULL AS DECIMAL_DIGITS, 10 AS NUM_PREC_RADIX, "
+    "(CASE WHEN is_nullable='YES' THEN 1 ELSE 0 END) AS NULLABLE, NULL AS REMARKS, "
+    "column_default AS COLUMN_DEF, NULL AS SQL_DATA_TYPE, NULL AS SQL_DATETIME_SUB, "
+    "NULL AS CHAR_OCTET_LENGTH, ordinal_position AS ORDINAL_POSITION, "
+    "is_nullable AS IS_NULLABLE, NULL AS SCOPE_CATALOG, NULL AS SCOPE_SCHEMA, "
+    "NULL AS SCOPE_TABLE, NULL AS SOURCE_DATA_TYPE, 'NO' AS IS_AUTOINCREMENT, "
+    "'NO' AS IS_GENERATEDCOLUMN "
+    "FROM information_schema.columns "
+    "ORDER BY TABLE_SCHEM, TABLE_NAME, ORDINAL_POSITION";
+
+// JDBC DatabaseMetaData queries rely on pg_description / regclass / other
+// catalog features DuckDB lacks; they are recognised by characteristic
+// fragments and answered from DuckDB's own catalog functions.
+const char *catalog_rewrite(std::string_view cmp)
+{
+    // getTables: returns a synthetic result from duckdb_tables()
+    if (cmp.find("AS TABLE_CAT, n.nspname AS TABLE_SCHEM, c.relname AS TABLE_NAME") != std::string_view::npos &&
+        cmp.find("pg_catalog.pg_class") != std::string_view::npos)
+        return jdbc_get_tables;
+    // getSchemas: "SELECT nspname AS TABLE_SCHEM, NULL AS TABLE_CATALOG FROM pg_catalog.pg_namespace"
+    if (cmp.find("AS TABLE_SCHEM") != std::string_view::npos &&
+        cmp.find("pg_catalog.pg_namespace") != std::string_view::npos &&
+        cmp.find("TABLE_NAME") == std::string_view::npos)
+        return jdbc_get_schemas;
+    // getColumns queries pg_attribute with complicated joins; a minimal fallback
+    if (cmp.find("pg_catalog.pg_attribute") != std::string_view::npos &&
+        cmp.find("pg_catalog.pg_class") != std::string_view::npos &&
+        cmp.find("a.attname") != std::string_view::npos)
+        return jdbc_get_columns;
+    return nullptr;
+}
+
+// Most recently used results of catalog_rewrite(), by statement hash. The
+// text is kept too, so a hash collision is a miss rather than a wrong
+// rewrite.
+class RewriteMemo
+{
+public:
+    static const size_t capacity = 256;
+    static const size_t max_text = 64 * 1024;
+
+    bool find(size_t hash, std::string_view text, const char *&sql)
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        auto it = index_.find(hash);
+        if (it == index_.end() || it->second->text != text) return false;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        sql = it->second->sql;
+        return true;
+    }
+
+    void insert(size_t hash, std::string_view text, const char *sql)
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        auto it = index_.find(hash);
+        if (it != index_.end())
+        {
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        lru_.push_front(Entry{hash, std::string(text), sql});
+        index_[hash] = lru_.begin();
+        if (lru_.size() > capacity)
+        {
+            index_.erase(lru_.back().hash);
+            lru_.pop_back();
+        }
+    }
+
+private:
+    struct Entry
+    {
+        size_t hash;
+        std::string text;
+        const char *sql;        // null: no rewrite
+    };
+    std::mutex mtx_;
+    std::list<Entry> lru_;
+    std::unordered_map<size_t, std::list<Entry>::iterator> index_;
+};
+
+const char *memoized_catalog_rewrite(std::string_view cmp)
+{
+    // Cheap reject: every catalog query names pg_catalog
+    if (cmp.find("pg_catalog.") == std::string_view::npos) return nullptr;
+    if (cmp.size() > RewriteMemo::max_text) return catalog_rewrite(cmp);
+    static RewriteMemo memo;
+    size_t hash = std::hash<std::string_view>()(cmp);
+    const char *sql;
+    if (memo.find(hash, cmp, sql)) return sql;
+    sql = catalog_rewrite(cmp);
+    memo.insert(hash, cmp, sql);
+    return sql;
+}
+
+} // namespace
+
+// Columns are named and typed as DuckDB would for the rewritten statement
+const std::vector<ConstantAnswer> &constant_answers()
+{
+    static const std::vector<ConstantAnswer> answers = {
+        {0, "1", 23, "1"},
+        {1, "reset_val", 25, "pg"},
+        {2, "transaction_isolation", 25, "read committed"},
+        {3, "standard_conforming_strings", 25, "on"},
+        {4, "server_version", 25, "14.0 (PostDuck)"},
+        {5, "current_schema", 25, "main"},
+        {6, "version", 25, "PostgreSQL 14.0 (PostDuck on DuckDB) on x86_64-pc-linux-gnu"},
+    };
+    return answers;
+}
+
+Rewrite rewrite_statement(const std::string &query)
+{
+    Rewrite r;
+    const char *text = query.data();
+    size_t b = 0, e = query.size();
+    while (b < e && std::isspace((unsigned char)text[b])) b++;
+    while (e > b && std::isspace((unsigned char)text[e - 1])) e--;
+    r.begin = b;
+    r.end = e;
+    if (b == e) return r;
+    // Compared without trailing semicolons
+    size_t ce = e;
+    while (ce > b && (text[ce - 1] == ';' || std::isspace((unsigned char)text[ce - 1]))) ce--;
+
+    const RuleTable &rules = rule_table();
+    if (ce - b <= rules.max_exact_length)
+    {
+        std::string key(text + b, ce - b);
+        for (auto &c : key) c = (char)std::tolower((unsigned char)c);
+        auto it = rules.exact.find(key);
+        if (it != rules.exact.end())
+        {
+            r.rule = it->second.rule;
+            r.sql = it->second.sql;
+            r.answer = it->second.answer;
+            return r;
+        }
+    }
+
+    SqlLexer lex(text + b, text + ce);
+    std::string tok;
+    if (!lex.next(tok)) return r;
+    if (tok == "select")
+    {
+        if (const char *sql = memoized_catalog_rewrite(std::string_view(text + b, ce - b)))
+        {
+            r.rule = RewriteRule::REPLACE;
+            r.sql = sql;
+        }
+        return r;
+    }
+    Form form = match_command(lex, tok);
+    if (form != NO_FORM && command_rewrite(form, lex, text + b, text + ce, r.sql))
+        r.rule = RewriteRule::REPLACE;
+    return r;
+}
+
+int transaction_kind(const std::string &sql)
+{
+    const char *b = sql.data();
+    const char *e = b + sql.size();
+    while (e > b && (e[-1] == ';' || std::isspace((unsigned char)e[-1]))) e--;
+    SqlLexer lex(b, e);
+    std::string tok;
+    if (!lex.next(tok) || !single_statement(b, e)) return 0;
+    Form form = match_command(lex, tok);
+    return transaction_form_kind(form, lex);
+}
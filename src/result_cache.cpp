@@ -0,0 +1,166 @@
+#include "result_cache.hpp"
+
+#include <cctype>
+#include <boost/algorithm/string.hpp>
+
+// A single entry may use at most this fraction of the capacity
+static const size_t max_entry_share = 8;
+
+ResultCache &result_cache()
+{
+    static ResultCache cache;
+    return cache;
+}
+
+void ResultCache::set_capacity(size_t bytes)
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    capacity_ = bytes;
+    while (!lru_.empty() && stats_.bytes > capacity_)
+    {
+        erase(std::prev(lru_.end()));
+        stats_.evictions++;
+    }
+}
+
+bool ResultCache::lookup(const std::string &key, std::vector<char> &out)
+{
+    std::shared_ptr<const std::vector<char>> bytes;
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        auto it = entries_.find(key);
+        if (it == entries_.end())
+        {
+            stats_.misses++;
+            return false;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        bytes = it->second->bytes;
+        stats_.hits++;
+    }
+    out.insert(out.end(), bytes->begin(), bytes->end());
+    return true;
+}
+
+uint64_t ResultCache::stamp()
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    return clock_;
+}
+
+void ResultCache::insert(const std::string &key, const std::vector<std::string> &tables, uint64_t stamp,
+                         const char *data, size_t len)
+{
+    if (tables.empty() || len > capacity_ / max_entry_share) return;
+    auto bytes = std::make_shared<const std::vector<char>>(data, data + len);
+    std::lock_guard<std::mutex> lg(mtx_);
+    if (all_stamp_ > stamp) return;
+    for (auto &t : tables)
+    {
+        auto ts = table_stamp_.find(t);
+        if (ts != table_stamp_.end() && ts->second > stamp) return;
+    }
+    auto old = entries_.find(key);
+    if (old != entries_.end()) erase(old->second);
+    lru_.push_front(Entry{key, tables, bytes});
+    entries_[key] = lru_.begin();
+    for (auto &t : tables) by_table_[t].insert(key);
+    stats_.bytes += key.size() + len;
+    stats_.entries++;
+    stats_.inserts++;
+    while (stats_.bytes > capacity_)
+    {
+        erase(std::prev(lru_.end()));
+        stats_.evictions++;
+    }
+}
+
+void ResultCache::invalidate(const std::unordered_set<std::string> &tables)
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    clock_++;
+    for (auto &t : tables)
+    {
+        table_stamp_[t] = clock_;
+        auto keys = by_table_.find(t);
+        if (keys == by_table_.end()) continue;
+        // erase() edits by_table_, so detach this table's keys first
+        std::unordered_set<std::string> doomed;
+        doomed.swap(keys->second);
+        by_table_.erase(keys);
+        for (auto &k : doomed)
+        {
+            auto it = entries_.find(k);
+            if (it == entries_.end()) continue;
+            erase(it->second);
+            stats_.invalidations++;
+        }
+    }
+}
+
+void ResultCache::invalidate_all()
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    all_stamp_ = ++clock_;
+    stats_.invalidations += entries_.size();
+    lru_.clear();
+    entries_.clear();
+    by_table_.clear();
+    table_stamp_.clear(); // all_stamp_ covers every table now
+    stats_.entries = 0;
+    stats_.bytes = 0;
+}
+
+ResultCache::Stats ResultCache::stats()
+{
+    std::lock_guard<std::mutex> lg(mtx_);
+    return stats_;
+}
+
+void ResultCache::erase(EntryList::iterator it)
+{
+    for (auto &t : it->tables)
+    {
+        auto keys = by_table_.find(t);
+        if (keys == by_table_.end()) continue;
+        keys->second.erase(it->key);
+        if (keys->second.empty()) by_table_.erase(keys);
+    }
+    stats_.bytes -= it->key.size() + it->bytes->size();
+    stats_.entries--;
+    entries_.erase(it->key);
+    lru_.erase(it);
+}
+
+bool result_cacheable_sql(const std::string &sql)
+{
+    static const char *volatile_words[] = {
+        "random", "uuid", "now", "current_", "localtime", "clock_", "statement_timestamp",
+        "transaction_timestamp", "get_current", "nextval", "currval", "setseed", "txid",
+        "getenv", "for update", "for share",
+    };
+    std::string lower = boost::algorithm::to_lower_copy(sql);
+    for (auto w : volatile_words)
+    {
+        if (lower.find(w) != std::string::npos) return false;
+    }
+    return true;
+}
+
+std::string result_cache_table_name(const std::string &name)
+{
+    // Last dot-separated part, ignoring dots inside quotes
+    size_t start = 0;
+    bool quoted = false;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        if (name[i] == '"') quoted = !quoted;
+        else if (name[i] == '.' && !quoted) start = i + 1;
+    }
+    std::string out;
+    for (size_t i = start; i < name.size(); i++)
+    {
+        if (name[i] != '"') out.push_back((char)std::tolower((unsigned char)name[i]));
+    }
+    return out;
+}
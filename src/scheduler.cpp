@@ -0,0 +1,181 @@
+#include "scheduler.hpp"
+#include "session.hpp"
+#include "log.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <boost/algorithm/string.hpp>
+#include <boost/asio/post.hpp>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Configured classes; built before the server starts and fixed afterwards
+static std::vector<std::unique_ptr<WorkloadClass>> classes;
+static std::vector<std::unique_ptr<boost::asio::thread_pool>> class_pools;
+
+static WorkloadClass &default_class()
+{
+    static WorkloadClass wc;
+    if (!wc.pool)
+    {
+        wc.name = "default";
+        wc.pool = &get_thread_pool();
+    }
+    return wc;
+}
+
+bool WorkloadClass::try_enqueue()
+{
+    size_t n = queued.load();
+    do
+    {
+        if (queue_limit > 0 && n >= queue_limit)
+        {
+            rejected++;
+            return false;
+        }
+    } while (!queued.compare_exchange_weak(n, n + 1));
+    admitted++;
+    return true;
+}
+
+static size_t parse_count(const std::string &key, const std::string &value)
+{
+    char *end = nullptr;
+    long n = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || n < 0)
+        throw std::invalid_argument("workload class: bad value for " + key + ": " + value);
+    return static_cast<size_t>(n);
+}
+
+void add_workload_class(const std::string &spec)
+{
+    std::unique_ptr<WorkloadClass> wc(new WorkloadClass());
+    size_t colon = spec.find(':');
+    wc->name = spec.substr(0, colon);
+    if (wc->name.empty() || wc->name == "default")
+        throw std::invalid_argument("workload class: missing or reserved name in \"" + spec + "\"");
+    std::vector<std::string> settings;
+    std::string rest = colon != std::string::npos ? spec.substr(colon + 1) : std::string();
+    boost::algorithm::split(settings, rest, boost::is_any_of(","));
+    for (auto &setting : settings)
+    {
+        if (setting.empty()) continue;
+        size_t eq = setting.find('=');
+        if (eq == std::string::npos)
+            throw std::invalid_argument("workload class: expected key=value, got \"" + setting + "\"");
+        std::string key = setting.substr(0, eq);
+        std::string value = setting.substr(eq + 1);
+        if (key == "threads")
+        {
+            wc->threads = parse_count(key, value);
+            if (wc->threads == 0) throw std::invalid_argument("workload class: threads must be greater than 0");
+        }
+        else if (key == "queue") wc->queue_limit = parse_count(key, value);
+        else if (key == "priority")
+        {
+            char *end = nullptr;
+            wc->priority = (int)std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0')
+                throw std::invalid_argument("workload class: bad value for priority: " + value);
+        }
+        else if (key == "database") wc->database = value;
+        else if (key == "user") wc->user = value;
+        else if (key == "application_name") wc->application_name = value;
+        else if (key == "statement") wc->statement = boost::algorithm::to_lower_copy(value);
+        else throw std::invalid_argument("workload class: unknown setting \"" + key + "\"");
+    }
+    classes.push_back(std::move(wc));
+}
+
+// Run one task per worker at the same time, so that every thread of the
+// pool sets its own scheduling priority
+static void set_pool_priority(boost::asio::thread_pool &pool, size_t threads, int priority, const std::string &name)
+{
+#ifdef __linux__
+    struct Latch
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        size_t arrived = 0;
+        int failed = 0;
+    };
+    auto latch = std::make_shared<Latch>();
+    for (size_t i = 0; i < threads; i++)
+    {
+        boost::asio::post(pool, [latch, threads, priority]()
+                          {
+                              int err = setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), -priority) ? errno : 0;
+                              std::unique_lock<std::mutex> lk(latch->mtx);
+                              if (err) latch->failed = err;
+                              if (++latch->arrived == threads) latch->cv.notify_all();
+                              else latch->cv.wait(lk, [&]() { return latch->arrived == threads; });
+                          });
+    }
+    std::unique_lock<std::mutex> lk(latch->mtx);
+    latch->cv.wait(lk, [&]() { return latch->arrived == threads; });
+    if (latch->failed)
+        PWARNING << "Workload class " << name << ": could not set priority " << priority << ": "
+                 << std::strerror(latch->failed);
+#else
+    (void)pool;
+    (void)threads;
+    PWARNING << "Workload class " << name << ": priority " << priority << " is only supported on Linux";
+#endif
+}
+
+void start_workload_classes(size_t default_threads)
+{
+    default_class().threads = default_threads;
+    for (auto &wc : classes)
+    {
+        class_pools.emplace_back(new boost::asio::thread_pool(wc->threads));
+        wc->pool = class_pools.back().get();
+        if (wc->priority != 0)
+            set_pool_priority(*wc->pool, wc->threads, wc->priority, wc->name);
+        PINFO << "Workload class " << wc->name << ": " << wc->threads << " threads, queue limit "
+              << wc->queue_limit << ", priority " << wc->priority;
+    }
+}
+
+void stop_workload_classes()
+{
+    for (auto &pool : class_pools)
+        pool->join();
+}
+
+static bool matches(const std::string &want, const std::map<std::string, std::string> &params, const char *key)
+{
+    if (want.empty()) return true;
+    auto it = params.find(key);
+    return it != params.end() && it->second == want;
+}
+
+WorkloadClass &select_workload_class(const std::map<std::string, std::string> &startup_params,
+                                     const std::string &statement)
+{
+    for (auto &wc : classes)
+    {
+        if (!wc->pool) continue;
+        if (!matches(wc->database, startup_params, "database")) continue;
+        if (!matches(wc->user, startup_params, "user")) continue;
+        if (!matches(wc->application_name, startup_params, "application_name")) continue;
+        if (!wc->statement.empty() && wc->statement != statement) continue;
+        return *wc;
+    }
+    return default_class();
+}
+
+std::vector<WorkloadClass *> workload_classes()
+{
+    std::vector<WorkloadClass *> out;
+    for (auto &wc : classes) out.push_back(wc.get());
+    out.push_back(&default_class());
+    return out;
+}
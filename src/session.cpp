@@ -6,15 +6,28 @@
 #include <boost/algorithm/string.hpp>
 
 #include <unordered_map>
+#include <deque>
 #include <mutex>
 #include <atomic>
 #include <random>
 #include <cstring>
+#include <cerrno>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "session.hpp"
 #include "log.hpp"
 #include "db.hpp"
+#include "result_cache.hpp"
+#include "scheduler.hpp"
+#include "pg_catalog.hpp"
 
 #include <memory>
 #include <set>
@@ -22,6 +35,55 @@
 using boost::asio::ip::tcp;
 static boost::asio::thread_pool *thread_pool_ptr = nullptr;
 static std::string datadir = ".";
+// Result streams are flushed to the socket whenever this much output is buffered,
+// and stop fetching while more than this much is still waiting to be sent.
+static size_t output_high_water = 256 * 1024;
+// Prepared statements each session keeps for re-use by later Parse messages
+static size_t statement_cache_size = 64;
+// Run simple queries that differ only in literals through one prepared plan
+static bool auto_parameterize = false;
+// Append the rows of pipelined single-row INSERT ... VALUES Executes
+static bool insert_appender = false;
+// A result stream gives its worker to other work after this many chunks or
+// microseconds (0 = no limit)
+static size_t stream_slice_chunks = 16;
+static uint64_t stream_slice_us = 10000;
+
+// --- output blocks ---
+// Output is encoded in place into blocks that are recycled across sessions
+// once written. A block keeps the capacity it grew to, so steady traffic
+// settles into reusing the same memory.
+static const size_t out_block_size = 16 * 1024;
+static const size_t out_block_keep_limit = 1024 * 1024; // bigger blocks are freed
+static const size_t out_pool_max_blocks = 1024;
+static const size_t max_gather_blocks = 64;
+static std::mutex out_pool_mtx;
+static std::vector<std::vector<char>> out_pool;
+
+static std::vector<char> acquire_out_block()
+{
+    {
+        std::lock_guard<std::mutex> lg(out_pool_mtx);
+        if (!out_pool.empty())
+        {
+            std::vector<char> block = std::move(out_pool.back());
+            out_pool.pop_back();
+            return block;
+        }
+    }
+    std::vector<char> block;
+    block.reserve(out_block_size);
+    return block;
+}
+
+static void release_out_block(std::vector<char> &&block)
+{
+    if (block.capacity() > out_block_keep_limit) return;
+    block.clear();
+    std::lock_guard<std::mutex> lg(out_pool_mtx);
+    if (out_pool.size() < out_pool_max_blocks)
+        out_pool.push_back(std::move(block));
+}
 
 // Global registry for backend pid -> session mapping (for CancelRequest handling)
 static std::mutex sessions_mtx;
@@ -29,74 +91,6 @@ static std::unordered_map<uint32_t, std::weak_ptr<class PGSession>> sessions_map
 static std::unordered_map<uint32_t, uint32_t> sessions_secret;
 static std::atomic<uint32_t> next_backend_pid{1};
 
-// DuckDB LogicalTypeId -> PG type OID
-// Based on duckdb::LogicalTypeId enum values.
-static uint32_t pg_type_oid(const duckdb::LogicalType &lt)
-{
-    switch (lt.id())
-    {
-    case duckdb::LogicalTypeId::BOOLEAN:  return 16;   // bool
-    case duckdb::LogicalTypeId::TINYINT:  return 21;   // int2 (no int1 in PG)
-    case duckdb::LogicalTypeId::SMALLINT: return 21;   // int2
-    case duckdb::LogicalTypeId::INTEGER:  return 23;   // int4
-    case duckdb::LogicalTypeId::BIGINT:   return 20;   // int8
-    case duckdb::LogicalTypeId::UTINYINT: return 21;
-    case duckdb::LogicalTypeId::USMALLINT:return 23;
-    case duckdb::LogicalTypeId::UINTEGER: return 20;
-    case duckdb::LogicalTypeId::UBIGINT:  return 1700; // numeric (fit)
-    case duckdb::LogicalTypeId::HUGEINT:  return 1700; // numeric
-    case duckdb::LogicalTypeId::UHUGEINT: return 1700; // numeric
-    case duckdb::LogicalTypeId::FLOAT:    return 700;  // float4
-    case duckdb::LogicalTypeId::DOUBLE:   return 701;  // float8
-    case duckdb::LogicalTypeId::DECIMAL:  return 1700; // numeric
-    case duckdb::LogicalTypeId::VARCHAR:  return 25;   // text (better for JDBC generic)
-    case duckdb::LogicalTypeId::CHAR:     return 1042; // bpchar
-    case duckdb::LogicalTypeId::BLOB:     return 17;   // bytea
-    case duckdb::LogicalTypeId::DATE:     return 1082;
-    case duckdb::LogicalTypeId::TIME:     return 1083;
-    case duckdb::LogicalTypeId::TIMESTAMP:     return 1114;
-    case duckdb::LogicalTypeId::TIMESTAMP_TZ:  return 1184;
-    case duckdb::LogicalTypeId::TIMESTAMP_SEC:
-    case duckdb::LogicalTypeId::TIMESTAMP_MS:
-    case duckdb::LogicalTypeId::TIMESTAMP_NS:  return 1114;
-    case duckdb::LogicalTypeId::TIME_TZ:        return 1266;
-    case duckdb::LogicalTypeId::INTERVAL:       return 1186;
-    case duckdb::LogicalTypeId::UUID:           return 2950;
-    case duckdb::LogicalTypeId::LIST:
-    case duckdb::LogicalTypeId::ARRAY:
-    case duckdb::LogicalTypeId::MAP:
-    case duckdb::LogicalTypeId::STRUCT:
-    case duckdb::LogicalTypeId::UNION:
-    case duckdb::LogicalTypeId::ENUM:           return 25; // text repr
-    default:                                    return 25;
-    }
-}
-
-// Pick reasonable type length for a type OID; -1 = var length
-static int16_t pg_type_len(uint32_t oid)
-{
-    switch (oid)
-    {
-    case 16:   return 1;   // bool
-    case 17:   return -1;  // bytea
-    case 18:   return 1;   // char
-    case 20:   return 8;
-    case 21:   return 2;
-    case 23:   return 4;
-    case 26:   return 4;   // oid
-    case 700:  return 4;
-    case 701:  return 8;
-    case 1082: return 4;
-    case 1083: return 8;
-    case 1114: return 8;
-    case 1184: return 8;
-    case 1266: return 12;
-    case 1186: return 16;
-    case 2950: return 16;
-    default:   return -1;
-    }
-}
-
 void init_thread_pool(size_t thread_count)
 {
     if (thread_pool_ptr != nullptr)
@@ -126,6 +120,32 @@ void cleanup_thread_pool()
     }
 }
 
+void set_output_high_water_mark(size_t bytes)
+{
+    output_high_water = bytes > 0 ? bytes : 1;
+}
+
+void set_statement_cache_size(size_t entries)
+{
+    statement_cache_size = entries;
+}
+
+void set_auto_parameterize(bool enable)
+{
+    auto_parameterize = enable;
+}
+
+void set_insert_appender(bool enable)
+{
+    insert_appender = enable;
+}
+
+void set_stream_slice(size_t chunks, uint64_t micros)
+{
+    stream_slice_chunks = chunks;
+    stream_slice_us = micros;
+}
+
 void set_data_directory(const std::string &dir)
 {
     datadir = dir;
@@ -135,11 +155,74 @@ void set_data_directory(const std::string &dir)
     }
 }
 
+// --- reactors ---
+// Socket I/O runs on one or more io_contexts ("reactors"), each driven by a
+// single thread; a session stays on the reactor its socket was accepted on.
+static std::vector<std::unique_ptr<boost::asio::io_context>> reactors;
+static bool reactors_pinned = false;
+
+void init_reactors(size_t count, bool pin_cpus)
+{
+    reactors.clear();
+    for (size_t i = 0; i < std::max<size_t>(count, 1); i++)
+        reactors.emplace_back(new boost::asio::io_context(1));
+    reactors_pinned = pin_cpus;
+}
+
+size_t reactor_count()
+{
+    if (reactors.empty()) init_reactors(1, false);
+    return reactors.size();
+}
+
+boost::asio::io_context &get_reactor(size_t index)
+{
+    return *reactors[index % reactor_count()];
+}
+
+static void pin_to_cpu(size_t index)
+{
+#ifdef __linux__
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0)
+        PWARNING << "Could not pin reactor " << index << " to CPU " << index % cpus << ": " << std::strerror(rc);
+#else
+    (void)index;
+    PWARNING << "Pinning reactors to CPUs is only supported on Linux";
+#endif
+}
+
+void run_reactors()
+{
+    size_t n = reactor_count();
+    // Reactors without an acceptor of their own must not run out of work
+    // before their first session arrives
+    std::vector<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> guards;
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; i++)
+    {
+        guards.push_back(boost::asio::make_work_guard(*reactors[i]));
+        threads.emplace_back([i]()
+                             {
+                                 if (reactors_pinned) pin_to_cpu(i);
+                                 reactors[i]->run();
+                             });
+    }
+    if (reactors_pinned) pin_to_cpu(0);
+    reactors[0]->run();
+    guards.clear();
+    for (size_t i = 1; i < n; i++) reactors[i]->stop();
+    for (auto &t : threads) t.join();
+}
+
 boost::asio::io_context &
 PGSession::get_io_context()
 {
-    static boost::asio::io_context io_context_;
-    return io_context_;
+    return get_reactor(0);
 }
 
 // --- parse startup params ---
@@ -166,151 +249,110 @@ void PGSession::parse_startup_params(const char *data, size_t length)
 }
 
 // --- SSL negotiation ---
-void PGSession::handle_ssl_negotiation()
-{
-    auto buf = std::make_shared<std::array<char, 8>>();
-    asio::async_read(socket_, asio::buffer(*buf, 8),
-                     [self = shared_from_this(), buf](boost::system::error_code ec, size_t)
-                     {
-                         if (ec) return;
-                         // SSLRequest code = 0x04D2162F (80877103)
-                         if (memcmp(buf->data() + 4, "\x04\xD2\x16\x2F", 4) == 0)
-                         {
-                             asio::write(self->socket_, asio::buffer("N", 1));
-                             // After rejecting SSL, client sends a fresh StartupMessage.
-                             self->handle_ssl_negotiation();
-                             return;
-                         }
-                         // GSSENCRequest code = 0x04D21630 (80877104)
-                         if (memcmp(buf->data() + 4, "\x04\xD2\x16\x30", 4) == 0)
-                         {
-                             asio::write(self->socket_, asio::buffer("N", 1));
-                             self->handle_ssl_negotiation();
-                             return;
-                         }
-                         // CancelRequest code = 0x04D2162E
-                         if (memcmp(buf->data() + 4, "\x04\xD2\x16\x2E", 4) == 0)
-                         {
-                             uint32_t pid = ntohl(*reinterpret_cast<uint32_t *>(buf->data() + 8 - 8)); // placeholder
-                             (void)pid;
-                             auto cbuf = std::make_shared<std::array<char, 8>>();
-                             // Note: we've already consumed the 8 bytes (len + code).
-                             // CancelRequest is exactly 16 bytes: len(4) code(4) pid(4) secret(4)
-                             asio::async_read(self->socket_, asio::buffer(*cbuf, 8),
-                                              [self, cbuf](boost::system::error_code ec2, size_t)
-                                              {
-                                                  if (ec2) return;
-                                                  uint32_t pid = ntohl(*reinterpret_cast<uint32_t *>(cbuf->data()));
-                                                  uint32_t secret = ntohl(*reinterpret_cast<uint32_t *>(cbuf->data() + 4));
-                                                  std::shared_ptr<PGSession> target;
-                                                  {
-                                                      std::lock_guard<std::mutex> lg(sessions_mtx);
-                                                      auto it = sessions_map.find(pid);
-                                                      if (it != sessions_map.end() && !it->second.expired())
-                                                      {
-                                                          auto s_it = sessions_secret.find(pid);
-                                                          if (s_it != sessions_secret.end() && s_it->second == secret)
-                                                              target = it->second.lock();
-                                                      }
-                                                  }
-                                                  if (target)
-                                                  {
-                                                      PINFO << "CancelRequest accepted pid=" << pid;
-                                                      target->Cancel();
-                                                  }
-                                                  // cancel connection closes on return
-                                              });
-                             return;
-                         }
-                         // Regular startup packet: we already have first 8 bytes (len + version)
-                         // store them into msg_buf_ to be re-used by handle_startup_continued
-                         self->msg_buf_.assign(buf->begin(), buf->end());
-                         // length includes itself
-                         uint32_t total_len = ntohl(*reinterpret_cast<uint32_t *>(buf->data()));
-                         if (total_len < 8 || total_len > 1024 * 1024)
-                         {
-                             PERROR << "Invalid startup packet length: " << total_len;
-                             return;
-                         }
-                         size_t remaining = total_len - 8;
-                         self->msg_buf_.resize(total_len);
-                         if (remaining == 0)
-                         {
-                             self->parse_startup_params(self->msg_buf_.data() + 4, total_len - 4);
-                             self->handle_authentication();
-                             return;
-                         }
-                         asio::async_read(self->socket_,
-                                          asio::buffer(self->msg_buf_.data() + 8, remaining),
-                                          [self, total_len](boost::system::error_code ec3, size_t)
-                                          {
-                                              if (ec3) return;
-                                              self->parse_startup_params(self->msg_buf_.data() + 4, total_len - 4);
-                                              self->handle_authentication();
-                                          });
-                     });
-}
-
-// SSL negotiation already reads the first 8 bytes to check for SSL/Cancel/Startup.
-// If it wasn't SSL/cancel, we treat those 8 bytes as the first bytes of the startup message.
-// The old handle_startup() is replaced — keep a stub for ABI.
-void PGSession::handle_startup() {}
-
-void PGSession::handle_authentication()
+// Serves a CancelRequest for the session with the given backend key
+static void cancel_backend(uint32_t pid, uint32_t secret)
 {
-    send_auth_ok();
+    std::shared_ptr<PGSession> target;
+    {
+        std::lock_guard<std::mutex> lg(sessions_mtx);
+        auto it = sessions_map.find(pid);
+        if (it != sessions_map.end() && !it->second.expired())
+        {
+            auto s_it = sessions_secret.find(pid);
+            if (s_it != sessions_secret.end() && s_it->second == secret)
+                target = it->second.lock();
+        }
+    }
+    if (target)
+    {
+        PINFO << "CancelRequest accepted pid=" << pid;
+        target->Cancel();
+    }
 }
 
-// --- writing primitives ---
-static inline void append_u8(std::vector<char> &buf, uint8_t v)
-{
-    buf.push_back(static_cast<char>(v));
-}
-static inline void append_u16(std::vector<char> &buf, uint16_t v)
+// The socket side of the session, on its reactor: the startup handshake,
+// then reading messages and handing each batch of complete ones to the
+// strand until the client goes away. Every co_await resumes on the
+// reactor, so nothing here needs a lock against the socket's other work.
+asio::awaitable<void> PGSession::run(std::shared_ptr<PGSession> self)
 {
-    uint16_t n = htons(v);
-    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 2);
-}
-static inline void append_i16(std::vector<char> &buf, int16_t v)
-{
-    uint16_t n = htons(static_cast<uint16_t>(v));
-    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 2);
-}
-static inline void append_u32(std::vector<char> &buf, uint32_t v)
-{
-    uint32_t n = htonl(v);
-    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 4);
+    (void)self; // only held: keeps the session alive while the coroutine runs
+    try
+    {
+        if (!co_await read_startup()) co_return;
+        handle_authentication();
+        for (;;)
+        {
+            size_t end = co_await read_messages();
+            if (end == 0) co_return;
+            co_await handle_batch(end);
+        }
+    }
+    catch (std::exception &e)
+    {
+        PDEBUG << "session end: " << e.what();
+    }
 }
-static inline void append_i32(std::vector<char> &buf, int32_t v)
+
+// Reads up to the StartupMessage. SSLRequest and GSSENCRequest are declined
+// with 'N', after which the client sends a fresh StartupMessage; a
+// CancelRequest is served and the connection closed. Returns whether there
+// is a session to run.
+asio::awaitable<bool> PGSession::read_startup()
 {
-    uint32_t n = htonl(static_cast<uint32_t>(v));
-    buf.insert(buf.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 4);
+    std::array<char, 8> head;
+    for (;;)
+    {
+        co_await asio::async_read(socket_, asio::buffer(head), asio::use_awaitable);
+        // SSLRequest code = 0x04D2162F (80877103), GSSENCRequest code = 0x04D21630 (80877104)
+        if (memcmp(head.data() + 4, "\x04\xD2\x16\x2F", 4) != 0 && memcmp(head.data() + 4, "\x04\xD2\x16\x30", 4) != 0)
+            break;
+        co_await asio::async_write(socket_, asio::buffer("N", 1), asio::use_awaitable);
+    }
+    // CancelRequest code = 0x04D2162E; exactly 16 bytes: len(4) code(4) pid(4) secret(4)
+    if (memcmp(head.data() + 4, "\x04\xD2\x16\x2E", 4) == 0)
+    {
+        std::array<char, 8> key;
+        co_await asio::async_read(socket_, asio::buffer(key), asio::use_awaitable);
+        cancel_backend(ntohl(*reinterpret_cast<uint32_t *>(key.data())),
+                       ntohl(*reinterpret_cast<uint32_t *>(key.data() + 4)));
+        co_return false;
+    }
+    // Regular startup packet: the 8 bytes read are its length and version;
+    // the length includes itself
+    uint32_t total_len = ntohl(*reinterpret_cast<uint32_t *>(head.data()));
+    if (total_len < 8 || total_len > 1024 * 1024)
+    {
+        PERROR << "Invalid startup packet length: " << total_len;
+        co_return false;
+    }
+    msg_buf_.assign(head.begin(), head.end());
+    msg_buf_.resize(total_len);
+    if (total_len > 8)
+        co_await asio::async_read(socket_, asio::buffer(msg_buf_.data() + 8, total_len - 8), asio::use_awaitable);
+    parse_startup_params(msg_buf_.data() + 4, total_len - 4);
+    co_return true;
 }
-static inline void append_cstr(std::vector<char> &buf, const std::string &s)
+
+void PGSession::handle_authentication()
 {
-    buf.insert(buf.end(), s.begin(), s.end());
-    buf.push_back('\0');
+    send_auth_ok();
 }
 
 void PGSession::append_parameter_status(const std::string &name, const std::string &value)
 {
-    std::vector<char> msg;
-    msg.push_back('S');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0); // placeholder length
-    append_cstr(msg, name);
-    append_cstr(msg, value);
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    size_t len_pos = begin_message(out_buf_, 'S');
+    append_cstr(out_buf_, name);
+    append_cstr(out_buf_, value);
+    end_message(out_buf_, len_pos);
 }
 
 void PGSession::send_auth_ok()
 {
     // AuthenticationOk
-    std::vector<char> auth_ok = {'R', 0, 0, 0, 8, 0, 0, 0, 0};
-    out_buf_.insert(out_buf_.end(), auth_ok.begin(), auth_ok.end());
+    size_t len_pos = begin_message(out_buf_, 'R');
+    append_u32(out_buf_, 0);
+    end_message(out_buf_, len_pos);
 
     // Parameter statuses required/expected by JDBC/psql
     append_parameter_status("server_version", "14.0 (PostDuck)");
@@ -336,41 +378,65 @@ void PGSession::send_auth_ok()
         sessions_map[backend_pid_] = shared_from_this();
         sessions_secret[backend_pid_] = backend_secret_;
     }
-    std::vector<char> bk;
-    bk.push_back('K');
-    append_u32(bk, 12);
-    append_u32(bk, backend_pid_);
-    append_u32(bk, backend_secret_);
-    out_buf_.insert(out_buf_.end(), bk.begin(), bk.end());
+    len_pos = begin_message(out_buf_, 'K');
+    append_u32(out_buf_, backend_pid_);
+    append_u32(out_buf_, backend_secret_);
+    end_message(out_buf_, len_pos);
 
     // Attach + use the database named in startup. If "database" not provided, fallback to user or "postduck".
-    std::string db_name;
     if (startup_params_.count("database"))
-        db_name = startup_params_["database"];
+        db_name_ = startup_params_["database"];
     else if (startup_params_.count("user"))
-        db_name = startup_params_["user"];
+        db_name_ = startup_params_["user"];
     else
-        db_name = "postduck";
+        db_name_ = "postduck";
+    const std::string &db_name = db_name_;
 
     try
     {
         if (!db_name.empty() && db_name != "memory" && db_name != ":memory:")
         {
             std::string attach_sql = "ATTACH IF NOT EXISTS '" + datadir + "/" + db_name + ".db' AS \"" + db_name + "\";";
-            auto res = connection_->Query(attach_sql);
-            if (res->HasError())
+            if (pool_)
             {
-                PDEBUG << "ATTACH failed, using in-memory: " << res->GetError();
+                // Attached databases are shared by all connections; the USE
+                // happens whenever a connection is borrowed
+                std::string err = pool_->execute(attach_sql);
+                if (!err.empty())
+                    PDEBUG << "ATTACH failed, using in-memory: " << err;
+                else
+                {
+                    use_db_ = db_name;
+                    catalog_mirror().note_database(db_name);
+                }
             }
             else
             {
-                auto use_res = connection_->Query("USE \"" + db_name + "\";");
-                if (use_res->HasError())
-                    PDEBUG << "USE failed: " << use_res->GetError();
+                auto res = connection_->Query(attach_sql);
+                if (res->HasError())
+                {
+                    PDEBUG << "ATTACH failed, using in-memory: " << res->GetError();
+                }
                 else
-                    PDEBUG << "USE OK: " << db_name;
+                {
+                    catalog_mirror().note_database(db_name);
+                    auto use_res = connection_->Query("USE \"" + db_name + "\";");
+                    if (use_res->HasError())
+                        PDEBUG << "USE failed: " << use_res->GetError();
+                    else
+                    {
+                        PDEBUG << "USE OK: " << db_name;
+                        use_db_ = db_name;
+                    }
+                }
             }
         }
+        if (!pool_ && catalog_mirror().enabled())
+        {
+            auto res = connection_->Query(catalog_mirror().search_path_sql(use_db_));
+            if (res->HasError())
+                PDEBUG << "search_path failed: " << res->GetError();
+        }
     }
     catch (std::exception &e)
     {
@@ -379,465 +445,1040 @@ void PGSession::send_auth_ok()
 
     enqueue_ready_for_query();
     flush_output();
-
-    // start reading messages
-    read_message();
 }
 
 // --- message reading loop ---
-void PGSession::read_message()
-{
-    auto hdr = std::make_shared<std::array<char, 5>>();
-    asio::async_read(socket_, asio::buffer(*hdr, 5),
-                     [self = shared_from_this(), hdr](boost::system::error_code ec, size_t)
-                     {
-                         if (ec)
-                         {
-                             PDEBUG << "read_message end: " << ec.message();
-                             return;
-                         }
-                         char type = (*hdr)[0];
-                         uint32_t len = ntohl(*reinterpret_cast<uint32_t *>(hdr->data() + 1));
-                         if (len < 4 || len > 1024 * 1024 * 64)
-                         {
-                             PERROR << "Invalid message length: " << len;
-                             return;
-                         }
-                         auto body = std::make_shared<std::vector<char>>(len - 4);
-                         if (body->empty())
-                         {
-                             self->dispatch_message(type, std::move(*body));
-                             self->read_message();
-                             return;
-                         }
-                         asio::async_read(self->socket_, asio::buffer(*body),
-                                          [self, type, body](boost::system::error_code ec2, size_t)
-                                          {
-                                              if (ec2) return;
-                                              self->dispatch_message(type, std::move(*body));
-                                              self->read_message();
-                                          });
-                     });
-}
-
-void PGSession::dispatch_message(char msg_type, std::vector<char> &&body)
+// Initial / idle size of the receive buffer; it grows to fit larger messages
+static const size_t recv_buffer_size = 64 * 1024;
+static const size_t max_message_size = 1024 * 1024 * 64;
+
+// Reads until the receive buffer holds at least one complete message and
+// returns the end of the last complete one, or 0 for a malformed message.
+// Only one read is in flight, and none while a batch of messages is being
+// handled, so handlers can work on the message bytes in place.
+asio::awaitable<size_t> PGSession::read_messages()
 {
-    // Extended protocol: when in error, skip until Sync
-    if (in_error_ && msg_type != 'S' && msg_type != 'X')
+    // Keep the incomplete tail, drop what has been handled
+    if (recv_begin_ > 0)
     {
-        return;
+        std::memmove(recv_buf_.data(), recv_buf_.data() + recv_begin_, recv_end_ - recv_begin_);
+        recv_end_ -= recv_begin_;
+        recv_begin_ = 0;
     }
-    auto self = shared_from_this();
-    auto body_shared = std::make_shared<std::vector<char>>(std::move(body));
-    if (!strand_)
+    for (;;)
     {
+        size_t pos = 0;
+        recv_need_ = 0;
+        while (recv_end_ - pos >= 5)
+        {
+            uint32_t len = ntohl(*reinterpret_cast<const uint32_t *>(recv_buf_.data() + pos + 1));
+            if (len < 4 || len > max_message_size)
+            {
+                PERROR << "Invalid message length: " << len;
+                co_return 0;
+            }
+            if (recv_end_ - pos < 1 + (size_t)len)
+            {
+                recv_need_ = pos + 1 + len;
+                break;
+            }
+            pos += 1 + len;
+        }
+        if (pos > 0) co_return pos;
+
+        size_t want = std::max(recv_need_, recv_end_ + 4096);
+        if (recv_buf_.size() < want)
+            recv_buf_.resize(std::max(want, std::max(recv_buf_.size() * 2, recv_buffer_size)));
+        else if (recv_end_ == 0 && recv_buf_.size() > 16 * recv_buffer_size)
+        {
+            // give back the space of an unusually large message
+            std::vector<char>(recv_buffer_size).swap(recv_buf_);
+        }
+        recv_end_ += co_await socket_.async_read_some(
+            asio::buffer(recv_buf_.data() + recv_end_, recv_buf_.size() - recv_end_), asio::use_awaitable);
+    }
+}
+
+// Hands the messages in [recv_begin_, end) to the session strand in one go
+// and resumes once they have all been handled (see finish_batch).
+asio::awaitable<void> PGSession::handle_batch(size_t end)
+{
+    // The workload class picks the worker pool. Only batches starting
+    // outside a transaction or COPY wait in (and may be turned away by) its
+    // queue; rejecting the rest would abort work already under way.
+    WorkloadClass &wc = select_workload_class(startup_params_, batch_statement(end));
+    bool queued = tx_status_ == 'I' && !copy_in_;
+    if (queued && !wc.try_enqueue())
+    {
+        reject_messages(end, wc);
+        co_return;
+    }
+    if (!strand_ || strand_class_ != &wc)
+    {
+        // Nothing of this session is running, so the old strand can go
         strand_ = std::make_shared<boost::asio::strand<boost::asio::thread_pool::executor_type>>(
-            boost::asio::make_strand(get_thread_pool().get_executor()));
+            boost::asio::make_strand(wc.pool->get_executor()));
+        strand_class_ = &wc;
     }
     // Dispatch processing to thread pool via a per-session strand so messages for
     // the same session are processed in the order received (required by extended protocol).
-    boost::asio::post(*strand_,
-                      [self, msg_type, body_shared]()
-                      {
-                          try
-                          {
-                              switch (msg_type)
-                              {
-                              case 'Q':
-                              {
-                                  // simple query
-                                  std::string q;
-                                  if (!body_shared->empty())
-                                      q.assign(body_shared->data(), body_shared->size() - 1); // strip trailing \0
-                                  self->handle_simple_query(q);
-                                  break;
-                              }
-                              case 'P': self->handle_parse(*body_shared); break;
-                              case 'B': self->handle_bind(*body_shared); break;
-                              case 'D': self->handle_describe(*body_shared); break;
-                              case 'E': self->handle_execute(*body_shared); break;
-                              case 'C': self->handle_close(*body_shared); break;
-                              case 'H': self->handle_flush(); break;
-                              case 'S': self->handle_sync(); break;
-                              case 'X':
-                                  // Terminate: do nothing, connection will close on read error
-                                  break;
-                              case 'd': // CopyData - unsupported
-                              case 'c': // CopyDone
-                              case 'f': // CopyFail
-                                  self->enqueue_error("COPY protocol not supported", "0A000");
-                                  self->enqueue_ready_for_query();
-                                  self->flush_output();
-                                  break;
-                              default:
-                                  PDEBUG << "Ignoring unknown message type: " << msg_type;
-                                  break;
-                              }
-                          }
-                          catch (std::exception &e)
-                          {
-                              PERROR << "dispatch exception: " << e.what();
-                              self->enqueue_error(e.what(), "XX000");
-                              self->in_error_ = true;
-                              self->flush_output();
-                          }
-                      });
+    co_await asio::async_initiate<const asio::use_awaitable_t<> &, void()>(
+        [this, end, queued, &wc](BatchHandler done)
+        {
+            batch_done_.emplace(std::move(done));
+            asio::post(*strand_, bind_memory(strand_mem_, [self = shared_from_this(), end, queued, &wc]()
+                                             {
+                                                 if (queued) wc.dequeue();
+                                                 self->handle_messages(end);
+                                             }));
+        },
+        asio::use_awaitable);
 }
 
-// Return true if the given trimmed, lower-cased statement is a transaction-control
-// statement that we handle at the protocol layer.
-static int txn_kind(const std::string &cmp_lower)
+// Called on the strand once the batch is handled: run() goes on reading on
+// the socket's executor
+void PGSession::finish_batch()
 {
-    // 1 = BEGIN, 2 = COMMIT, 3 = ROLLBACK, 0 = none
-    if (boost::algorithm::starts_with(cmp_lower, "begin") ||
-        boost::algorithm::starts_with(cmp_lower, "start transaction"))
-        return 1;
-    if (cmp_lower == "commit" || cmp_lower == "end" || cmp_lower == "commit work" ||
-        cmp_lower == "commit transaction" || boost::algorithm::starts_with(cmp_lower, "commit "))
-        return 2;
-    if (cmp_lower == "rollback" || cmp_lower == "rollback work" || cmp_lower == "abort" ||
-        cmp_lower == "rollback transaction" || boost::algorithm::starts_with(cmp_lower, "rollback "))
-        return 3;
-    return 0;
+    BatchHandler done = std::move(*batch_done_);
+    batch_done_.reset();
+    asio::post(std::move(done));
 }
 
-// --- simple query ---
-void PGSession::handle_simple_query(const std::string &raw_query)
+// First keyword of the first query in [recv_begin_, end), lower-cased
+std::string PGSession::batch_statement(size_t end) const
 {
-    std::string query = rewrite_query(raw_query);
-    PDEBUG << "simple query: " << query;
-
-    // Trim
-    std::string trimmed = boost::algorithm::trim_copy(query);
-    if (trimmed.empty())
-    {
-        enqueue_empty_query_response();
-        enqueue_ready_for_query();
-        flush_output();
-        return;
-    }
-
-    // DuckDB supports multi-statement queries in a single call; we just pass through
-    // but may need to split for correct per-statement CommandComplete handling.
-    // Simpler: run the whole string and handle result. DuckDB returns the last result
-    // linked via next_. We iterate.
-    duckdb::unique_ptr<duckdb::QueryResult> result;
-    try { result = connection_->SendQuery(query); }
-    catch (std::exception &e)
-    {
-        enqueue_error(std::string("query failed: ") + e.what(), "XX000");
-        enqueue_ready_for_query();
-        flush_output();
-        return;
-    }
-    // If a previous statement aborted the transaction, rollback and retry.
-    if (result && result->HasError())
-    {
-        std::string elower = boost::algorithm::to_lower_copy(result->GetError());
-        if (elower.find("current transaction is aborted") != std::string::npos)
+    size_t pos = recv_begin_;
+    while (pos < end)
+    {
+        char type = recv_buf_[pos];
+        uint32_t len = ntohl(*reinterpret_cast<const uint32_t *>(recv_buf_.data() + pos + 1));
+        const char *p = recv_buf_.data() + pos + 5;
+        const char *body_end = p + len - 4;
+        pos += 1 + len;
+        if (type == 'P')
         {
-            try { connection_->Query("ROLLBACK;"); } catch (...) {}
-            try { result = connection_->SendQuery(query); }
-            catch (std::exception &e)
-            {
-                enqueue_error(std::string("query failed: ") + e.what(), "XX000");
-                enqueue_ready_for_query();
-                flush_output();
-                return;
-            }
+            p = static_cast<const char *>(std::memchr(p, '\0', body_end - p));
+            if (!p) return std::string();
+            p++;
         }
+        else if (type != 'Q')
+            continue;
+        while (p < body_end && std::isspace((unsigned char)*p)) p++;
+        std::string word;
+        while (p < body_end && std::isalpha((unsigned char)*p))
+            word.push_back((char)std::tolower((unsigned char)*p++));
+        return word;
     }
+    return std::string();
+}
 
-    // Iterate through result chain (one entry per SQL statement)
-    duckdb::QueryResult *cur = result.get();
-    while (cur)
-    {
-        if (cur->HasError())
+// Answer a batch turned away by admission control the way PostgreSQL
+// answers statements it cannot run: each simple query, and each extended
+// query sequence up to its Sync, gets an ErrorResponse and ReadyForQuery.
+void PGSession::reject_messages(size_t end, const WorkloadClass &wc)
+{
+    std::string message = "too many queries waiting in workload class \"" + wc.name + "\"";
+    size_t pos = recv_begin_;
+    while (pos < end)
+    {
+        char type = recv_buf_[pos];
+        uint32_t len = ntohl(*reinterpret_cast<const uint32_t *>(recv_buf_.data() + pos + 1));
+        pos += 1 + len;
+        switch (type)
         {
-            std::string err = cur->GetError();
-            // Swallow benign transaction-state errors that arise from Postgres-style
-            // redundant BEGIN/COMMIT: PG clients issue BEGIN when a txn is already
-            // implicitly started and vice versa.
-            std::string elower = boost::algorithm::to_lower_copy(err);
-            if (elower.find("cannot start a transaction within a transaction") != std::string::npos ||
-                elower.find("cannot commit - there is no transaction active") != std::string::npos ||
-                elower.find("cannot rollback - there is no transaction active") != std::string::npos ||
-                elower.find("no transaction is active") != std::string::npos)
+        case 'Q':
+            enqueue_error(message, "53000");
+            enqueue_ready_for_query();
+            break;
+        case 'S':
+            in_error_ = false;
+            enqueue_ready_for_query();
+            break;
+        case 'H':
+        case 'X':
+            break;
+        default:
+            if (!in_error_)
             {
-                std::string tag = "OK";
-                if (elower.find("start") != std::string::npos) tag = "BEGIN";
-                else if (elower.find("commit") != std::string::npos) tag = "COMMIT";
-                else if (elower.find("rollback") != std::string::npos) tag = "ROLLBACK";
-                enqueue_command_complete(tag);
-                cur = cur->next.get();
-                continue;
+                enqueue_error(message, "53000");
+                in_error_ = true;
             }
-            enqueue_error(err, "XX000");
             break;
         }
+    }
+    PDEBUG << "rejected messages for workload class " << wc.name;
+    recv_begin_ = end;
+    flush_output();
+}
 
-        duckdb::StatementType stmt_type = cur->statement_type;
-        // Only SELECT/EXPLAIN (and EXECUTE of a prepared SELECT) stream rows to
-        // the client. Everything else — DDL, DML, transaction control, SET,
-        // PRAGMA — just emits a CommandComplete tag. DuckDB surfaces a 1-column
-        // "Success"/"Count" result for many of these; we must not forward it as
-        // a RowDescription or libpq will think the statement returned tuples.
-        bool is_result_producing =
-            (stmt_type == duckdb::StatementType::SELECT_STATEMENT) ||
-            (stmt_type == duckdb::StatementType::EXPLAIN_STATEMENT) ||
-            (stmt_type == duckdb::StatementType::EXECUTE_STATEMENT) ||
-            (stmt_type == duckdb::StatementType::CALL_STATEMENT);
-        bool is_dml = (stmt_type == duckdb::StatementType::INSERT_STATEMENT) ||
-                      (stmt_type == duckdb::StatementType::UPDATE_STATEMENT) ||
-                      (stmt_type == duckdb::StatementType::DELETE_STATEMENT) ||
-                      (stmt_type == duckdb::StatementType::COPY_STATEMENT);
-        bool is_select = is_result_producing;
-
-        std::vector<ColumnDesc> cols;
-        for (idx_t i = 0; i < cur->ColumnCount(); i++)
-        {
-            ColumnDesc c;
-            c.name = cur->names[i];
-            c.logical_type = cur->types[i];
-            c.col_num = (uint16_t)(i + 1);
-            cols.push_back(c);
-        }
+// Text of a simple query message (without its trailing \0)
+static std::string simple_query_text(const MessageBody &body)
+{
+    return body.empty() ? std::string() : std::string(body.data(), body.size() - 1);
+}
 
-        idx_t row_count = 0;
-        if (is_select)
+// Messages that run SQL, and so need a DuckDB connection; a simple query
+// with a constant answer does not
+static bool needs_connection(char msg_type, const Rewrite &rewrite)
+{
+    if (msg_type == 'Q') return !rewrite.answer;
+    return msg_type == 'P' || msg_type == 'B' || msg_type == 'D' || msg_type == 'E';
+}
+
+// Handle the messages in [recv_begin_, end) on the strand. A pooled session
+// without a connection stops at the first message needing one and picks up
+// from there once it has borrowed one.
+void PGSession::handle_messages(size_t end)
+{
+    size_t pos = recv_begin_;
+    while (pos < end)
+    {
+        char type = recv_buf_[pos];
+        uint32_t len = ntohl(*reinterpret_cast<const uint32_t *>(recv_buf_.data() + pos + 1));
+        MessageBody body(recv_buf_.data() + pos + 5, len - 4);
+        // A simple query is rewritten once, here, since its rewrite also
+        // tells whether it needs a connection
+        Rewrite rewrite;
+        if (type == 'Q') rewrite = rewrite_statement(simple_query_text(body));
+        if (!connection_ && pool_ && needs_connection(type, rewrite))
         {
-            enqueue_row_description(cols);
-            std::vector<int16_t> fmts(cols.size(), 0);
-            while (true)
-            {
-                auto chunk = cur->Fetch();
-                if (!chunk || chunk->size() == 0) break;
-                for (idx_t r = 0; r < chunk->size(); r++)
-                    enqueue_data_row_chunk(*chunk, r, fmts);
-                row_count += chunk->size();
-            }
+            recv_begin_ = pos;
+            borrow_connection(end);
+            return;
         }
-        else
+        dispatch_message(type, body, type == 'Q' ? &rewrite : nullptr);
+        pos += 1 + len;
+        if (stream_ && !run_stream())
         {
-            // Drain rows; DML statements typically return a single row with affected count.
-            auto chunk = cur->Fetch();
-            if (chunk && chunk->size() > 0 && chunk->ColumnCount() > 0)
-            {
-                try
-                {
-                    row_count = (idx_t)chunk->GetValue(0, 0).GetValue<int64_t>();
-                }
-                catch (...) { row_count = 0; }
-            }
-            // drain remaining (if any)
-            while (chunk && chunk->size() > 0)
-            {
-                chunk = cur->Fetch();
-            }
+            // Paused mid-result: the rest of the batch waits for it
+            recv_begin_ = pos;
+            stream_end_ = end;
+            return;
         }
-        enqueue_command_complete(statement_tag_for(stmt_type, row_count));
-        cur = cur->next.get();
     }
-
-    enqueue_ready_for_query();
-    flush_output();
+    recv_begin_ = end;
+    finish_batch();
 }
 
-// --- extended query: Parse ---
-void PGSession::handle_parse(const std::vector<char> &body)
+// --- result streams ---
+
+// Runs the current result stream until it ends or pauses. A paused stream
+// goes on in resume_stream(): posted to the back of the strand's pool when
+// its slice is used up, so other sessions' queries get a turn, or from
+// write_next() once the socket has drained below the high-water mark.
+// Returns true once the stream has ended.
+bool PGSession::run_stream()
 {
-    // body: stmt_name \0 query \0 int16 nparams [oid...]
-    size_t pos = 0;
-    auto read_cstr = [&](std::string &out)
+    StreamStatus st;
+    try
     {
-        size_t start = pos;
-        while (pos < body.size() && body[pos] != '\0') pos++;
-        out.assign(body.data() + start, pos - start);
-        if (pos < body.size()) pos++;
-    };
-
-    std::string stmt_name, query;
-    read_cstr(stmt_name);
-    read_cstr(query);
-    if (pos + 2 > body.size()) { enqueue_error("malformed Parse", "08P01"); in_error_ = true; return; }
-    uint16_t nparams = ntohs(*reinterpret_cast<const uint16_t *>(body.data() + pos));
-    pos += 2;
-    std::vector<uint32_t> param_oids;
-    for (uint16_t i = 0; i < nparams; i++)
+        st = stream_();
+    }
+    catch (std::exception &e)
     {
-        if (pos + 4 > body.size()) { enqueue_error("malformed Parse oid", "08P01"); in_error_ = true; return; }
-        param_oids.push_back(ntohl(*reinterpret_cast<const uint32_t *>(body.data() + pos)));
-        pos += 4;
+        PERROR << "stream exception: " << e.what();
+        enqueue_error(e.what(), "XX000");
+        if (stream_msg_ == 'Q') enqueue_ready_for_query();
+        else in_error_ = true;
+        flush_output();
+        st = STREAM_DONE;
     }
-
-    std::string rewritten = rewrite_query(query);
-    PDEBUG << "Parse '" << stmt_name << "' nparams=" << nparams << " oids=" << [&](){std::string s; for (auto o: param_oids) s += std::to_string(o) + ","; return s;}() << " sql=" << rewritten;
-
-    auto entry = std::make_shared<PreparedStatementEntry>();
-    entry->query = rewritten;
-    entry->param_type_oids = param_oids;
-    // Detect whether the query uses any $<n> parameters and whether the Parse message
-    // supplied type OIDs for all of them. If any parameter's type is unknown we defer
-    // preparation until Bind (at which point we inline the actual values).
-    bool query_has_params = rewritten.find('$') != std::string::npos;
-    bool has_untyped_params = false;
-    if (query_has_params && param_oids.empty())
+    if (st == STREAM_DONE)
     {
-        has_untyped_params = true;
+        stream_ = nullptr;
+        return true;
     }
-    for (auto oid : param_oids)
-        if (oid == 0) { has_untyped_params = true; break; }
-    if (!has_untyped_params)
+    if (st == STREAM_WAIT)
     {
-        try
-        {
-            entry->stmt = connection_->Prepare(rewritten);
-            if (entry->stmt->HasError())
-            {
-                PDEBUG << "eager Prepare failed (defer to Bind): " << entry->stmt->GetError();
-                entry->stmt.reset();
-            }
-        }
-        catch (std::exception &e)
+        std::lock_guard<std::mutex> lg(write_mtx_);
+        if (!write_failed_ && send_queued_bytes_ > output_high_water)
         {
-            PDEBUG << "eager Prepare exception (defer to Bind): " << e.what();
-            entry->stmt.reset();
+            resume_on_write_ = true;
+            return false;
         }
     }
-    prep_map_[stmt_name] = entry;
-    enqueue_parse_complete();
+    boost::asio::post(*strand_, bind_memory(strand_mem_, [self = shared_from_this()]() { self->resume_stream(); }));
+    return false;
 }
 
-// Forward declarations
-static std::string inline_parameters(const std::string &sql, const duckdb::vector<duckdb::Value> &values);
+void PGSession::resume_stream()
+{
+    if (run_stream()) handle_messages(stream_end_);
+}
 
-// Convert a PG wire parameter value to a duckdb::Value for prepared-statement binding.
-static duckdb::Value pg_param_to_value(const char *data, int32_t len, int16_t format, uint32_t type_oid)
+// Called between result chunks: once out_buf_ crosses the high-water mark it
+// is queued for sending, and the stream waits (without holding a worker)
+// while the socket has more than that still to write. This bounds
+// per-session memory to a few multiples of the mark however large the
+// result is. Otherwise the stream yields once its slice is used up.
+StreamStatus PGSession::stream_pause(StreamSlice &slice)
 {
-    if (len < 0)
+    if (out_buf_.size() >= output_high_water)
     {
-        return duckdb::Value(); // NULL
+        flush_output();
+        std::lock_guard<std::mutex> lg(write_mtx_);
+        if (write_failed_) return STREAM_GONE;
+        if (send_queued_bytes_ > output_high_water) return STREAM_WAIT;
     }
-    std::string s(data, data + len);
-    if (format == 0)
-    {
-        // text format
-        switch (type_oid)
-        {
-        case 16: // bool
-            return duckdb::Value::BOOLEAN(s == "t" || s == "true" || s == "1" || s == "TRUE");
-        case 20:
-            try { return duckdb::Value::BIGINT(std::stoll(s)); } catch (...) { return duckdb::Value(s); }
-        case 21:
-            try { return duckdb::Value::SMALLINT((int16_t)std::stoi(s)); } catch (...) { return duckdb::Value(s); }
-        case 23:
-            try { return duckdb::Value::INTEGER(std::stoi(s)); } catch (...) { return duckdb::Value(s); }
-        case 700:
-            try { return duckdb::Value::FLOAT(std::stof(s)); } catch (...) { return duckdb::Value(s); }
-        case 701:
-            try { return duckdb::Value::DOUBLE(std::stod(s)); } catch (...) { return duckdb::Value(s); }
-        case 0:
-        {
-            // Unknown type: try to infer from the text representation.
-            // Integers, floats are common and get mis-parsed as strings otherwise.
-            if (!s.empty())
-            {
-                size_t i = 0;
-                bool neg = (s[0] == '-' || s[0] == '+');
-                if (neg) i = 1;
-                bool digits = (i < s.size());
-                bool has_dot = false, has_exp = false;
-                for (; i < s.size(); i++)
+    slice.chunks++;
+    if (stream_slice_chunks > 0 && slice.chunks >= stream_slice_chunks) return STREAM_YIELD;
+    if (stream_slice_us > 0 &&
+        std::chrono::steady_clock::now() - slice.start >= std::chrono::microseconds(stream_slice_us))
+        return STREAM_YIELD;
+    return STREAM_MORE;
+}
+
+// --- transaction pooling ---
+
+void PGSession::borrow_connection(size_t end)
+{
+    auto self = shared_from_this();
+    try
+    {
+        pool_->acquire([self, end](std::shared_ptr<PooledConnection> lease)
+                       {
+                           boost::asio::post(*self->strand_, [self, end, lease]()
+                                             {
+                                                 self->use_connection(lease);
+                                                 self->handle_messages(end);
+                                             });
+                       });
+    }
+    catch (std::exception &e)
+    {
+        PERROR << "connection pool: " << e.what();
+        // Drop the messages read so far and let the client retry
+        enqueue_error(std::string("could not open a connection: ") + e.what(), "53000");
+        enqueue_ready_for_query();
+        flush_output();
+        recv_begin_ = end;
+        finish_batch();
+    }
+}
+
+// A connection comes back to the pool with the settings of a new one (see
+// ConnectionPool::release()), maybe in another database; the session's own
+// settings are applied again on top.
+void PGSession::use_connection(std::shared_ptr<PooledConnection> lease)
+{
+    if (lease->database != use_db_)
+    {
+        std::string sql = "USE \"" + use_db_ + "\";";
+        if (catalog_mirror().enabled()) sql += catalog_mirror().search_path_sql(use_db_);
+        auto res = lease->conn->Query(sql);
+        if (res->HasError())
+            PDEBUG << "USE failed: " << res->GetError();
+        else
+            lease->database = use_db_;
+    }
+    lease_ = std::move(lease);
+    std::atomic_store(&connection_, lease_->conn);
+    if (catalog_views_) use_catalog_views(true);
+    for (auto &sql : session_settings_)
+    {
+        lease_->settings_changed = true;
+        auto res = connection_->Query(sql);
+        if (res->HasError())
+            PDEBUG << "session setting failed on a borrowed connection: " << res->GetError();
+    }
+}
+
+// Give the connection back between transactions. Suspended portals keep
+// their rows but not the connection: streaming results are materialized and
+// plans are prepared again on whatever connection runs them next.
+void PGSession::release_connection()
+{
+    park_open_portals();
+    for (auto &kv : portal_map_)
+        kv.second->typed_stmt.reset();
+    auto lease = std::move(lease_);
+    std::atomic_store(&connection_, std::shared_ptr<duckdb::Connection>());
+    pool_->release(std::move(lease));
+}
+
+void PGSession::rebind_statement(PreparedStatementEntry &prep)
+{
+    if (prep.conn == connection_.get()) return;
+    prep.conn = connection_.get();
+    prep.typed_stmts.clear();
+    prep.batch_stmts.clear();
+    prep.appender.reset();
+    prep.layouts.clear();
+    if (!prep.stmt) return; // deferred to Bind anyway
+    try
+    {
+        prep.stmt = connection_->Prepare(prep.query);
+        if (!prep.stmt->HasError()) return;
+        PDEBUG << "re-Prepare failed (defer to Bind): " << prep.stmt->GetError();
+    }
+    catch (std::exception &e)
+    {
+        PDEBUG << "re-Prepare exception (defer to Bind): " << e.what();
+    }
+    // Bind inlines the values instead, and reports whatever went wrong
+    prep.stmt.reset();
+}
+
+void PGSession::dispatch_message(char msg_type, const MessageBody &body, Rewrite *rewrite)
+{
+    // Extended protocol: when in error, skip until Sync
+    if (in_error_ && msg_type != 'S' && msg_type != 'X')
+    {
+        return;
+    }
+    try
+    {
+        // Anything but another Bind/Execute ends a pending batch
+        if (!batch_.empty() && msg_type != 'B' && msg_type != 'E')
+        {
+            flush_batch();
+            if (in_error_ && msg_type != 'S' && msg_type != 'X')
+            {
+                flush_output();
+                return;
+            }
+        }
+        if (copy_in_)
+        {
+            // Copy-in mode: Flush and Sync are ignored, anything
+            // else besides the copy messages ends the COPY.
+            if (msg_type == 'H' || msg_type == 'S') return;
+            if (msg_type != 'd' && msg_type != 'c' && msg_type != 'f')
+                fail_copy_in(std::string("unexpected message type \"") + msg_type +
+                             "\" during COPY from stdin", "08P01");
+        }
+        switch (msg_type)
+        {
+        case 'Q':
+        {
+            // simple query
+            std::string q = simple_query_text(body);
+            handle_simple_query(q, rewrite ? std::move(*rewrite) : rewrite_statement(q));
+            break;
+        }
+        case 'P': handle_parse(body); break;
+        case 'B': handle_bind(body); break;
+        case 'D': handle_describe(body); break;
+        case 'E': handle_execute(body); break;
+        case 'C': handle_close(body); break;
+        case 'H': handle_flush(); break;
+        case 'S': handle_sync(); break;
+        case 'X':
+            // Terminate: do nothing, connection will close on read error
+            break;
+        // Outside copy-in mode (e.g. after a failed COPY) these are dropped
+        case 'd': if (copy_in_) handle_copy_data(body); break;
+        case 'c': if (copy_in_) handle_copy_done(); break;
+        case 'f': if (copy_in_) handle_copy_fail(body); break;
+        default:
+            PDEBUG << "Ignoring unknown message type: " << msg_type;
+            break;
+        }
+    }
+    catch (std::exception &e)
+    {
+        PERROR << "dispatch exception: " << e.what();
+        enqueue_error(e.what(), "XX000");
+        in_error_ = true;
+        if (batch_.empty())
+            flush_output();
+    }
+    // An error ends the implicit transaction of the Sync window:
+    // the batched Executes before it run, report, and roll back.
+    if (in_error_ && !batch_.empty())
+    {
+        try { flush_batch(true); }
+        catch (std::exception &e) { PERROR << "batch flush exception: " << e.what(); }
+        flush_output();
+    }
+}
+
+// transaction_kind() of rewritten SQL text (rewrite_query() has already
+// turned START TRANSACTION, END and ABORT into BEGIN/COMMIT/ROLLBACK)
+static int statement_txn_kind(const std::string &sql)
+{
+    size_t start = sql.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos || !std::strchr("bBcCrR", sql[start])) return 0;
+    return transaction_kind(sql);
+}
+
+static const char *aborted_txn_message =
+    "current transaction is aborted, commands ignored until end of transaction block";
+
+// Bring tx_status_ in line with DuckDB where SQL we passed through (e.g. a
+// BEGIN inside a multi-statement query) opened or ended a transaction.
+void PGSession::sync_tx_status()
+{
+    if (autocommit()) tx_status_ = 'I';
+    else if (tx_status_ == 'I') tx_status_ = 'T';
+}
+
+// BEGIN/COMMIT/ROLLBACK, answered from the tracked state like PostgreSQL:
+// redundant ones get a warning and never reach DuckDB, and COMMIT of a
+// failed transaction rolls it back. Returns false after an ErrorResponse.
+bool PGSession::run_transaction_control(int kind)
+{
+    sync_tx_status();
+    if (kind == 1)
+    {
+        if (tx_status_ == 'E')
+        {
+            enqueue_error(aborted_txn_message, "25P02");
+            return false;
+        }
+        if (tx_status_ == 'T')
+            enqueue_notice("there is already a transaction in progress", "25001");
+        else
+        {
+            try { connection_->BeginTransaction(); }
+            catch (std::exception &e)
+            {
+                enqueue_error(e.what(), "XX000");
+                return false;
+            }
+            tx_status_ = 'T';
+        }
+        enqueue_command_complete("BEGIN");
+        return true;
+    }
+    if (tx_status_ == 'I')
+    {
+        enqueue_notice("there is no transaction in progress", "25P01");
+        enqueue_command_complete(kind == 2 ? "COMMIT" : "ROLLBACK");
+        return true;
+    }
+    // Portals do not outlive their transaction
+    for (auto &kv : portal_map_)
+    {
+        auto &p = *kv.second;
+        if (!p.result) continue;
+        p.result.reset();
+        p.pending_chunk.reset();
+        p.exhausted = true;
+    }
+    bool commit = kind == 2 && tx_status_ == 'T';
+    tx_status_ = 'I';
+    try
+    {
+        if (commit) connection_->Commit();
+        else connection_->Rollback();
+    }
+    catch (std::exception &e)
+    {
+        enqueue_error(e.what(), commit ? "40001" : "XX000");
+        return false;
+    }
+    note_statement(duckdb::StatementType::TRANSACTION_STATEMENT, std::string());
+    enqueue_command_complete(commit ? "COMMIT" : "ROLLBACK");
+    return true;
+}
+
+// Lift literals out of a single SELECT/INSERT/UPDATE/DELETE so that queries
+// differing only in constants share a plan: "... WHERE aid = 48213" becomes
+// "... WHERE aid = $1" with values {48213}. Only integer and plain string
+// literals are lifted, and only in WHERE/SET/VALUES/LIMIT/... clauses where
+// they cannot turn up in column names or be read as ORDER BY ordinals.
+// Returns false when nothing was lifted or the text is not safe to rewrite.
+static bool lift_literals(const std::string &sql, std::string &shape, duckdb::vector<duckdb::Value> &values)
+{
+    static const std::set<std::string> lift_on = {"where", "set", "values", "limit", "offset", "having", "on"};
+    static const std::set<std::string> lift_off = {"select", "from", "order", "group", "returning",
+                                                   "window", "qualify", "union", "except", "intersect"};
+    static const std::set<std::string> lift_after = {"=", "<", ">", "<=", ">=", "<>", "!=", "(", ",", "+", "-",
+                                                     "*", "/", "%", "in", "between", "and", "or", "like",
+                                                     "ilike", "limit", "offset"};
+    size_t end = sql.size();
+    while (end > 0 && (sql[end - 1] == ';' || std::isspace((unsigned char)sql[end - 1]))) end--;
+    shape.clear();
+    values.clear();
+    bool lifting = false;
+    std::string prev; // previous token, lower-cased
+    size_t i = 0;
+    while (i < end)
+    {
+        char c = sql[i];
+        char next = i + 1 < end ? sql[i + 1] : '\0';
+        if (std::isspace((unsigned char)c))
+        {
+            shape.push_back(c);
+            i++;
+            continue;
+        }
+        // Comments, existing parameters, dollar quotes and further statements
+        if (c == ';' || c == '$' || (c == '-' && next == '-') || (c == '/' && next == '*'))
+            return false;
+        if (std::isalpha((unsigned char)c) || c == '_')
+        {
+            size_t j = i;
+            while (j < end && (std::isalnum((unsigned char)sql[j]) || sql[j] == '_')) j++;
+            std::string word = boost::algorithm::to_lower_copy(sql.substr(i, j - i));
+            if (prev.empty() && word != "select" && word != "insert" && word != "update" && word != "delete")
+                return false;
+            if (lift_on.count(word)) lifting = true;
+            else if (lift_off.count(word)) lifting = false;
+            shape.append(sql, i, j - i);
+            prev = word;
+            i = j;
+            continue;
+        }
+        if (c == '"')
+        {
+            size_t j = sql.find('"', i + 1);
+            if (j == std::string::npos || j >= end) return false;
+            shape.append(sql, i, j + 1 - i);
+            prev = "\"";
+            i = j + 1;
+            continue;
+        }
+        if (std::isdigit((unsigned char)c) || (c == '.' && std::isdigit((unsigned char)next)))
+        {
+            size_t j = i;
+            bool integral = true;
+            while (j < end && (std::isalnum((unsigned char)sql[j]) || sql[j] == '.' ||
+                               ((sql[j] == '+' || sql[j] == '-') && (sql[j - 1] == 'e' || sql[j - 1] == 'E'))))
+            {
+                if (!std::isdigit((unsigned char)sql[j])) integral = false;
+                j++;
+            }
+            long long v = 0;
+            char *num_end = nullptr;
+            if (integral && lifting && lift_after.count(prev))
+            {
+                errno = 0;
+                v = std::strtoll(sql.c_str() + i, &num_end, 10);
+                if (errno != 0) num_end = nullptr;
+            }
+            if (num_end == sql.c_str() + j)
+            {
+                values.push_back(v >= INT32_MIN && v <= INT32_MAX ? duckdb::Value::INTEGER((int32_t)v)
+                                                                   : duckdb::Value::BIGINT(v));
+                shape += "$" + std::to_string(values.size());
+            }
+            else
+                shape.append(sql, i, j - i);
+            prev = "0";
+            i = j;
+            continue;
+        }
+        if (c == '\'')
+        {
+            std::string text;
+            size_t j = i + 1;
+            while (true)
+            {
+                if (j >= end) return false;
+                if (sql[j] == '\'')
                 {
-                    char ch = s[i];
-                    if (std::isdigit((unsigned char)ch)) continue;
-                    if (ch == '.' && !has_dot && !has_exp) { has_dot = true; continue; }
-                    if ((ch == 'e' || ch == 'E') && !has_exp)
-                    {
-                        has_exp = true;
-                        if (i + 1 < s.size() && (s[i+1] == '+' || s[i+1] == '-')) i++;
-                        continue;
-                    }
-                    digits = false;
+                    if (j + 1 < end && sql[j + 1] == '\'') { text.push_back('\''); j += 2; continue; }
+                    break;
+                }
+                text.push_back(sql[j++]);
+            }
+            if (lifting && lift_after.count(prev))
+            {
+                values.push_back(duckdb::Value(text));
+                shape += "$" + std::to_string(values.size());
+            }
+            else
+                shape.append(sql, i, j + 1 - i);
+            prev = "'";
+            i = j + 1;
+            continue;
+        }
+        size_t j = i + 1;
+        if (std::strchr("=<>!", c))
+            while (j < end && std::strchr("=<>!", sql[j])) j++;
+        else if (c == ':' && next == ':')
+            j++;
+        prev.assign(sql, i, j - i);
+        shape.append(sql, i, j - i);
+        i = j;
+    }
+    return !values.empty();
+}
+
+// --- simple query ---
+void PGSession::handle_simple_query(const std::string &raw_query, Rewrite rewrite)
+{
+    const ConstantAnswer *answer = rewrite.answer;
+    std::string query = rewritten_sql(rewrite, raw_query);
+    PDEBUG << "simple query: " << query;
+
+    // Pool validation and driver bootstrap queries are answered without
+    // DuckDB, except in a failed transaction, which rejects them too
+    if (answer && tx_status_ != 'E')
+    {
+        enqueue_constant_answer(*answer);
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+
+    if (query.empty())
+    {
+        enqueue_empty_query_response();
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+
+    if (int kind = statement_txn_kind(query))
+    {
+        run_transaction_control(kind);
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+    if (tx_status_ == 'E')
+    {
+        enqueue_error(aborted_txn_message, "25P02");
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+
+    if (start_copy(query))
+        return;
+
+    ResultCapture cap;
+    if (serve_cached_result(cap, query, nullptr, nullptr))
+    {
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+
+    // DuckDB supports multi-statement queries in a single call; we just pass through
+    // but may need to split for correct per-statement CommandComplete handling.
+    // Simpler: run the whole string and handle result. DuckDB returns the last result
+    // linked via next_. We iterate.
+    park_open_portals();
+    // With auto-parameterization, a statement that only differs from an
+    // earlier one in its literals runs the plan of that one.
+    std::shared_ptr<PreparedStatementEntry> plan;
+    duckdb::vector<duckdb::Value> plan_values;
+    std::string shape;
+    if (auto_parameterize && statement_cache_size > 0 && lift_literals(query, shape, plan_values))
+        plan = auto_prepared(shape);
+    auto run = [&]()
+    {
+        if (plan) return plan->stmt->Execute(plan_values, true);
+        return connection_->SendQuery(query);
+    };
+    duckdb::unique_ptr<duckdb::QueryResult> result;
+    try { result = run(); }
+    catch (std::exception &e)
+    {
+        enqueue_error(std::string("query failed: ") + e.what(), "XX000");
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+    // The results are sent as a stream (see run_stream()), one statement's
+    // result after the other
+    struct QueryStream
+    {
+        duckdb::unique_ptr<duckdb::QueryResult> result;
+        duckdb::QueryResult *cur = nullptr;
+        // Statements that ran, for result cache invalidation once all are done
+        std::vector<duckdb::StatementType> ran;
+        std::vector<PGColumnEncoder> encoders;
+        idx_t row_count = 0;
+        bool sending_rows = false; // cur's RowDescription is out
+        bool failed = false;
+    };
+    auto qs = std::make_shared<QueryStream>();
+    qs->result = std::move(result);
+    qs->cur = qs->result.get();
+    stream_msg_ = 'Q';
+    stream_ = [this, qs, plan, query, cap]() -> StreamStatus
+    {
+        auto note_ran = [&]()
+        {
+            for (auto t : qs->ran)
+                note_statement(t, qs->ran.size() == 1 ? query : std::string());
+        };
+        StreamSlice slice;
+        // Iterate through result chain (one entry per SQL statement)
+        while (qs->cur)
+        {
+            duckdb::QueryResult *cur = qs->cur;
+            if (!qs->sending_rows)
+            {
+                if (cur->HasError())
+                {
+                    enqueue_error(cur->GetError(), "XX000");
+                    qs->failed = true;
                     break;
                 }
-                if (digits)
+                duckdb::StatementType stmt_type = cur->statement_type;
+                qs->ran.push_back(stmt_type);
+                // Only SELECT/EXPLAIN (and EXECUTE of a prepared SELECT) stream rows to
+                // the client. Everything else — DDL, DML, transaction control, SET,
+                // PRAGMA — just emits a CommandComplete tag. DuckDB surfaces a 1-column
+                // "Success"/"Count" result for many of these; we must not forward it as
+                // a RowDescription or libpq will think the statement returned tuples.
+                bool is_select =
+                    (stmt_type == duckdb::StatementType::SELECT_STATEMENT) ||
+                    (stmt_type == duckdb::StatementType::EXPLAIN_STATEMENT) ||
+                    (stmt_type == duckdb::StatementType::EXECUTE_STATEMENT) ||
+                    (stmt_type == duckdb::StatementType::CALL_STATEMENT);
+                if (!is_select)
                 {
-                    try
+                    // Drain rows; DML statements typically return a single row with affected count.
+                    idx_t row_count = 0;
+                    auto chunk = cur->Fetch();
+                    if (chunk && chunk->size() > 0 && chunk->ColumnCount() > 0)
                     {
-                        if (!has_dot && !has_exp)
+                        try
                         {
-                            long long v = std::stoll(s);
-                            if (v >= -2147483648LL && v <= 2147483647LL)
-                                return duckdb::Value::INTEGER((int32_t)v);
-                            return duckdb::Value::BIGINT((int64_t)v);
+                            row_count = (idx_t)chunk->GetValue(0, 0).GetValue<int64_t>();
                         }
-                        return duckdb::Value::DOUBLE(std::stod(s));
+                        catch (...) { row_count = 0; }
                     }
-                    catch (...) {}
+                    // drain remaining (if any)
+                    while (chunk && chunk->size() > 0)
+                    {
+                        chunk = cur->Fetch();
+                    }
+                    enqueue_command_complete(statement_tag_for(stmt_type, row_count));
+                    qs->cur = cur->next.get();
+                    continue;
+                }
+                std::vector<ColumnDesc> cols;
+                for (idx_t i = 0; i < cur->ColumnCount(); i++)
+                {
+                    ColumnDesc c;
+                    c.name = cur->names[i];
+                    c.logical_type = cur->types[i];
+                    c.col_num = (uint16_t)(i + 1);
+                    cols.push_back(c);
                 }
+                enqueue_row_description(cols);
+                qs->encoders = make_column_encoders(cur->types, std::vector<int16_t>());
+                qs->row_count = 0;
+                qs->sending_rows = true;
             }
-            return duckdb::Value(s);
-        }
-        default:
-            return duckdb::Value(s);
+            while (true)
+            {
+                auto chunk = cur->Fetch();
+                if (!chunk || chunk->size() == 0) break;
+                enqueue_data_rows(*chunk, qs->encoders);
+                qs->row_count += chunk->size();
+                StreamStatus st = stream_pause(slice);
+                if (st == STREAM_GONE)
+                {
+                    note_ran();
+                    return STREAM_DONE; // client went away mid-result
+                }
+                if (st != STREAM_MORE) return st;
+            }
+            enqueue_command_complete(statement_tag_for(cur->statement_type, qs->row_count));
+            qs->sending_rows = false;
+            qs->cur = cur->next.get();
         }
+
+        note_ran();
+        if (!qs->failed && qs->ran.size() == 1 && qs->ran[0] == duckdb::StatementType::SELECT_STATEMENT)
+            store_cached_result(cap, query, nullptr);
+        qs->result.reset(); // before a pooled connection is given back
+        enqueue_ready_for_query();
+        flush_output();
+        return STREAM_DONE;
+    };
+}
+
+// --- extended query: Parse ---
+void PGSession::handle_parse(const MessageBody &body)
+{
+    // body: stmt_name \0 query \0 int16 nparams [oid...]
+    size_t pos = 0;
+    auto read_cstr = [&](std::string &out)
+    {
+        size_t start = pos;
+        while (pos < body.size() && body[pos] != '\0') pos++;
+        out.assign(body.data() + start, pos - start);
+        if (pos < body.size()) pos++;
+    };
+
+    std::string stmt_name, query;
+    read_cstr(stmt_name);
+    read_cstr(query);
+    if (pos + 2 > body.size()) { enqueue_error("malformed Parse", "08P01"); in_error_ = true; return; }
+    uint16_t nparams = ntohs(*reinterpret_cast<const uint16_t *>(body.data() + pos));
+    pos += 2;
+    std::vector<uint32_t> param_oids;
+    for (uint16_t i = 0; i < nparams; i++)
+    {
+        if (pos + 4 > body.size()) { enqueue_error("malformed Parse oid", "08P01"); in_error_ = true; return; }
+        param_oids.push_back(ntohl(*reinterpret_cast<const uint32_t *>(body.data() + pos)));
+        pos += 4;
     }
-    else
+
+    std::string rewritten = rewrite_query(query);
+    PDEBUG << "Parse '" << stmt_name << "' nparams=" << nparams << " oids=" << [&](){std::string s; for (auto o: param_oids) s += std::to_string(o) + ","; return s;}() << " sql=" << rewritten;
+
+    std::string cache_key = rewritten;
+    cache_key.push_back('\0');
+    for (auto oid : param_oids)
+        cache_key += std::to_string(oid) + ",";
+    if (auto cached = cached_statement(cache_key))
+    {
+        prep_map_[stmt_name] = cached;
+        enqueue_parse_complete();
+        return;
+    }
+
+    auto entry = std::make_shared<PreparedStatementEntry>();
+    entry->query = rewritten;
+    entry->param_type_oids = param_oids;
+    entry->conn = connection_.get();
+    // Detect whether the query uses any $<n> parameters and whether the Parse message
+    // supplied type OIDs for all of them. If any parameter's type is unknown we defer
+    // preparation until Bind (at which point we inline the actual values).
+    bool query_has_params = rewritten.find('$') != std::string::npos;
+    bool has_untyped_params = false;
+    if (query_has_params && param_oids.empty())
+    {
+        has_untyped_params = true;
+    }
+    for (auto oid : param_oids)
+        if (oid == 0) { has_untyped_params = true; break; }
+    if (!has_untyped_params)
     {
-        // binary format
-        switch (type_oid)
+        park_open_portals();
+        try
         {
-        case 16: // bool
-            return duckdb::Value::BOOLEAN(len > 0 && data[0] != 0);
-        case 21: // int2
-            if (len == 2) return duckdb::Value::SMALLINT((int16_t)ntohs(*reinterpret_cast<const uint16_t *>(data)));
-            break;
-        case 23: // int4
-            if (len == 4) return duckdb::Value::INTEGER((int32_t)ntohl(*reinterpret_cast<const uint32_t *>(data)));
-            break;
-        case 20: // int8
-            if (len == 8)
+            entry->stmt = connection_->Prepare(rewritten);
+            if (entry->stmt->HasError())
             {
-                uint64_t hi = ntohl(*reinterpret_cast<const uint32_t *>(data));
-                uint64_t lo = ntohl(*reinterpret_cast<const uint32_t *>(data + 4));
-                int64_t v = (int64_t)((hi << 32) | lo);
-                return duckdb::Value::BIGINT(v);
+                PDEBUG << "eager Prepare failed (defer to Bind): " << entry->stmt->GetError();
+                entry->stmt.reset();
             }
-            break;
-        case 700: // float4
-            if (len == 4)
+            else
             {
-                uint32_t i = ntohl(*reinterpret_cast<const uint32_t *>(data));
-                float f;
-                std::memcpy(&f, &i, 4);
-                return duckdb::Value::FLOAT(f);
+                // Expected parameter types, keyed "1", "2", ... by DuckDB
+                for (auto &kv : entry->stmt->GetExpectedParameterTypes())
+                {
+                    char *end = nullptr;
+                    unsigned long n = std::strtoul(kv.first.c_str(), &end, 10);
+                    if (n == 0 || *end != '\0') continue;
+                    if (entry->param_types.size() < n) entry->param_types.resize(n);
+                    entry->param_types[n - 1] = kv.second;
+                }
             }
-            break;
-        case 701: // float8
-            if (len == 8)
+        }
+        catch (std::exception &e)
+        {
+            PDEBUG << "eager Prepare exception (defer to Bind): " << e.what();
+            entry->stmt.reset();
+        }
+    }
+    // Deferred statements are not planned here, so there is nothing to keep
+    if (entry->stmt) cache_statement(cache_key, entry);
+    prep_map_[stmt_name] = entry;
+    enqueue_parse_complete();
+}
+
+std::shared_ptr<PreparedStatementEntry> PGSession::cached_statement(const std::string &key)
+{
+    if (statement_cache_size == 0) return nullptr;
+    auto it = stmt_cache_.find(key);
+    if (it == stmt_cache_.end())
+    {
+        stmt_cache_stats_.misses++;
+        return nullptr;
+    }
+    stmt_lru_.splice(stmt_lru_.begin(), stmt_lru_, it->second);
+    stmt_cache_stats_.hits++;
+    return it->second->second;
+}
+
+void PGSession::cache_statement(const std::string &key, std::shared_ptr<PreparedStatementEntry> entry)
+{
+    if (statement_cache_size == 0) return;
+    stmt_lru_.emplace_front(key, std::move(entry));
+    stmt_cache_[key] = stmt_lru_.begin();
+    if (stmt_lru_.size() > statement_cache_size)
+    {
+        stmt_cache_.erase(stmt_lru_.back().first);
+        stmt_lru_.pop_back();
+        stmt_cache_stats_.evictions++;
+    }
+}
+
+// Plan for a simple query shape from lift_literals(); shapes DuckDB cannot
+// prepare are remembered too, and run as plain text.
+std::shared_ptr<PreparedStatementEntry> PGSession::auto_prepared(const std::string &shape)
+{
+    std::string key = shape;
+    key.append("\0Q", 2);
+    auto entry = cached_statement(key);
+    if (entry)
+        rebind_statement(*entry);
+    else
+    {
+        entry = std::make_shared<PreparedStatementEntry>();
+        entry->query = shape;
+        entry->conn = connection_.get();
+        try
+        {
+            entry->stmt = connection_->Prepare(shape);
+            if (entry->stmt->HasError())
             {
-                uint64_t hi = ntohl(*reinterpret_cast<const uint32_t *>(data));
-                uint64_t lo = ntohl(*reinterpret_cast<const uint32_t *>(data + 4));
-                uint64_t i = (hi << 32) | lo;
-                double d;
-                std::memcpy(&d, &i, 8);
-                return duckdb::Value::DOUBLE(d);
+                PDEBUG << "auto-parameterized Prepare failed: " << entry->stmt->GetError();
+                entry->stmt.reset();
             }
-            break;
-        case 25:
-        case 1043:
-        case 1042:
-            return duckdb::Value(s);
-        default:
-            break;
         }
-        // Fall back to bytes as string
-        return duckdb::Value(s);
+        catch (std::exception &e)
+        {
+            PDEBUG << "auto-parameterized Prepare exception: " << e.what();
+            entry->stmt.reset();
+        }
+        cache_statement(key, entry);
+    }
+    return entry->stmt ? entry : nullptr;
+}
+
+// Result layouts kept per prepared statement (distinct Bind result-format lists)
+static const size_t max_result_layouts = 4;
+
+static void append_row_description(std::vector<char> &out, const std::vector<ColumnDesc> &columns,
+                                   const std::vector<int16_t> *result_formats);
+
+// RowDescription and encoders of prep's own plan for these result formats;
+// null unless the plan returns rows
+std::shared_ptr<const ResultLayout> PGSession::result_layout(PreparedStatementEntry &prep,
+                                                             const std::vector<int16_t> &formats)
+{
+    if (!prep.stmt || prep.stmt->GetStatementType() != duckdb::StatementType::SELECT_STATEMENT) return nullptr;
+    for (auto &layout : prep.layouts)
+        if (layout->formats == formats) return layout;
+
+    auto layout = std::make_shared<ResultLayout>();
+    layout->formats = formats;
+    layout->types = prep.stmt->GetTypes();
+    auto &names = prep.stmt->GetNames();
+    std::vector<ColumnDesc> cols;
+    for (idx_t i = 0; i < names.size(); i++)
+    {
+        ColumnDesc c;
+        c.name = names[i];
+        c.logical_type = layout->types[i];
+        c.col_num = (uint16_t)(i + 1);
+        cols.push_back(c);
     }
+    append_row_description(layout->row_description, cols, &formats);
+    layout->encoders = make_column_encoders(layout->types, formats);
+    if (prep.layouts.size() >= max_result_layouts) prep.layouts.erase(prep.layouts.begin());
+    prep.layouts.push_back(layout);
+    return layout;
 }
 
-void PGSession::handle_bind(const std::vector<char> &body)
+// Forward declarations
+static std::string inline_parameters(const std::string &sql, const duckdb::vector<duckdb::Value> &values);
+
+void PGSession::handle_bind(const MessageBody &body)
 {
     size_t pos = 0;
     auto read_cstr = [&](std::string &out)
@@ -874,22 +1515,7 @@ void PGSession::handle_bind(const std::vector<char> &body)
         return;
     }
     auto prep = prep_it->second;
-
-    // Fetch expected DuckDB parameter types so we can coerce parameters correctly when
-    // the client did not supply explicit type OIDs in Parse (as is typical with libpq extended protocol).
-    duckdb::case_insensitive_map_t<duckdb::LogicalType> expected_types_map;
-    if (prep->stmt)
-    {
-        try { expected_types_map = prep->stmt->GetExpectedParameterTypes(); }
-        catch (...) {}
-    }
-    auto expected_type_for = [&](uint16_t idx) -> duckdb::LogicalType
-    {
-        std::string name = std::to_string(idx + 1);
-        auto it = expected_types_map.find(name);
-        if (it != expected_types_map.end()) return it->second;
-        return duckdb::LogicalType(duckdb::LogicalTypeId::INVALID);
-    };
+    rebind_statement(*prep);
 
     duckdb::vector<duckdb::Value> values;
     values.reserve(nparams);
@@ -898,28 +1524,33 @@ void PGSession::handle_bind(const std::vector<char> &body)
         if (pos + 4 > body.size()) { enqueue_error("malformed Bind param len", "08P01"); in_error_ = true; return; }
         int32_t plen = (int32_t)ntohl(*reinterpret_cast<const uint32_t *>(body.data() + pos));
         pos += 4;
+        if (plen > 0 && pos + plen > body.size()) { enqueue_error("malformed Bind param", "08P01"); in_error_ = true; return; }
         int16_t fmt = 0;
         if (nfmts == 1) fmt = param_formats[0];
         else if (nfmts > 1 && i < nfmts) fmt = param_formats[i];
-        uint32_t type_oid = (i < prep->param_type_oids.size()) ? prep->param_type_oids[i] : 0;
 
+        // Decoders (target type + cast path) are resolved on first use and
+        // reused by every later Bind of this statement.
+        auto &decoders = prep->param_decoders[fmt == 0 ? 0 : 1];
+        if (decoders.size() < nparams) decoders.resize(nparams);
+        auto &dec = decoders[i];
+        if (!dec.read)
+        {
+            uint32_t type_oid = (i < prep->param_type_oids.size()) ? prep->param_type_oids[i] : 0;
+            duckdb::LogicalType expected = (i < prep->param_types.size()) ? prep->param_types[i] : duckdb::LogicalType();
+            dec = make_param_decoder(type_oid, fmt, expected);
+        }
         const char *data_ptr = (plen < 0) ? nullptr : (body.data() + pos);
-        duckdb::Value v = pg_param_to_value(data_ptr, plen, fmt, type_oid);
-        // If the prepared statement expects a specific type, coerce.
-        if (!v.IsNull())
-        {
-            auto expected = expected_type_for(i);
-            if (expected.id() != duckdb::LogicalTypeId::INVALID &&
-                expected.id() != duckdb::LogicalTypeId::UNKNOWN &&
-                v.type() != expected)
-            {
-                duckdb::Value casted;
-                std::string err;
-                if (v.DefaultTryCastAs(expected, casted, &err))
-                    v = casted;
-            }
+        try
+        {
+            values.push_back(decode_param(dec, data_ptr, plen));
+        }
+        catch (ParamError &e)
+        {
+            enqueue_error("invalid input for parameter $" + std::to_string(i + 1) + ": " + e.what(), "22P02");
+            in_error_ = true;
+            return;
         }
-        values.push_back(std::move(v));
         if (plen > 0) pos += plen;
     }
 
@@ -938,45 +1569,53 @@ void PGSession::handle_bind(const std::vector<char> &body)
     portal->prep_name = stmt_name;
     portal->bind_values = std::move(values);
     portal->result_formats = std::move(result_fmts);
+    portal->layout = result_layout(*prep, portal->result_formats);
 
-    // If the prepared statement was deferred, pre-compute the inlined SQL and prepare it
-    // now so that Describe can return proper column types/names for SELECT-style queries.
+    // A deferred statement gets its plan now, typed after the bound values,
+    // so that Describe and Execute both use it.
     if (!prep->stmt)
     {
-        try
+        auto describe = [&](duckdb::PreparedStatement &plan)
         {
-            std::string inlined = inline_parameters(prep->query, portal->bind_values);
-            PDEBUG << "bind inlined: " << inlined;
-            auto reprep = connection_->Prepare(inlined);
-            if (reprep && !reprep->HasError())
+            auto stype = plan.GetStatementType();
+            if (stype != duckdb::StatementType::SELECT_STATEMENT &&
+                stype != duckdb::StatementType::EXPLAIN_STATEMENT)
+                return;
+            auto &names = plan.GetNames();
+            auto &types = plan.GetTypes();
+            for (idx_t i = 0; i < names.size(); i++)
             {
-                auto stype = reprep->GetStatementType();
-                if (stype == duckdb::StatementType::SELECT_STATEMENT ||
-                    stype == duckdb::StatementType::EXPLAIN_STATEMENT)
-                {
-                    auto &names = reprep->GetNames();
-                    auto &types = reprep->GetTypes();
-                    portal->result_columns.clear();
-                    for (idx_t i = 0; i < names.size(); i++)
-                    {
-                        ColumnDesc c;
-                        c.name = names[i];
-                        c.logical_type = types[i];
-                        c.col_num = (uint16_t)(i + 1);
-                        portal->result_columns.push_back(c);
-                    }
-                    portal->has_result_desc = true;
-                }
+                ColumnDesc c;
+                c.name = names[i];
+                c.logical_type = types[i];
+                c.col_num = (uint16_t)(i + 1);
+                portal->result_columns.push_back(c);
+            }
+            portal->has_result_desc = true;
+        };
+        portal->typed_stmt = typed_statement(*prep, portal->bind_values);
+        if (portal->typed_stmt)
+            describe(*portal->typed_stmt);
+        else
+        {
+            // Execute will inline the values; plan that text for its columns
+            park_open_portals();
+            try
+            {
+                std::string inlined = inline_parameters(prep->query, portal->bind_values);
+                PDEBUG << "bind inlined: " << inlined;
+                auto reprep = connection_->Prepare(inlined);
+                if (reprep && !reprep->HasError()) describe(*reprep);
             }
+            catch (...) {}
         }
-        catch (...) {}
     }
 
     portal_map_[portal_name] = portal;
     enqueue_bind_complete();
 }
 
-void PGSession::handle_describe(const std::vector<char> &body)
+void PGSession::handle_describe(const MessageBody &body)
 {
     if (body.size() < 2) { enqueue_error("malformed Describe", "08P01"); in_error_ = true; return; }
     char kind = body[0];
@@ -997,8 +1636,7 @@ void PGSession::handle_describe(const std::vector<char> &body)
         idx_t nparams = 0;
         if (prep->stmt)
         {
-            auto expected = prep->stmt->GetExpectedParameterTypes();
-            nparams = expected.size();
+            nparams = prep->param_types.size();
             if (nparams < prep->param_type_oids.size())
                 nparams = prep->param_type_oids.size();
         }
@@ -1011,22 +1649,11 @@ void PGSession::handle_describe(const std::vector<char> &body)
                 oids.push_back(0); // unknown
         }
         enqueue_parameter_description(oids);
-        // RowDescription or NoData
-        if (prep->stmt && prep->stmt->GetStatementType() == duckdb::StatementType::SELECT_STATEMENT)
-        {
-            std::vector<ColumnDesc> cols;
-            auto &names = prep->stmt->GetNames();
-            auto &types = prep->stmt->GetTypes();
-            for (idx_t i = 0; i < names.size(); i++)
-            {
-                ColumnDesc c;
-                c.name = names[i];
-                c.logical_type = types[i];
-                c.col_num = i + 1;
-                cols.push_back(c);
-            }
-            enqueue_row_description(cols);
-        }
+        // RowDescription (all columns text, formats are not known before
+        // Bind) or NoData
+        static const std::vector<int16_t> text_formats;
+        if (auto layout = result_layout(*prep, text_formats))
+            out_buf_.insert(out_buf_.end(), layout->row_description.begin(), layout->row_description.end());
         else
         {
             enqueue_no_data();
@@ -1049,27 +1676,14 @@ void PGSession::handle_describe(const std::vector<char> &body)
             in_error_ = true;
             return;
         }
-        auto &prep = prep_it->second;
         if (portal->has_result_desc && !portal->result_columns.empty())
         {
             enqueue_row_description(portal->result_columns, &portal->result_formats);
         }
-        else if (prep->stmt && prep->stmt->GetStatementType() == duckdb::StatementType::SELECT_STATEMENT)
+        else if (portal->layout)
         {
-            std::vector<ColumnDesc> cols;
-            auto &names = prep->stmt->GetNames();
-            auto &types = prep->stmt->GetTypes();
-            for (idx_t i = 0; i < names.size(); i++)
-            {
-                ColumnDesc c;
-                c.name = names[i];
-                c.logical_type = types[i];
-                c.col_num = (uint16_t)(i + 1);
-                cols.push_back(c);
-            }
-            portal->result_columns = cols;
-            portal->has_result_desc = true;
-            enqueue_row_description(cols, &portal->result_formats);
+            auto &bytes = portal->layout->row_description;
+            out_buf_.insert(out_buf_.end(), bytes.begin(), bytes.end());
         }
         else
         {
@@ -1125,9 +1739,11 @@ static std::string value_to_sql_literal(const duckdb::Value &v)
     }
 }
 
-// Replace $1, $2, ... placeholders in the SQL with the supplied values. Respects
-// single-quote strings, double-quote identifiers, dollar-quoted strings, and SQL comments.
-static std::string inline_parameters(const std::string &sql, const duckdb::vector<duckdb::Value> &values)
+// Replace $1..$count placeholders in the SQL with render(index, out), which
+// appends the replacement. Respects single-quote strings, double-quote
+// identifiers, dollar-quoted strings, and SQL comments.
+template <class Render>
+static std::string replace_parameters(const std::string &sql, size_t count, Render render)
 {
     std::string out;
     out.reserve(sql.size());
@@ -1172,9 +1788,9 @@ static std::string inline_parameters(const std::string &sql, const duckdb::vecto
             size_t idx_start = j;
             while (j < sql.size() && std::isdigit((unsigned char)sql[j])) j++;
             int n = std::stoi(sql.substr(idx_start, j - idx_start));
-            if (n >= 1 && (size_t)n <= values.size())
+            if (n >= 1 && (size_t)n <= count)
             {
-                out += value_to_sql_literal(values[n - 1]);
+                render((size_t)(n - 1), out);
                 i = j;
                 continue;
             }
@@ -1185,7 +1801,85 @@ static std::string inline_parameters(const std::string &sql, const duckdb::vecto
     return out;
 }
 
-void PGSession::handle_execute(const std::vector<char> &body)
+static std::string inline_parameters(const std::string &sql, const duckdb::vector<duckdb::Value> &values)
+{
+    return replace_parameters(sql, values.size(),
+                              [&](size_t i, std::string &out) { out += value_to_sql_literal(values[i]); });
+}
+
+// Strings and NULLs stay untyped so that DuckDB infers their type from the
+// context, as it would for a quoted literal.
+static bool param_needs_cast(const duckdb::Value &v)
+{
+    return !v.IsNull() && v.type().id() != duckdb::LogicalTypeId::VARCHAR;
+}
+
+// Distinct plans kept per deferred statement
+static const size_t max_typed_statements = 16;
+
+// Plan of a deferred statement with each parameter cast to the type of its
+// bound value ("$1" -> "$1::INTEGER"), prepared once per type signature.
+std::shared_ptr<duckdb::PreparedStatement> PGSession::typed_statement(PreparedStatementEntry &prep,
+                                                                     const duckdb::vector<duckdb::Value> &values)
+{
+    std::string signature;
+    for (auto &v : values)
+    {
+        if (param_needs_cast(v)) signature += v.type().ToString();
+        signature.push_back(',');
+    }
+    auto it = prep.typed_stmts.find(signature);
+    if (it != prep.typed_stmts.end()) return it->second;
+    if (prep.typed_stmts.size() >= max_typed_statements) return nullptr;
+
+    std::string typed = replace_parameters(prep.query, values.size(), [&](size_t i, std::string &out)
+    {
+        out += "$" + std::to_string(i + 1);
+        if (param_needs_cast(values[i])) out += "::" + values[i].type().ToString();
+    });
+    PDEBUG << "bind typed: " << typed;
+    std::shared_ptr<duckdb::PreparedStatement> plan;
+    park_open_portals();
+    try
+    {
+        auto stmt = connection_->Prepare(typed);
+        if (stmt && !stmt->HasError())
+            plan.reset(stmt.release());
+        else if (stmt)
+            PDEBUG << "typed Prepare failed (inline instead): " << stmt->GetError();
+    }
+    catch (std::exception &e)
+    {
+        PDEBUG << "typed Prepare exception (inline instead): " << e.what();
+    }
+    prep.typed_stmts[signature] = plan;
+    return plan;
+}
+
+// Executes per batch before it is run regardless of the Sync window
+static const size_t max_batch_executes = 16384;
+// Largest number of VALUES rows in one multi-row INSERT
+static const idx_t max_batch_rows = 256;
+
+// Row count reported by a DML result (first value of its first row)
+static idx_t affected_rows(duckdb::QueryResult &res)
+{
+    idx_t count = 0;
+    auto chunk = res.Fetch();
+    if (chunk && chunk->size() > 0 && chunk->ColumnCount() > 0)
+    {
+        try
+        {
+            count = (idx_t)chunk->GetValue(0, 0).GetValue<int64_t>();
+        }
+        catch (...) { count = 0; }
+    }
+    while (chunk && chunk->size() > 0)
+        chunk = res.Fetch();
+    return count;
+}
+
+void PGSession::handle_execute(const MessageBody &body)
 {
     size_t pos = 0;
     auto read_cstr = [&](std::string &out)
@@ -1199,7 +1893,6 @@ void PGSession::handle_execute(const std::vector<char> &body)
     read_cstr(portal_name);
     if (pos + 4 > body.size()) { enqueue_error("malformed Execute", "08P01"); in_error_ = true; return; }
     int32_t max_rows = (int32_t)ntohl(*reinterpret_cast<const uint32_t *>(body.data() + pos));
-    (void)max_rows;
 
     auto it = portal_map_.find(portal_name);
     if (it == portal_map_.end())
@@ -1210,6 +1903,24 @@ void PGSession::handle_execute(const std::vector<char> &body)
     }
     auto &portal = it->second;
     auto prep_it = prep_map_.find(portal->prep_name);
+    int txn = prep_it != prep_map_.end() ? statement_txn_kind(prep_it->second->query) : 0;
+    if (tx_status_ == 'E' && txn != 2 && txn != 3)
+    {
+        enqueue_error(aborted_txn_message, "25P02");
+        in_error_ = true;
+        return;
+    }
+    if (portal->result)
+    {
+        // Suspended by an earlier Execute: continue from the open stream
+        stream_portal(portal, max_rows, nullptr);
+        return;
+    }
+    if (portal->exhausted)
+    {
+        enqueue_command_complete(statement_tag_for(portal->stmt_type, 0));
+        return;
+    }
     if (prep_it == prep_map_.end())
     {
         enqueue_error("prepared statement for portal missing", "26000");
@@ -1217,21 +1928,54 @@ void PGSession::handle_execute(const std::vector<char> &body)
         return;
     }
     auto &prep = prep_it->second;
+    rebind_statement(*prep);
 
+    if (batch_stmt_ && batch_stmt_ != prep)
+    {
+        flush_batch();
+        if (in_error_) return;
+    }
+    if (txn)
+    {
+        if (!run_transaction_control(txn)) in_error_ = true;
+        return;
+    }
+    if (batch_kind(*prep) != BatchKind::NONE)
+    {
+        // Held back until something other than Bind/Execute of this
+        // statement arrives; see flush_batch().
+        batch_stmt_ = prep;
+        batch_.push_back(DeferredExecute{portal->bind_values, out_buf_.size()});
+        if (batch_.size() >= max_batch_executes) flush_batch();
+        return;
+    }
+
+    // The statement's own plan, or the one typed for this portal's values
+    duckdb::PreparedStatement *plan = prep->stmt ? prep->stmt.get() : portal->typed_stmt.get();
+
+    ResultCapture cap;
+    if (max_rows <= 0 && plan && plan->GetStatementType() == duckdb::StatementType::SELECT_STATEMENT &&
+        serve_cached_result(cap, prep->query, prep.get(), portal.get()))
+    {
+        portal->stmt_type = duckdb::StatementType::SELECT_STATEMENT;
+        portal->exhausted = true;
+        return;
+    }
+
+    park_open_portals();
     duckdb::unique_ptr<duckdb::QueryResult> qres;
     duckdb::StatementType stmt_type = duckdb::StatementType::SELECT_STATEMENT;
     try
     {
-        if (prep->stmt)
+        if (plan)
         {
-            qres = prep->stmt->Execute(portal->bind_values, false);
-            stmt_type = prep->stmt->GetStatementType();
+            qres = plan->Execute(portal->bind_values, true);
+            stmt_type = plan->GetStatementType();
         }
         else
         {
-            // Deferred: inline the parameters directly into the SQL text and run as a
-            // plain query. This side-steps DuckDB's parameter-type inference issues for
-            // queries like "col + $1" where the type of $1 cannot be inferred up-front.
+            // No plan could be typed for these values: inline them into the
+            // SQL text and run it as a plain query.
             std::string inlined = inline_parameters(prep->query, portal->bind_values);
             PDEBUG << "execute inlined: " << inlined;
             qres = connection_->SendQuery(inlined);
@@ -1247,97 +1991,548 @@ void PGSession::handle_execute(const std::vector<char> &body)
     }
     if (qres->HasError())
     {
-        std::string err = qres->GetError();
-        std::string elower = boost::algorithm::to_lower_copy(err);
-        if (elower.find("cannot start a transaction within a transaction") != std::string::npos)
+        enqueue_error(qres->GetError(), "XX000");
+        in_error_ = true;
+        return;
+    }
+
+    bool is_select =
+        (stmt_type == duckdb::StatementType::SELECT_STATEMENT) ||
+        (stmt_type == duckdb::StatementType::EXPLAIN_STATEMENT) ||
+        (stmt_type == duckdb::StatementType::EXECUTE_STATEMENT) ||
+        (stmt_type == duckdb::StatementType::CALL_STATEMENT);
+
+    if (is_select)
+    {
+        // The statement's own plan has its encoders ready, unless DuckDB
+        // rebound it to other types since
+        auto &layout = portal->layout;
+        if (layout && plan == prep->stmt.get() && layout->types == qres->types)
+            portal->encoders = std::shared_ptr<const std::vector<PGColumnEncoder>>(layout, &layout->encoders);
+        else
+            portal->encoders = std::make_shared<const std::vector<PGColumnEncoder>>(
+                make_column_encoders(qres->types, portal->result_formats));
+        portal->stmt_type = stmt_type;
+        portal->result = std::move(qres);
+        stream_portal(portal, max_rows, [this, stmt_type, prep, cap]()
+                      {
+                          note_statement(stmt_type, prep->query, prep.get());
+                          store_cached_result(cap, prep->query, prep.get());
+                      });
+        return;
+    }
+
+    idx_t rows = affected_rows(*qres);
+    if (plan) note_statement(stmt_type, prep->query, prep.get());
+    else note_statement(stmt_type, std::string()); // tables of the inlined SQL are not kept
+    enqueue_command_complete(statement_tag_for(stmt_type, rows));
+}
+
+// --- pipelined Execute batches ---
+
+// An identifier token, unquoted; false for punctuation and string literals
+static bool identifier(const std::string &tok, std::string &name)
+{
+    if (tok.empty() || tok[0] == '\'' || (tok.size() == 1 && std::strchr("=,;().", tok[0]))) return false;
+    if (tok[0] != '"')
+    {
+        name = tok;
+        return true;
+    }
+    name.clear();
+    for (size_t i = 1; i + 1 < tok.size(); i++)
+    {
+        name += tok[i];
+        if (tok[i] == '"') i++; // doubled quote
+    }
+    return true;
+}
+
+// Splits sql into out if it is an INSERT of one row of parameters (see
+// InsertValues)
+static bool parse_insert_values(const std::string &sql, InsertValues &out)
+{
+    SqlLexer lex(sql);
+    std::string tok;
+    InsertValues ins;
+    if (!lex.next(tok) || tok != "insert" || !lex.next(tok) || tok != "into") return false;
+    if (!lex.next(tok) || !identifier(tok, ins.table) || !lex.next(tok)) return false;
+    if (tok == ".")
+    {
+        ins.schema = std::move(ins.table);
+        if (!lex.next(tok) || !identifier(tok, ins.table) || !lex.next(tok)) return false;
+    }
+    if (ins.schema == "public") ins.schema.clear();
+    if (tok == "(")
+    {
+        do
         {
-            enqueue_command_complete("BEGIN");
-            return;
+            std::string col;
+            if (!lex.next(tok) || !identifier(tok, col) || !lex.next(tok)) return false;
+            ins.columns.push_back(std::move(col));
+        } while (tok == ",");
+        if (tok != ")" || !lex.next(tok)) return false;
+    }
+    if (tok != "values") return false;
+    ins.head.assign(sql.data(), lex.pos());
+    ins.head += ' ';
+    if (!lex.next(tok) || tok != "(") return false;
+    do
+    {
+        if (!lex.next(tok) || tok != "$" + std::to_string(ins.width + 1) || !lex.next(tok)) return false;
+        ins.width++;
+    } while (tok == ",");
+    if (tok != ")") return false;
+    // ON CONFLICT is repeated after the rows. Rows of one batch that conflict
+    // with each other make the statement fail; it is then replayed row by row.
+    const char *row_end = lex.pos();
+    const char *tail_end = row_end;
+    bool conflict = false;
+    while (lex.next(tok) && tok != ";")
+    {
+        if (tail_end == row_end)
+        {
+            std::string kw;
+            if (tok != "on" || !lex.next(kw) || kw != "conflict") return false;
+            conflict = true;
+        }
+        if (tok[0] == '$') return false; // parameters belong to the one row
+        tail_end = lex.pos();
+    }
+    if (lex.next(tok)) return false;
+    if (conflict) ins.tail.assign(row_end, tail_end);
+    out = std::move(ins);
+    return true;
+}
+
+std::string InsertValues::qualified_table() const
+{
+    if (schema.empty()) return quote_ident(table);
+    return quote_ident(schema) + "." + quote_ident(table);
+}
+
+// Whether sql has the keyword RETURNING, whose rows DML does not forward
+static bool has_returning(const std::string &sql)
+{
+    SqlLexer lex(sql);
+    std::string tok;
+    while (lex.next(tok))
+        if (tok == "returning") return true;
+    return false;
+}
+
+// Whether the INSERT fills every column of the table in order, as the
+// Appender does (no defaults, no reordering)
+static bool appends_whole_rows(duckdb::Connection &con, const InsertValues &ins)
+{
+    try
+    {
+        auto all = con.Prepare("SELECT * FROM " + ins.qualified_table() + " LIMIT 0");
+        if (all->HasError() || all->GetNames().size() != ins.width) return false;
+        for (size_t i = 0; i < ins.columns.size(); i++)
+            if (i >= ins.width || !boost::algorithm::iequals(all->GetNames()[i], ins.columns[i])) return false;
+        return ins.columns.empty() || ins.columns.size() == ins.width;
+    }
+    catch (std::exception &)
+    {
+        return false;
+    }
+}
+
+// Decide once per statement whether its Executes may be batched
+BatchKind PGSession::batch_kind(PreparedStatementEntry &prep)
+{
+    if (prep.batch_kind != BatchKind::UNKNOWN) return prep.batch_kind;
+    prep.batch_kind = BatchKind::NONE;
+    if (!prep.stmt) return prep.batch_kind;
+    auto type = prep.stmt->GetStatementType();
+    if (type != duckdb::StatementType::INSERT_STATEMENT && type != duckdb::StatementType::UPDATE_STATEMENT &&
+        type != duckdb::StatementType::DELETE_STATEMENT)
+        return prep.batch_kind;
+    // Keep statements with RETURNING on the plain path
+    if (has_returning(prep.query)) return prep.batch_kind;
+    prep.batch_kind = BatchKind::ONE_BY_ONE;
+    if (type == duckdb::StatementType::INSERT_STATEMENT && parse_insert_values(prep.query, prep.insert))
+        prep.batch_kind = BatchKind::MULTI_ROW;
+    if (prep.batch_kind == BatchKind::MULTI_ROW && prep.insert.tail.empty() && insert_appender &&
+        appends_whole_rows(*connection_, prep.insert))
+        prep.batch_kind = BatchKind::APPENDER;
+    return prep.batch_kind;
+}
+
+// Run the held-back Executes and put their CommandComplete tags where the
+// Executes were. Unless a transaction is open, the batch runs in one
+// transaction, like PG's implicit transaction up to Sync; rollback = true
+// rolls it back because a later message of the window failed.
+void PGSession::flush_batch(bool rollback)
+{
+    auto prep = std::move(batch_stmt_);
+    std::vector<DeferredExecute> batch;
+    batch.swap(batch_);
+    if (batch.empty()) return;
+
+    std::vector<std::string> tags;
+    std::string error;
+    bool autocommit = connection_->IsAutoCommit();
+    // Multi-row INSERTs and appended rows are replayed one by one when they
+    // fail, to place the error after the right tags; that takes a transaction
+    // of our own to roll back. Inside the client's transaction the Executes
+    // run one by one from the start.
+    BatchKind kind = autocommit ? prep->batch_kind : BatchKind::ONE_BY_ONE;
+    bool own_txn = (batch.size() > 1 || rollback || kind == BatchKind::APPENDER) && autocommit;
+    auto run = [&](BatchKind run_kind)
+    {
+        tags.clear();
+        error.clear();
+        try
+        {
+            if (own_txn) connection_->BeginTransaction();
+            run_batch(*prep, batch, run_kind, tags);
+            if (own_txn)
+            {
+                if (rollback) connection_->Rollback();
+                else connection_->Commit();
+            }
         }
-        if (elower.find("cannot commit - there is no transaction active") != std::string::npos)
+        catch (std::exception &e)
         {
-            enqueue_command_complete("COMMIT");
-            return;
+            error = e.what();
+            if (own_txn && !connection_->IsAutoCommit())
+            {
+                try { connection_->Rollback(); } catch (...) {}
+            }
         }
-        if (elower.find("cannot rollback - there is no transaction active") != std::string::npos)
+    };
+    run(kind);
+    // A multi-row statement does not tell which Execute failed, and may fail
+    // where single rows do not (rows conflicting with each other); neither
+    // does the Appender, which also fails every row once the table changed
+    // under it. The one-by-one replay's outcome stands: committed if it
+    // succeeds, else the error lands after the right tags.
+    if (!error.empty() && own_txn && kind != BatchKind::ONE_BY_ONE)
+        run(BatchKind::ONE_BY_ONE);
+
+    note_statement(prep->stmt->GetStatementType(), prep->query, prep.get());
+
+    std::vector<char> old = acquire_out_block();
+    old.swap(out_buf_);
+    size_t prev = 0;
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        out_buf_.insert(out_buf_.end(), old.begin() + prev, old.begin() + batch[i].tag_pos);
+        prev = batch[i].tag_pos;
+        if (i < tags.size())
         {
-            enqueue_command_complete("ROLLBACK");
-            return;
+            enqueue_command_complete(tags[i]);
+            continue;
         }
-        if (elower.find("current transaction is aborted") != std::string::npos)
+        // Output after the failed Execute belongs to messages PG would have skipped
+        enqueue_error(error, "XX000");
+        in_error_ = true;
+        release_out_block(std::move(old));
+        return;
+    }
+    out_buf_.insert(out_buf_.end(), old.begin() + prev, old.end());
+    release_out_block(std::move(old));
+}
+
+void PGSession::run_batch(PreparedStatementEntry &prep, std::vector<DeferredExecute> &batch, BatchKind kind,
+                          std::vector<std::string> &tags)
+{
+    auto type = prep.stmt->GetStatementType();
+    if (kind == BatchKind::APPENDER)
+    {
+        try
         {
-            // Auto-recover by rolling back, then retry once.
-            try { connection_->Query("ROLLBACK;"); } catch (...) {}
-            try
+            if (!prep.appender)
             {
-                if (prep->stmt)
-                    qres = prep->stmt->Execute(portal->bind_values, false);
+                auto &target = prep.insert;
+                if (target.schema.empty())
+                    prep.appender = duckdb::make_uniq<duckdb::Appender>(*connection_, target.table);
                 else
-                {
-                    std::string inlined = inline_parameters(prep->query, portal->bind_values);
-                    qres = connection_->SendQuery(inlined);
-                }
+                    prep.appender = duckdb::make_uniq<duckdb::Appender>(*connection_, target.schema, target.table);
             }
-            catch (...) {}
-            if (!qres || qres->HasError())
+            for (auto &row : batch)
             {
-                enqueue_error(qres ? qres->GetError() : std::string("retry failed"), "XX000");
-                in_error_ = true;
-                return;
+                prep.appender->BeginRow();
+                for (auto &v : row.values) prep.appender->Append(v);
+                prep.appender->EndRow();
             }
+            prep.appender->Flush();
         }
-        else
+        catch (...)
+        {
+            // Closing flushes the rows taken so far into our transaction,
+            // which the caller rolls back
+            try { prep.appender.reset(); } catch (...) {}
+            throw;
+        }
+        tags.assign(batch.size(), statement_tag_for(type, 1));
+        return;
+    }
+    size_t i = 0;
+    while (kind == BatchKind::MULTI_ROW && batch.size() - i > 1)
+    {
+        // Power-of-two row counts keep the number of cached statements small
+        idx_t rows = 1;
+        while (rows * 2 <= std::min<idx_t>(batch.size() - i, max_batch_rows)) rows *= 2;
+        auto &stmt = prep.batch_stmts[rows];
+        if (!stmt)
+        {
+            std::string sql = prep.insert.head;
+            idx_t param = 1;
+            for (idx_t r = 0; r < rows; r++)
+            {
+                sql += r ? ", (" : "(";
+                for (idx_t c = 0; c < prep.insert.width; c++)
+                    sql += (c ? ", $" : "$") + std::to_string(param++);
+                sql += ")";
+            }
+            sql += prep.insert.tail;
+            stmt = connection_->Prepare(sql);
+        }
+        if (stmt->HasError()) break; // fall back to one Execute per row
+        duckdb::vector<duckdb::Value> values;
+        values.reserve(rows * prep.insert.width);
+        for (idx_t r = 0; r < rows; r++)
+            for (auto &v : batch[i + r].values) values.push_back(v);
+        auto res = stmt->Execute(values, false);
+        if (res->HasError()) throw std::runtime_error(res->GetError());
+        if (affected_rows(*res) != rows) throw std::runtime_error("batched INSERT row count mismatch");
+        for (idx_t r = 0; r < rows; r++)
+            tags.push_back(statement_tag_for(type, 1));
+        i += rows;
+    }
+    for (; i < batch.size(); i++)
+    {
+        auto res = prep.stmt->Execute(batch[i].values, false);
+        if (res->HasError()) throw std::runtime_error(res->GetError());
+        tags.push_back(statement_tag_for(type, affected_rows(*res)));
+    }
+}
+
+// Send up to max_rows rows of the portal's result, as a stream (see
+// run_stream()); on_exhausted runs if the result ends meanwhile.
+void PGSession::stream_portal(std::shared_ptr<PortalEntry> portal, int32_t max_rows,
+                              std::function<void()> on_exhausted)
+{
+    idx_t limit = max_rows > 0 ? (idx_t)max_rows : std::numeric_limits<idx_t>::max();
+    idx_t sent = 0;
+    stream_msg_ = 'E';
+    stream_ = [this, portal, limit, sent, on_exhausted]() mutable -> StreamStatus
+    {
+        StreamSlice slice;
+        try
+        {
+            while (sent < limit)
+            {
+                if (!portal->pending_chunk || portal->pending_offset >= portal->pending_chunk->size())
+                {
+                    portal->pending_chunk = portal->result->Fetch();
+                    portal->pending_offset = 0;
+                    if (!portal->pending_chunk || portal->pending_chunk->size() == 0)
+                    {
+                        portal->result.reset();
+                        portal->pending_chunk.reset();
+                        portal->exhausted = true;
+                        enqueue_command_complete(statement_tag_for(portal->stmt_type, sent));
+                        if (on_exhausted) on_exhausted();
+                        return STREAM_DONE;
+                    }
+                }
+                idx_t begin = portal->pending_offset;
+                idx_t end = std::min<idx_t>(portal->pending_chunk->size(), begin + (limit - sent));
+                encode_data_rows(out_buf_, *portal->pending_chunk, *portal->encoders, begin, end);
+                portal->pending_offset = end;
+                sent += end - begin;
+                StreamStatus st = stream_pause(slice);
+                if (st == STREAM_GONE) return STREAM_DONE; // client went away mid-result
+                if (st != STREAM_MORE && sent < limit) return st;
+            }
+        }
+        catch (std::exception &e)
         {
-            enqueue_error(err, "XX000");
+            portal->result.reset();
+            portal->pending_chunk.reset();
+            portal->exhausted = true;
+            enqueue_error(e.what(), "XX000");
             in_error_ = true;
-            return;
+            return STREAM_DONE;
+        }
+        // Like PG, a portal that stops exactly at its last row is still
+        // suspended; the next Execute returns no rows and the completion tag.
+        enqueue_portal_suspended();
+        return STREAM_DONE;
+    };
+}
+
+// DuckDB closes a connection's open streaming result as soon as anything
+// else runs on it, so buffer the remainder of every suspended portal
+// (except keep) before issuing another statement.
+void PGSession::park_open_portals(const PortalEntry *keep)
+{
+    for (auto &kv : portal_map_)
+    {
+        auto &p = *kv.second;
+        if (&p == keep || !p.result || p.result->type != duckdb::QueryResultType::STREAM_RESULT)
+            continue;
+        try
+        {
+            p.result = static_cast<duckdb::StreamQueryResult &>(*p.result).Materialize();
+        }
+        catch (std::exception &e)
+        {
+            PDEBUG << "materialize suspended portal failed: " << e.what();
+            p.result.reset();
+            p.pending_chunk.reset();
+            p.exhausted = true;
         }
     }
+}
 
-    bool is_select =
-        (stmt_type == duckdb::StatementType::SELECT_STATEMENT) ||
-        (stmt_type == duckdb::StatementType::EXPLAIN_STATEMENT) ||
-        (stmt_type == duckdb::StatementType::EXECUTE_STATEMENT) ||
-        (stmt_type == duckdb::StatementType::CALL_STATEMENT);
+// --- COPY ---
+// Takes over COPY ... FROM STDIN / TO STDOUT; returns false for any other statement.
+bool PGSession::start_copy(const std::string &query)
+{
+    if (query.size() < 4 || !boost::algorithm::istarts_with(query, "copy"))
+        return false;
+    CopyStatement stmt;
+    try
+    {
+        if (!parse_copy_statement(query, stmt))
+            return false;
+        park_open_portals();
+        if (!stmt.from_stdin)
+        {
+            run_copy_out(stmt);
+            return true;
+        }
+        copy_in_.reset(new CopyInLoader(*connection_, stmt));
+    }
+    catch (CopyError &e)
+    {
+        enqueue_error(e.what(), e.sqlstate);
+        enqueue_ready_for_query();
+        flush_output();
+        return true;
+    }
+    catch (std::exception &e)
+    {
+        enqueue_error(e.what(), "XX000");
+        enqueue_ready_for_query();
+        flush_output();
+        return true;
+    }
+    enqueue_copy_in_response((int16_t)copy_in_->column_count());
+    flush_output();
+    return true;
+}
 
-    idx_t row_count = 0;
-    if (is_select)
+// COPY ... TO STDOUT: one CopyData message per result chunk.
+void PGSession::run_copy_out(const CopyStatement &stmt)
+{
+    std::string sql = stmt.query;
+    if (sql.empty())
+    {
+        sql = "SELECT ";
+        if (stmt.columns.empty()) sql += "*";
+        for (size_t i = 0; i < stmt.columns.size(); i++)
+            sql += (i ? ", " : "") + quote_ident(stmt.columns[i]);
+        sql += " FROM " + stmt.qualified_table();
+    }
+    auto result = connection_->SendQuery(sql);
+    if (result->HasError())
     {
-        std::vector<int16_t> fmts(qres->ColumnCount(), 0);
-        if (portal->result_formats.size() == 1)
-            fmts.assign(qres->ColumnCount(), portal->result_formats[0]);
-        else if (!portal->result_formats.empty())
-        {
-            for (size_t i = 0; i < fmts.size() && i < portal->result_formats.size(); i++)
-                fmts[i] = portal->result_formats[i];
-        }
+        enqueue_error(result->GetError(), "XX000");
+        enqueue_ready_for_query();
+        flush_output();
+        return;
+    }
+    struct CopyOutStream
+    {
+        duckdb::unique_ptr<duckdb::QueryResult> result;
+        CopyOutEncoder encoder;
+        idx_t rows = 0;
+    };
+    auto cs = std::make_shared<CopyOutStream>(
+        CopyOutStream{nullptr, CopyOutEncoder(stmt, result->types, result->names)});
+    cs->result = std::move(result);
+    auto &encoder = cs->encoder;
+    size_t len_pos = begin_message(out_buf_, 'H');
+    append_u8(out_buf_, (uint8_t)encoder.wire_format());
+    append_i16(out_buf_, (int16_t)encoder.column_count());
+    for (size_t i = 0; i < encoder.column_count(); i++)
+        append_i16(out_buf_, encoder.wire_format());
+    end_message(out_buf_, len_pos);
+    encoder.begin(out_buf_);
+
+    stream_msg_ = 'Q';
+    stream_ = [this, cs]() -> StreamStatus
+    {
+        StreamSlice slice;
         while (true)
         {
-            auto chunk = qres->Fetch();
+            auto chunk = cs->result->Fetch();
             if (!chunk || chunk->size() == 0) break;
-            for (idx_t r = 0; r < chunk->size(); r++)
-                enqueue_data_row_chunk(*chunk, r, fmts);
-            row_count += chunk->size();
+            cs->encoder.encode_chunk(out_buf_, *chunk);
+            cs->rows += chunk->size();
+            StreamStatus st = stream_pause(slice);
+            if (st == STREAM_GONE) return STREAM_DONE; // client went away mid-result
+            if (st != STREAM_MORE) return st;
         }
+        cs->encoder.end(out_buf_);
+        append_empty_message(out_buf_, 'c'); // CopyDone
+        enqueue_command_complete("COPY " + std::to_string(cs->rows));
+        cs->result.reset(); // before a pooled connection is given back
+        enqueue_ready_for_query();
+        flush_output();
+        return STREAM_DONE;
+    };
+}
+
+void PGSession::handle_copy_data(const MessageBody &body)
+{
+    try
+    {
+        copy_in_->feed(body.data(), body.size());
     }
-    else
+    catch (CopyError &e) { fail_copy_in(e.what(), e.sqlstate); }
+    catch (std::exception &e) { fail_copy_in(e.what(), "XX000"); }
+}
+
+void PGSession::handle_copy_done()
+{
+    idx_t rows = 0;
+    try
     {
-        auto chunk = qres->Fetch();
-        if (chunk && chunk->size() > 0 && chunk->ColumnCount() > 0)
-        {
-            try
-            {
-                row_count = (idx_t)chunk->GetValue(0, 0).GetValue<int64_t>();
-            }
-            catch (...) { row_count = 0; }
-        }
-        while (chunk && chunk->size() > 0)
-            chunk = qres->Fetch();
+        rows = copy_in_->finish();
     }
-    enqueue_command_complete(statement_tag_for(stmt_type, row_count));
+    catch (CopyError &e) { fail_copy_in(e.what(), e.sqlstate); return; }
+    catch (std::exception &e) { fail_copy_in(e.what(), "XX000"); return; }
+    note_written_tables({result_cache_table_name(copy_in_->statement().table)});
+    copy_in_.reset();
+    enqueue_command_complete("COPY " + std::to_string(rows));
+    enqueue_ready_for_query();
+    flush_output();
 }
 
-void PGSession::handle_close(const std::vector<char> &body)
+void PGSession::handle_copy_fail(const MessageBody &body)
+{
+    std::string reason(body.data(), body.empty() ? 0 : strnlen(body.data(), body.size()));
+    fail_copy_in("COPY from stdin failed: " + reason, "57014");
+}
+
+// Leave copy-in mode with an error; copy messages still in flight are dropped.
+void PGSession::fail_copy_in(const std::string &message, const std::string &sqlstate)
+{
+    copy_in_->abort();
+    copy_in_.reset();
+    enqueue_error(message, sqlstate);
+    enqueue_ready_for_query();
+    flush_output();
+}
+
+void PGSession::handle_close(const MessageBody &body)
 {
     if (body.size() < 2) { enqueue_error("malformed Close", "08P01"); in_error_ = true; return; }
     char kind = body[0];
@@ -1359,270 +2554,473 @@ void PGSession::handle_flush()
     flush_output();
 }
 
+// --- result cache ---
+
+// What a statement does to cached results once it has run
+enum CacheEffect { CACHE_NONE, CACHE_WRITES_TABLES, CACHE_SESSION_SETTINGS, CACHE_WRITES_ANY };
+
+static CacheEffect cache_effect(duckdb::StatementType t)
+{
+    switch (t)
+    {
+    case duckdb::StatementType::SELECT_STATEMENT:
+    case duckdb::StatementType::EXPLAIN_STATEMENT:
+    case duckdb::StatementType::TRANSACTION_STATEMENT:
+    case duckdb::StatementType::PREPARE_STATEMENT:
+        return CACHE_NONE;
+    case duckdb::StatementType::INSERT_STATEMENT:
+    case duckdb::StatementType::UPDATE_STATEMENT:
+    case duckdb::StatementType::DELETE_STATEMENT:
+    case duckdb::StatementType::COPY_STATEMENT:
+        return CACHE_WRITES_TABLES;
+    case duckdb::StatementType::SET_STATEMENT:
+    case duckdb::StatementType::VARIABLE_SET_STATEMENT:
+    case duckdb::StatementType::PRAGMA_STATEMENT:
+        return CACHE_SESSION_SETTINGS;
+    default:
+        return CACHE_WRITES_ANY; // DDL, ATTACH, CALL, EXECUTE, ...
+    }
+}
+
+static void append_key_part(std::string &key, const std::string &part)
+{
+    key += std::to_string(part.size());
+    key.push_back(':');
+    key += part;
+}
+
+// Serves the result of sql (with the portal's parameters and result formats,
+// or as a simple query) from the cache. On a miss, prepares cap so that
+// store_cached_result() can keep what gets encoded next.
+bool PGSession::serve_cached_result(ResultCapture &cap, const std::string &sql, PreparedStatementEntry *prep,
+                                    const PortalEntry *portal)
+{
+    if (!result_cache().enabled() || result_cache_bypass_ || !connection_->IsAutoCommit())
+        return false;
+    if (prep)
+    {
+        if (!prep->result_cacheable) prep->result_cacheable = result_cacheable_sql(sql);
+        if (!*prep->result_cacheable) return false;
+    }
+    else if (!result_cacheable_sql(sql))
+        return false;
+
+    std::string key;
+    append_key_part(key, db_name_);
+    append_key_part(key, sql);
+    if (portal)
+    {
+        key.push_back('E');
+        for (auto &v : portal->bind_values)
+        {
+            key.push_back((char)v.type().id());
+            if (v.IsNull()) key.push_back('N');
+            else append_key_part(key, v.ToString());
+        }
+        key.push_back('F');
+        for (auto f : portal->result_formats)
+            key.push_back(f ? '1' : '0');
+    }
+    else
+        key.push_back('Q');
+
+    if (result_cache().lookup(key, out_buf_))
+        return true;
+    cap.key = std::move(key);
+    cap.stamp = result_cache().stamp();
+    cap.start = out_buf_.size();
+    cap.flushes = out_flushes_;
+    return false;
+}
+
+// Keeps everything encoded since serve_cached_result() missed, unless part
+// of it has already been sent.
+void PGSession::store_cached_result(const ResultCapture &cap, const std::string &sql, PreparedStatementEntry *prep)
+{
+    if (cap.key.empty() || in_error_ || out_flushes_ != cap.flushes)
+        return;
+    std::vector<std::string> scratch;
+    auto tables = statement_tables(sql, prep, scratch);
+    if (!tables) return;
+    result_cache().insert(cap.key, *tables, cap.stamp, out_buf_.data() + cap.start, out_buf_.size() - cap.start);
+}
+
+// Normalized names of the tables sql reads or writes (memoized on prep);
+// nullptr if DuckDB cannot tell.
+const std::vector<std::string> *PGSession::statement_tables(const std::string &sql, PreparedStatementEntry *prep,
+                                                            std::vector<std::string> &scratch)
+{
+    if (prep && prep->tables_known)
+        return *prep->tables_known ? &prep->tables : nullptr;
+    auto &out = prep ? prep->tables : scratch;
+    bool ok = false;
+    if (!sql.empty())
+    {
+        try
+        {
+            for (auto &name : connection_->GetTableNames(sql))
+                out.push_back(result_cache_table_name(name));
+            ok = true;
+        }
+        catch (std::exception &e)
+        {
+            PDEBUG << "result cache: no table names for query: " << e.what();
+            out.clear();
+        }
+    }
+    if (prep) prep->tables_known = ok;
+    return ok ? &out : nullptr;
+}
+
+// Record the effect of a statement that ran; sql is empty when the tables
+// it touched cannot be determined.
+void PGSession::note_statement(duckdb::StatementType type, const std::string &sql, PreparedStatementEntry *prep)
+{
+    // Schema changes may alter the result columns of cached statements
+    if (cache_effect(type) == CACHE_WRITES_ANY)
+    {
+        stmt_lru_.clear();
+        stmt_cache_.clear();
+    }
+    // A pooled connection keeps what SET/USE/PRAGMA did to it: the pool
+    // replaces it once given back, and the statement runs again on the next
+    // one borrowed. A statement of a multi-statement query cannot be told
+    // apart from the others, so then the session keeps its connection.
+    if (lease_ && cache_effect(type) == CACHE_SESSION_SETTINGS)
+    {
+        lease_->settings_changed = true;
+        if (sql.empty())
+            keep_connection_ = true;
+        else
+        {
+            // Only the latest of identical statements matters
+            auto it = std::find(session_settings_.begin(), session_settings_.end(), sql);
+            if (it != session_settings_.end()) session_settings_.erase(it);
+            session_settings_.push_back(sql);
+        }
+    }
+    // DDL: the pg_catalog mirror is refreshed once the transaction has ended;
+    // meanwhile the session reads the views, which show its own changes. The
+    // mirror is copied on a connection that cannot see this session's
+    // temporary objects, so after creating one it stays on the views.
+    if (catalog_mirror().enabled())
+    {
+        bool temporary = false;
+        catalog_changes_ |= CatalogMirror::tables_changed_by(type, sql, temporary);
+        if (temporary) temp_objects_ = true;
+        if (!catalog_views_ && (temp_objects_ || (catalog_changes_ && !connection_->IsAutoCommit())))
+            use_catalog_views(true);
+    }
+    if (!result_cache().enabled()) return;
+    switch (cache_effect(type))
+    {
+    case CACHE_NONE:
+        break;
+    case CACHE_WRITES_TABLES:
+    {
+        std::vector<std::string> scratch;
+        auto tables = statement_tables(sql, prep, scratch);
+        if (tables && !tables->empty()) written_tables_.insert(tables->begin(), tables->end());
+        else written_all_ = true;
+        break;
+    }
+    case CACHE_SESSION_SETTINGS:
+        // SET/USE/PRAGMA can change how results are produced or rendered
+        result_cache_bypass_ = true;
+        break;
+    case CACHE_WRITES_ANY:
+        written_all_ = true;
+        break;
+    }
+    if (connection_->IsAutoCommit()) publish_writes();
+}
+
+void PGSession::note_written_tables(const std::vector<std::string> &tables)
+{
+    if (!result_cache().enabled()) return;
+    written_tables_.insert(tables.begin(), tables.end());
+    if (connection_->IsAutoCommit()) publish_writes();
+}
+
+// Invalidate what this session wrote. Called once the writes are committed
+// (or rolled back, which only costs some cache entries or a refresh).
+void PGSession::publish_writes()
+{
+    if (written_all_) result_cache().invalidate_all();
+    else if (!written_tables_.empty()) result_cache().invalidate(written_tables_);
+    written_all_ = false;
+    written_tables_.clear();
+    if (catalog_changes_)
+    {
+        catalog_mirror().refresh(catalog_changes_);
+        catalog_changes_ = 0;
+    }
+    if (catalog_views_ && !temp_objects_) use_catalog_views(false);
+}
+
+void PGSession::use_catalog_views(bool views)
+{
+    if (lease_) lease_->settings_changed = true;
+    auto res = connection_->Query(catalog_mirror().search_path_sql(use_db_, !views));
+    if (res->HasError())
+        PDEBUG << "search_path failed: " << res->GetError();
+    else
+        catalog_views_ = views;
+}
+
 // --- message appenders ---
 void PGSession::enqueue_parse_complete()
 {
-    std::vector<char> m = {'1', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, '1');
 }
 void PGSession::enqueue_bind_complete()
 {
-    std::vector<char> m = {'2', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, '2');
 }
 void PGSession::enqueue_close_complete()
 {
-    std::vector<char> m = {'3', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, '3');
 }
 void PGSession::enqueue_portal_suspended()
 {
-    std::vector<char> m = {'s', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, 's');
+}
+void PGSession::enqueue_copy_in_response(int16_t ncols)
+{
+    size_t len_pos = begin_message(out_buf_, 'G');
+    append_u8(out_buf_, 0); // text (CSV is text as far as the protocol goes)
+    append_i16(out_buf_, ncols);
+    for (int16_t i = 0; i < ncols; i++)
+        append_i16(out_buf_, 0);
+    end_message(out_buf_, len_pos);
 }
 void PGSession::enqueue_empty_query_response()
 {
-    std::vector<char> m = {'I', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, 'I');
 }
 void PGSession::enqueue_no_data()
 {
-    std::vector<char> m = {'n', 0, 0, 0, 4};
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    append_empty_message(out_buf_, 'n');
 }
 
 void PGSession::enqueue_parameter_description(const std::vector<uint32_t> &param_oids)
 {
-    std::vector<char> msg;
-    msg.push_back('t');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0);
-    append_u16(msg, (uint16_t)param_oids.size());
+    size_t len_pos = begin_message(out_buf_, 't');
+    append_u16(out_buf_, (uint16_t)param_oids.size());
     for (auto oid : param_oids)
-        append_u32(msg, oid);
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+        append_u32(out_buf_, oid);
+    end_message(out_buf_, len_pos);
 }
 
-void PGSession::enqueue_row_description(const std::vector<ColumnDesc> &columns,
-                                        const std::vector<int16_t> *result_formats)
+static void append_row_description(std::vector<char> &out, const std::vector<ColumnDesc> &columns,
+                                   const std::vector<int16_t> *result_formats)
 {
-    std::vector<char> msg;
-    msg.push_back('T');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0);
-    append_u16(msg, (uint16_t)columns.size());
+    size_t len_pos = begin_message(out, 'T');
+    append_u16(out, (uint16_t)columns.size());
     for (size_t i = 0; i < columns.size(); i++)
     {
         const auto &col = columns[i];
-        append_cstr(msg, col.name);
-        append_u32(msg, col.table_oid);
-        append_u16(msg, col.col_num);
+        append_cstr(out, col.name);
+        append_u32(out, col.table_oid);
+        append_u16(out, col.col_num);
         uint32_t oid = pg_type_oid(col.logical_type);
-        append_u32(msg, oid);
-        append_i16(msg, pg_type_len(oid));
-        append_i32(msg, -1); // typmod
+        append_u32(out, oid);
+        append_i16(out, pg_type_len(oid));
+        append_i32(out, -1); // typmod
         int16_t fmt = 0;
         if (result_formats)
         {
             if (result_formats->size() == 1) fmt = (*result_formats)[0];
             else if (i < result_formats->size()) fmt = (*result_formats)[i];
         }
-        append_i16(msg, fmt);
+        append_i16(out, fmt);
     }
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    end_message(out, len_pos);
 }
 
-// Format a duckdb::Value into a text PG wire representation
-static std::string value_to_pg_text(const duckdb::Value &v)
+void PGSession::enqueue_row_description(const std::vector<ColumnDesc> &columns,
+                                        const std::vector<int16_t> *result_formats)
 {
-    if (v.IsNull()) return {};
-    switch (v.type().id())
-    {
-    case duckdb::LogicalTypeId::BOOLEAN:
-        return v.GetValue<bool>() ? std::string("t") : std::string("f");
-    default:
-        return v.ToString();
-    }
+    append_row_description(out_buf_, columns, result_formats);
 }
 
-void PGSession::enqueue_data_row_chunk(duckdb::DataChunk &chunk, idx_t row_idx,
-                                       const std::vector<int16_t> &formats)
+void PGSession::enqueue_data_rows(duckdb::DataChunk &chunk, const std::vector<PGColumnEncoder> &encoders)
 {
-    std::vector<char> msg;
-    msg.push_back('D');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0);
-    uint16_t ncols = (uint16_t)chunk.ColumnCount();
-    append_u16(msg, ncols);
-    for (idx_t c = 0; c < ncols; c++)
-    {
-        auto val = chunk.GetValue(c, row_idx);
-        int16_t fmt = 0;
-        if (!formats.empty())
-        {
-            if (formats.size() == 1) fmt = formats[0];
-            else if (c < formats.size()) fmt = formats[c];
-        }
-        if (val.IsNull())
-        {
-            append_i32(msg, -1);
-            continue;
-        }
-        if (fmt == 0)
-        {
-            std::string txt = value_to_pg_text(val);
-            append_i32(msg, (int32_t)txt.size());
-            msg.insert(msg.end(), txt.begin(), txt.end());
-        }
-        else
-        {
-            // Binary format: emit common numeric types in network order.
-            switch (val.type().id())
-            {
-            case duckdb::LogicalTypeId::BOOLEAN:
-            {
-                append_i32(msg, 1);
-                msg.push_back(val.GetValue<bool>() ? 1 : 0);
-                break;
-            }
-            case duckdb::LogicalTypeId::SMALLINT:
-            {
-                append_i32(msg, 2);
-                append_i16(msg, val.GetValue<int16_t>());
-                break;
-            }
-            case duckdb::LogicalTypeId::INTEGER:
-            {
-                append_i32(msg, 4);
-                append_i32(msg, val.GetValue<int32_t>());
-                break;
-            }
-            case duckdb::LogicalTypeId::BIGINT:
-            {
-                append_i32(msg, 8);
-                int64_t x = val.GetValue<int64_t>();
-                uint64_t u = (uint64_t)x;
-                uint32_t hi = htonl((uint32_t)(u >> 32));
-                uint32_t lo = htonl((uint32_t)(u & 0xFFFFFFFFULL));
-                msg.insert(msg.end(), reinterpret_cast<char *>(&hi), reinterpret_cast<char *>(&hi) + 4);
-                msg.insert(msg.end(), reinterpret_cast<char *>(&lo), reinterpret_cast<char *>(&lo) + 4);
-                break;
-            }
-            case duckdb::LogicalTypeId::FLOAT:
-            {
-                append_i32(msg, 4);
-                float f = val.GetValue<float>();
-                uint32_t i;
-                std::memcpy(&i, &f, 4);
-                append_u32(msg, i);
-                break;
-            }
-            case duckdb::LogicalTypeId::DOUBLE:
-            {
-                append_i32(msg, 8);
-                double d = val.GetValue<double>();
-                uint64_t u;
-                std::memcpy(&u, &d, 8);
-                uint32_t hi = htonl((uint32_t)(u >> 32));
-                uint32_t lo = htonl((uint32_t)(u & 0xFFFFFFFFULL));
-                msg.insert(msg.end(), reinterpret_cast<char *>(&hi), reinterpret_cast<char *>(&hi) + 4);
-                msg.insert(msg.end(), reinterpret_cast<char *>(&lo), reinterpret_cast<char *>(&lo) + 4);
-                break;
-            }
-            default:
-            {
-                // Fallback: treat as text bytes
-                std::string txt = value_to_pg_text(val);
-                append_i32(msg, (int32_t)txt.size());
-                msg.insert(msg.end(), txt.begin(), txt.end());
-                break;
-            }
-            }
-        }
-    }
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    encode_data_rows(out_buf_, chunk, encoders, 0, chunk.size());
 }
 
 void PGSession::enqueue_data_row_text(const std::vector<std::string> &values)
 {
-    std::vector<char> msg;
-    msg.push_back('D');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0);
-    append_u16(msg, (uint16_t)values.size());
+    size_t len_pos = begin_message(out_buf_, 'D');
+    append_u16(out_buf_, (uint16_t)values.size());
     for (auto &v : values)
     {
-        append_i32(msg, (int32_t)v.size());
-        msg.insert(msg.end(), v.begin(), v.end());
+        append_i32(out_buf_, (int32_t)v.size());
+        append_bytes(out_buf_, v.data(), v.size());
     }
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    end_message(out_buf_, len_pos);
 }
 
 void PGSession::enqueue_command_complete(const std::string &tag)
 {
-    std::vector<char> msg;
-    msg.push_back('C');
-    uint32_t len_pos = msg.size();
-    msg.insert(msg.end(), 4, 0);
-    append_cstr(msg, tag);
-    uint32_t total = msg.size() - len_pos;
-    uint32_t n = htonl(total);
-    std::memcpy(msg.data() + len_pos, &n, 4);
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    size_t len_pos = begin_message(out_buf_, 'C');
+    append_cstr(out_buf_, tag);
+    end_message(out_buf_, len_pos);
+}
+
+// RowDescription, DataRow and CommandComplete of each constant answer,
+// encoded once
+static const std::vector<std::vector<char>> &constant_responses()
+{
+    static const std::vector<std::vector<char>> responses = []()
+    {
+        std::vector<std::vector<char>> out;
+        for (auto &answer : constant_answers())
+        {
+            std::vector<char> buf;
+            size_t len_pos = begin_message(buf, 'T');
+            append_u16(buf, 1);
+            append_cstr(buf, answer.column);
+            append_u32(buf, 0);  // table oid
+            append_u16(buf, 0);  // column number
+            append_u32(buf, answer.type_oid);
+            append_i16(buf, pg_type_len(answer.type_oid));
+            append_i32(buf, -1); // typmod
+            append_i16(buf, 0);  // text
+            end_message(buf, len_pos);
+            len_pos = begin_message(buf, 'D');
+            append_u16(buf, 1);
+            append_i32(buf, (int32_t)std::strlen(answer.value));
+            append_bytes(buf, answer.value, std::strlen(answer.value));
+            end_message(buf, len_pos);
+            len_pos = begin_message(buf, 'C');
+            append_cstr(buf, "SELECT 1");
+            end_message(buf, len_pos);
+            out.push_back(std::move(buf));
+        }
+        return out;
+    }();
+    return responses;
+}
+
+void PGSession::enqueue_constant_answer(const ConstantAnswer &answer)
+{
+    const std::vector<char> &bytes = constant_responses()[answer.index];
+    out_buf_.insert(out_buf_.end(), bytes.begin(), bytes.end());
 }
 
 void PGSession::enqueue_ready_for_query()
 {
-    std::vector<char> m;
-    m.push_back('Z');
-    append_u32(m, 5);
-    m.push_back(tx_status_);
-    out_buf_.insert(out_buf_.end(), m.begin(), m.end());
+    sync_tx_status();
+    if ((written_all_ || !written_tables_.empty() || catalog_changes_) && autocommit())
+        publish_writes();
+    // Between transactions a pooled session needs no connection
+    if (lease_ && tx_status_ == 'I' && !copy_in_ && batch_.empty() && !keep_connection_)
+        release_connection();
+    out_buf_.push_back('Z');
+    append_u32(out_buf_, 5);
+    out_buf_.push_back(tx_status_);
+}
+
+// ErrorResponse / NoticeResponse body fields
+static void append_response(std::vector<char> &out, char type, const char *severity,
+                            const std::string &message, const std::string &sqlstate)
+{
+    size_t len_pos = begin_message(out, type);
+    out.push_back('S');
+    append_cstr(out, severity);
+    out.push_back('V');
+    append_cstr(out, severity);
+    out.push_back('C');
+    append_cstr(out, sqlstate);
+    out.push_back('M');
+    append_cstr(out, message);
+    out.push_back('\0');
+    end_message(out, len_pos);
 }
 
 void PGSession::enqueue_error(const std::string &message, const std::string &sqlstate)
 {
-    std::vector<char> body;
-    body.push_back('S');
-    body.insert(body.end(), {'E', 'R', 'R', 'O', 'R', '\0'});
-    body.push_back('V');
-    body.insert(body.end(), {'E', 'R', 'R', 'O', 'R', '\0'});
-    body.push_back('C');
-    body.insert(body.end(), sqlstate.begin(), sqlstate.end());
-    body.push_back('\0');
-    body.push_back('M');
-    body.insert(body.end(), message.begin(), message.end());
-    body.push_back('\0');
-    body.push_back('\0');
-
-    uint32_t len = 4 + (uint32_t)body.size();
-    std::vector<char> msg;
-    msg.push_back('E');
-    append_u32(msg, len);
-    msg.insert(msg.end(), body.begin(), body.end());
-    out_buf_.insert(out_buf_.end(), msg.begin(), msg.end());
+    // Like PG, any error inside a transaction block aborts it
+    if (tx_status_ != 'E' && !autocommit()) tx_status_ = 'E';
+    append_response(out_buf_, 'E', "ERROR", message, sqlstate);
+}
+
+void PGSession::enqueue_notice(const std::string &message, const std::string &sqlstate)
+{
+    append_response(out_buf_, 'N', "WARNING", message, sqlstate);
 }
 
+// Hand the buffered output to the socket. Writes are asynchronous and run on the
+// socket's io_context; the calling worker only queues the bytes.
 void PGSession::flush_output()
 {
-    std::lock_guard<std::mutex> lg(write_mtx_);
     if (out_buf_.empty()) return;
-    boost::system::error_code ec;
-    asio::write(socket_, asio::buffer(out_buf_), ec);
-    if (ec) PDEBUG << "write error: " << ec.message();
-    out_buf_.clear();
+    std::lock_guard<std::mutex> lg(write_mtx_);
+    if (write_failed_)
+    {
+        out_buf_.clear();
+        return;
+    }
+    out_flushes_++;
+    send_queued_bytes_ += out_buf_.size();
+    send_queue_.push_back(std::move(out_buf_));
+    out_buf_ = acquire_out_block();
+    if (!write_in_flight_)
+    {
+        write_in_flight_ = true;
+        asio::post(socket_.get_executor(), bind_memory(wake_mem_, [self = shared_from_this()]() { self->write_next(); }));
+    }
+}
+
+// Write every queued block with one gather write. Blocks queued meanwhile
+// go out with the next write; deque growth leaves the ones in flight alone.
+void PGSession::write_next()
+{
+    size_t nblocks;
+    {
+        std::lock_guard<std::mutex> lg(write_mtx_);
+        gather_.clear();
+        for (auto &block : send_queue_)
+        {
+            gather_.push_back(asio::buffer(block));
+            if (gather_.size() == max_gather_blocks) break;
+        }
+        nblocks = gather_.size();
+    }
+    asio::async_write(socket_, gather_, bind_memory(write_mem_,
+                      [self = shared_from_this(), nblocks](boost::system::error_code ec, size_t)
+                      {
+                          bool more;
+                          bool resume = false;
+                          {
+                              std::lock_guard<std::mutex> lg(self->write_mtx_);
+                              for (size_t i = 0; i < nblocks; i++)
+                              {
+                                  self->send_queued_bytes_ -= self->send_queue_.front().size();
+                                  release_out_block(std::move(self->send_queue_.front()));
+                                  self->send_queue_.pop_front();
+                              }
+                              if (ec)
+                              {
+                                  PDEBUG << "write error: " << ec.message();
+                                  self->write_failed_ = true;
+                                  self->send_queue_.clear();
+                                  self->send_queued_bytes_ = 0;
+                              }
+                              more = !self->send_queue_.empty();
+                              self->write_in_flight_ = more;
+                              if (self->resume_on_write_ &&
+                                  (self->write_failed_ || self->send_queued_bytes_ <= output_high_water))
+                              {
+                                  self->resume_on_write_ = false;
+                                  resume = true;
+                              }
+                          }
+                          if (resume)
+                              boost::asio::post(*self->strand_, bind_memory(self->strand_mem_, [self]() { self->resume_stream(); }));
+                          if (more) self->write_next();
+                      }));
 }
 
 void PGSession::process_materialized_result(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &result,
@@ -1672,214 +3070,95 @@ std::string PGSession::statement_tag_for(duckdb::StatementType t, idx_t row_coun
 }
 
 // Rewrite some common pg_catalog / system / JDBC-bootstrap queries that
-// DuckDB does not support natively, into queries DuckDB can execute.
-std::string PGSession::rewrite_query(const std::string &query) const
+// DuckDB does not support natively, into queries DuckDB can execute (see
+// query_rewriter.hpp). The result has no surrounding whitespace.
+std::string PGSession::rewrite_query(const std::string &query, const ConstantAnswer **answer) const
 {
-    std::string q = boost::algorithm::trim_copy(query);
-    if (q.empty()) return q;
-
-    // Strip trailing ; for comparison
-    std::string cmp = q;
-    while (!cmp.empty() && (cmp.back() == ';' || std::isspace((unsigned char)cmp.back())))
-        cmp.pop_back();
-
-    // Hardcoded minimal responses for JDBC / psql bootstrap queries
-    // These will be recognised by simple_query via translation to equivalent SELECT.
-    if (boost::algorithm::iequals(cmp,
-        "SELECT reset_val FROM pg_settings WHERE name='polar_compatibility_mode'"))
-    {
-        return "SELECT 'pg' AS reset_val";
-    }
-    if (boost::algorithm::iequals(cmp, "SHOW TRANSACTION ISOLATION LEVEL"))
-    {
-        return "SELECT 'read committed' AS transaction_isolation";
-    }
-    if (boost::algorithm::iequals(cmp, "SHOW transaction_isolation"))
-    {
-        return "SELECT 'read committed' AS transaction_isolation";
-    }
-    if (boost::algorithm::iequals(cmp, "SHOW standard_conforming_strings"))
-    {
-        return "SELECT 'on' AS standard_conforming_strings";
-    }
-    if (boost::algorithm::iequals(cmp, "SHOW server_version"))
-    {
-        return "SELECT '14.0 (PostDuck)' AS server_version";
-    }
-    if (boost::algorithm::iequals(cmp, "SELECT current_schema()"))
-    {
-        return "SELECT 'main' AS current_schema";
-    }
-    if (boost::algorithm::iequals(cmp, "SELECT version()"))
-    {
-        return "SELECT 'PostgreSQL 14.0 (PostDuck on DuckDB) on x86_64-pc-linux-gnu' AS version";
-    }
+    Rewrite r = rewrite_statement(query);
+    if (answer) *answer = r.answer;
+    return rewritten_sql(r, query);
+}
 
-    // Rewrite JDBC DatabaseMetaData queries that rely on pg_description / regclass /
-    // other PG catalog features DuckDB lacks. We match on characteristic prefixes.
-    // getTables: returns a synthetic result from duckdb_tables().
-    if (cmp.find("AS TABLE_CAT, n.nspname AS TABLE_SCHEM, c.relname AS TABLE_NAME") != std::string::npos &&
-        cmp.find("pg_catalog.pg_class") != std::string::npos)
-    {
-        return
-            "SELECT NULL AS TABLE_CAT, schema_name AS TABLE_SCHEM, table_name AS TABLE_NAME, "
-            "'TABLE' AS TABLE_TYPE, NULL AS REMARKS, "
-            "'' AS TYPE_CAT, '' AS TYPE_SCHEM, '' AS TYPE_NAME, "
-            "'' AS SELF_REFERENCING_COL_NAME, '' AS REF_GENERATION "
-            "FROM duckdb_tables() "
-            "UNION ALL "
-            "SELECT NULL, schema_name, view_name, 'VIEW', NULL, '', '', '', '', '' FROM duckdb_views() WHERE internal = false "
-            "ORDER BY TABLE_TYPE, TABLE_SCHEM, TABLE_NAME";
-    }
-    // getSchemas: JDBC uses "SELECT nspname AS TABLE_SCHEM, NULL AS TABLE_CATALOG FROM pg_catalog.pg_namespace"
-    if (cmp.find("AS TABLE_SCHEM") != std::string::npos &&
-        cmp.find("pg_catalog.pg_namespace") != std::string::npos &&
-        cmp.find("TABLE_NAME") == std::string::npos)
-    {
-        return "SELECT schema_name AS TABLE_SCHEM, catalog_name AS TABLE_CATALOG FROM duckdb_schemas() ORDER BY TABLE_SCHEM";
-    }
-    // getColumns often queries pg_attribute with complicated joins; provide a minimal fallback.
-    if (cmp.find("pg_catalog.pg_attribute") != std::string::npos &&
-        cmp.find("pg_catalog.pg_class") != std::string::npos &&
-        cmp.find("a.attname") != std::string::npos)
-    {
-        return
-            "SELECT NULL AS TABLE_CAT, table_schema AS TABLE_SCHEM, table_name AS TABLE_NAME, "
-            "column_name AS COLUMN_NAME, 0 AS DATA_TYPE, data_type AS TYPE_NAME, "
-            "NULL AS COLUMN_SIZE, NULL AS BUFFER_LENGTH, NULL AS DECIMAL_DIGITS, 10 AS NUM_PREC_RADIX, "
-            "(CASE WHEN is_nullable='YES' THEN 1 ELSE 0 END) AS NULLABLE, NULL AS REMARKS, "
-            "column_default AS COLUMN_DEF, NULL AS SQL_DATA_TYPE, NULL AS SQL_DATETIME_SUB, "
-            "NULL AS CHAR_OCTET_LENGTH, ordinal_position AS ORDINAL_POSITION, "
-            "is_nullable AS IS_NULLABLE, NULL AS SCOPE_CATALOG, NULL AS SCOPE_SCHEMA, "
-            "NULL AS SCOPE_TABLE, NULL AS SOURCE_DATA_TYPE, 'NO' AS IS_AUTOINCREMENT, "
-            "'NO' AS IS_GENERATEDCOLUMN "
-            "FROM information_schema.columns "
-            "ORDER BY TABLE_SCHEM, TABLE_NAME, ORDINAL_POSITION";
+// The SQL to run for r, the rewrite_statement() of query
+std::string PGSession::rewritten_sql(Rewrite &r, const std::string &query) const
+{
+    switch (r.rule)
+    {
+    case RewriteRule::KEEP:
+        break;
+    case RewriteRule::REPLACE:
+        return std::move(r.sql);
+    case RewriteRule::SHOW_RESULT_CACHE:
+    {
+        auto st = result_cache().stats();
+        return "SELECT " + std::to_string(st.hits) + "::UBIGINT AS hits, " +
+               std::to_string(st.misses) + "::UBIGINT AS misses, " +
+               std::to_string(st.inserts) + "::UBIGINT AS inserts, " +
+               std::to_string(st.invalidations) + "::UBIGINT AS invalidations, " +
+               std::to_string(st.evictions) + "::UBIGINT AS evictions, " +
+               std::to_string(st.entries) + "::UBIGINT AS entries, " +
+               std::to_string(st.bytes) + "::UBIGINT AS bytes";
     }
-    // Intercept transaction-control commands and let DuckDB's auto-txn behaviour
-    // handle things. We track the desired state via tx_status_ in handle_simple_query.
-    // Here we just normalise them into forms DuckDB accepts.
-    {
-        std::string lower = boost::algorithm::to_lower_copy(cmp);
-        // SHOW transaction_isolation / SHOW TRANSACTION ISOLATION LEVEL already handled.
-        // Strip PG-specific BEGIN options like "BEGIN READ WRITE" or "BEGIN ISOLATION LEVEL READ COMMITTED"
-        if (boost::algorithm::starts_with(lower, "begin") || boost::algorithm::starts_with(lower, "start transaction"))
-        {
-            return "BEGIN;";
-        }
-        if (lower == "commit" || lower == "commit transaction" || lower == "commit work" ||
-            boost::algorithm::starts_with(lower, "commit "))
-        {
-            return "COMMIT;";
-        }
-        if (lower == "rollback" || lower == "rollback transaction" || lower == "rollback work" ||
-            boost::algorithm::starts_with(lower, "rollback "))
+    case RewriteRule::SHOW_STATEMENT_CACHE:
+        return "SELECT " + std::to_string(stmt_cache_stats_.hits) + "::UBIGINT AS hits, " +
+               std::to_string(stmt_cache_stats_.misses) + "::UBIGINT AS misses, " +
+               std::to_string(stmt_cache_stats_.evictions) + "::UBIGINT AS evictions, " +
+               std::to_string(stmt_lru_.size()) + "::UBIGINT AS entries, " +
+               std::to_string(statement_cache_size) + "::UBIGINT AS capacity";
+    case RewriteRule::SHOW_WORKLOAD_CLASSES:
+    {
+        std::string rows;
+        for (auto wc : workload_classes())
         {
-            return "ROLLBACK;";
+            if (!rows.empty()) rows += ", ";
+            rows += "('" + wc->name + "', " + std::to_string(wc->threads) + "::UBIGINT, " +
+                    std::to_string(wc->queue_limit) + "::UBIGINT, " + std::to_string(wc->priority) + ", " +
+                    std::to_string(wc->queued.load()) + "::UBIGINT, " + std::to_string(wc->admitted.load()) +
+                    "::UBIGINT, " + std::to_string(wc->rejected.load()) + "::UBIGINT)";
         }
+        return "SELECT * FROM (VALUES " + rows +
+               ") AS t(name, threads, queue_limit, priority, queued, admitted, rejected)";
     }
-    // Intercept SET commands that DuckDB doesn't know about (from PG clients).
-    // Accept them as no-ops. This is important for JDBC which issues SET extra_float_digits=3,
-    // SET application_name, etc. on connect.
-    {
-        std::string lower = boost::algorithm::to_lower_copy(cmp);
-        if (boost::algorithm::starts_with(lower, "set "))
-        {
-            // Extract the parameter name (first token after SET, optionally 'session '/'local ')
-            std::string rest = boost::algorithm::trim_left_copy(cmp.substr(4));
-            std::string lrest = boost::algorithm::to_lower_copy(rest);
-            if (boost::algorithm::starts_with(lrest, "session "))
-                rest = boost::algorithm::trim_left_copy(rest.substr(8));
-            else if (boost::algorithm::starts_with(lrest, "local "))
-                rest = boost::algorithm::trim_left_copy(rest.substr(6));
-            // first identifier: tokens until '=' or whitespace
-            size_t end = 0;
-            while (end < rest.size() && rest[end] != '=' && !std::isspace((unsigned char)rest[end])) end++;
-            std::string param = rest.substr(0, end);
-            std::string pl = boost::algorithm::to_lower_copy(param);
-            // DuckDB-understood SETs we let through
-            static const std::set<std::string> duckdb_settings = {
-                "timezone", "search_path", "memory_limit", "threads",
-                "temp_directory", "allow_unsigned_extensions", "enable_progress_bar",
-                "errors_as_json", "disabled_optimizers"
-            };
-            if (duckdb_settings.count(pl) == 0)
-            {
-                return "SELECT 1 WHERE FALSE;";
-            }
-        }
-        // RESET
-        if (boost::algorithm::starts_with(lower, "reset "))
-        {
-            return "SELECT 1 WHERE FALSE;";
-        }
+    case RewriteRule::SHOW_CONNECTION_POOL:
+    {
+        if (!pool_) break;
+        auto st = pool_->stats();
+        return "SELECT " + std::to_string(st.size) + "::UBIGINT AS size, " +
+               std::to_string(st.open) + "::UBIGINT AS open, " +
+               std::to_string(st.idle) + "::UBIGINT AS idle, " +
+               std::to_string(st.waiting) + "::UBIGINT AS waiting, " +
+               std::to_string(st.acquires) + "::UBIGINT AS acquires, " +
+               std::to_string(st.waits) + "::UBIGINT AS waits";
     }
-    // Rewrite pgbench's multi-drop into separate statements: DuckDB only supports one object per DROP.
-    {
-        std::string lower = boost::algorithm::to_lower_copy(cmp);
-        if (boost::algorithm::starts_with(lower, "drop table"))
-        {
-            std::string rest = cmp.substr(std::string("drop table").size());
-            std::string rest_trim = boost::algorithm::trim_left_copy(rest);
-            bool if_exists = false;
-            std::string lower_rest = boost::algorithm::to_lower_copy(rest_trim);
-            if (boost::algorithm::starts_with(lower_rest, "if exists"))
-            {
-                if_exists = true;
-                rest_trim = boost::algorithm::trim_left_copy(rest_trim.substr(9));
-            }
-            std::vector<std::string> parts;
-            boost::algorithm::split(parts, rest_trim, boost::is_any_of(","));
-            if (parts.size() > 1)
-            {
-                std::string out;
-                for (auto &p : parts)
-                {
-                    std::string name = boost::algorithm::trim_copy(p);
-                    if (name.empty()) continue;
-                    out += "DROP TABLE ";
-                    if (if_exists) out += "IF EXISTS ";
-                    out += name + "; ";
-                }
-                return out;
-            }
-        }
-        // Rewrite multi-table TRUNCATE: "truncate table a, b, c"
-        if (boost::algorithm::starts_with(lower, "truncate"))
-        {
-            std::string rest = cmp.substr(std::string("truncate").size());
-            std::string rest_trim = boost::algorithm::trim_left_copy(rest);
-            std::string lrest = boost::algorithm::to_lower_copy(rest_trim);
-            if (boost::algorithm::starts_with(lrest, "table"))
-            {
-                rest_trim = boost::algorithm::trim_left_copy(rest_trim.substr(5));
-            }
-            std::vector<std::string> parts;
-            boost::algorithm::split(parts, rest_trim, boost::is_any_of(","));
-            if (parts.size() > 1)
-            {
-                std::string out;
-                for (auto &p : parts)
-                {
-                    std::string name = boost::algorithm::trim_copy(p);
-                    if (name.empty()) continue;
-                    out += "DELETE FROM " + name + "; ";
-                }
-                return out;
-            }
-        }
     }
-    return q;
+    return query.substr(r.begin, r.end - r.begin);
 }
 
 PGSession::~PGSession()
 {
+    // The transaction may have committed without us seeing it end
+    publish_writes();
     if (backend_pid_ != 0)
     {
         std::lock_guard<std::mutex> lg(sessions_mtx);
         sessions_map.erase(backend_pid_);
         sessions_secret.erase(backend_pid_);
     }
+    if (lease_)
+    {
+        // The client went away mid-transaction: hand the connection back clean
+        copy_in_.reset();
+        portal_map_.clear();
+        try
+        {
+            if (!lease_->conn->IsAutoCommit()) lease_->conn->Rollback();
+        }
+        catch (std::exception &e)
+        {
+            PDEBUG << "rollback of abandoned transaction failed: " << e.what();
+        }
+        pool_->release(std::move(lease_));
+    }
 }
 
 void PGSession::Cancel()
@@ -1887,8 +3166,8 @@ void PGSession::Cancel()
     PINFO << "Cancelling session pid=" << backend_pid_;
     try
     {
-        if (connection_)
-            connection_->Interrupt();
+        if (auto conn = std::atomic_load(&connection_))
+            conn->Interrupt();
     }
     catch (std::exception &e)
     {
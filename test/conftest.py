@@ -18,15 +18,17 @@ POSTDUCK_URL
 
 from __future__ import annotations
 
+import contextlib
 import os
 import pathlib
 import shutil
 import signal
 import socket
+import struct
 import subprocess
 import tempfile
 import time
-from typing import Iterator, Optional
+from typing import Callable, Iterator, Optional
 
 import psycopg2
 import pytest
@@ -107,6 +109,17 @@ class PostduckServer:
     def connect(self, **extra) -> psycopg2.extensions.connection:
         return psycopg2.connect(self.dsn, **extra)
 
+    def wire(self, **params) -> "WireConnection":
+        """A raw v3 protocol connection, for what psycopg2 never sends
+        (Execute max_rows, pipelining, binary parameters)."""
+        return WireConnection(self, **params)
+
+    def roundtrip(self, messages):
+        """Sends ``messages`` and Sync on a new raw connection and returns
+        the backend messages up to ReadyForQuery."""
+        with self.wire() as w:
+            return w.roundtrip(messages)
+
     def stop(self) -> None:
         if self.proc is None:
             return
@@ -119,6 +132,60 @@ class PostduckServer:
                 self.proc.wait()
 
 
+class WireConnection:
+    """Speaks the v3 protocol directly. Messages are (type byte, body) pairs;
+    the startup packet is sent and answered when the connection is made."""
+
+    def __init__(self, server: PostduckServer, **params):
+        startup = struct.pack("!I", 196608)
+        params = {"user": server.user, "database": server.dbname, **params}
+        for key, value in params.items():
+            startup += key.encode() + b"\0" + str(value).encode() + b"\0"
+        startup += b"\0"
+        self.sock = socket.create_connection((server.host, server.port), timeout=10)
+        self.buf = b""
+        try:
+            self.sock.sendall(struct.pack("!I", len(startup) + 4) + startup)
+            self.read_until_ready()
+        except Exception:
+            self.sock.close()
+            raise
+
+    @staticmethod
+    def frame(kind: bytes, body: bytes) -> bytes:
+        return kind + struct.pack("!I", len(body) + 4) + body
+
+    def send(self, messages) -> None:
+        self.sock.sendall(b"".join(self.frame(k, b) for k, b in messages))
+
+    def read_until_ready(self):
+        """Backend messages up to (not including) the next ReadyForQuery."""
+        replies = []
+        while True:
+            while len(self.buf) < 5 or len(self.buf) < 1 + struct.unpack("!I", self.buf[1:5])[0]:
+                data = self.sock.recv(65536)
+                assert data, "server closed the connection"
+                self.buf += data
+            n = struct.unpack("!I", self.buf[1:5])[0]
+            kind, body, self.buf = self.buf[:1], self.buf[5:1 + n], self.buf[1 + n:]
+            if kind == b"Z":
+                return replies
+            replies.append((kind, body))
+
+    def roundtrip(self, messages):
+        self.send(list(messages) + [(b"S", b"")])
+        return self.read_until_ready()
+
+    def close(self) -> None:
+        self.sock.close()
+
+    def __enter__(self) -> "WireConnection":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+
 @pytest.fixture(scope="session")
 def postduck_server() -> Iterator[PostduckServer]:
     """Session-scoped fixture that starts exactly one postduck server."""
@@ -137,6 +204,28 @@ def postduck_server() -> Iterator[PostduckServer]:
         )
         return
 
+    yield from _spawn_server([])
+
+
+@pytest.fixture(scope="session")
+def spawn_server() -> Iterator[Callable[..., PostduckServer]]:
+    """Factory for servers started with extra command-line options, e.g.
+    ``spawn_server("--pool-size", "2")``. Each set of options starts one
+    server for the whole session. Tests needing one are skipped when the
+    suite runs against POSTDUCK_URL."""
+    servers = {}
+    with contextlib.ExitStack() as stack:
+        def spawn(*args: str) -> PostduckServer:
+            if os.environ.get("POSTDUCK_URL"):
+                pytest.skip("needs a server started with " + " ".join(args))
+            if args not in servers:
+                servers[args] = stack.enter_context(contextlib.contextmanager(_spawn_server)(list(args)))
+            return servers[args]
+
+        yield spawn
+
+
+def _spawn_server(extra_args) -> Iterator[PostduckServer]:
     binary = _find_postduck_binary()
     port = _free_tcp_port()
     data_dir = pathlib.Path(tempfile.mkdtemp(prefix="postduck-test-"))
@@ -150,6 +239,7 @@ def postduck_server() -> Iterator[PostduckServer]:
             "--data", str(data_dir),
             "--thread", "4",
             "--log", "INFO",
+            *extra_args,
         ],
         stdout=log_fh,
         stderr=subprocess.STDOUT,
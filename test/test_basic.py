@@ -4,6 +4,12 @@ import psycopg2
 import pytest
 
 
+@pytest.fixture(scope="module")
+def autoparam_server(spawn_server):
+    """A server running simple queries through auto-parameterized plans."""
+    return spawn_server("--auto-parameterize")
+
+
 def test_select_constants(cur):
     cur.execute("SELECT 1 AS a, 'hello' AS b, 3.14::double AS c")
     row = cur.fetchone()
@@ -82,3 +88,41 @@ def test_backend_pid_and_cancel(conn):
     """BackendKeyData is sent at startup; psycopg2 exposes it via get_backend_pid."""
     pid = conn.get_backend_pid()
     assert pid > 0
+
+
+def test_result_streams_past_output_buffer(cur):
+    """Results far larger than the output high-water mark are flushed to the
+    client incrementally; every row must still arrive, in order."""
+    cur.execute(
+        "SELECT i, repeat('x', 100) FROM generate_series(1, 200000) AS t(i)"
+    )
+    n = 0
+    for i, pad in cur:
+        n += 1
+        assert i == n
+        assert len(pad) == 100
+    assert n == 200000
+
+
+def test_literal_queries_share_a_plan(autoparam_server):
+    """With --auto-parameterize, simple queries that differ only in their
+    literals reuse one prepared plan."""
+    conn = autoparam_server.connect()
+    conn.autocommit = True
+    cur = conn.cursor()
+    try:
+        cur.execute("CREATE TABLE literal_plans (id INTEGER, name VARCHAR)")
+        cur.execute("INSERT INTO literal_plans VALUES (1, 'a'), (2, 'it''s')")
+        cur.execute("SHOW postduck_statement_cache")
+        hits_before = cur.fetchone()[0]
+        cur.execute("SELECT name FROM literal_plans WHERE id = 1")
+        assert cur.fetchall() == [("a",)]
+        cur.execute("SELECT name FROM literal_plans WHERE id = 2")
+        assert cur.fetchall() == [("it's",)]
+        cur.execute("SELECT id FROM literal_plans WHERE name = 'it''s'")
+        assert cur.fetchall() == [(2,)]
+        cur.execute("SHOW postduck_statement_cache")
+        assert cur.fetchone()[0] == hits_before + 1
+    finally:
+        cur.execute("DROP TABLE IF EXISTS literal_plans")
+        conn.close()
@@ -0,0 +1,82 @@
+"""COPY protocol: COPY ... FROM STDIN through psycopg2's copy helpers."""
+
+import io
+
+import psycopg2
+import pytest
+
+
+def test_copy_from_text(cur, fresh_table):
+    data = io.StringIO("1\talice\t1.5\n2\t\\N\t2.5\n3\ttab\\there\t\\N\n")
+    cur.copy_from(data, fresh_table)
+    cur.execute(f"SELECT id, name, v FROM {fresh_table} ORDER BY id")
+    assert cur.fetchall() == [(1, "alice", 1.5), (2, None, 2.5), (3, "tab\there", None)]
+
+
+def test_copy_from_csv_with_header(cur, fresh_table):
+    data = io.StringIO('id,name,v\n1,"a, ""quoted""\nname",0.5\n2,,\n')
+    cur.copy_expert(f"COPY {fresh_table} FROM STDIN WITH (FORMAT csv, HEADER true)", data)
+    assert cur.rowcount == 2
+    cur.execute(f"SELECT id, name, v FROM {fresh_table} ORDER BY id")
+    assert cur.fetchall() == [(1, 'a, "quoted"\nname', 0.5), (2, None, None)]
+
+
+def test_copy_from_column_subset(cur, fresh_table):
+    data = io.StringIO("x\t7\ny\t8\n")
+    cur.copy_from(data, fresh_table, columns=("name", "id"))
+    cur.execute(f"SELECT id, name, v FROM {fresh_table} ORDER BY id")
+    assert cur.fetchall() == [(7, "x", None), (8, "y", None)]
+
+
+def test_copy_from_many_rows(cur, fresh_table):
+    n = 50_000
+    data = io.StringIO("".join(f"{i}\tn{i}\t{i / 2}\n" for i in range(n)))
+    cur.copy_from(data, fresh_table, size=7919)  # frames split rows mid-line
+    cur.execute(f"SELECT count(*), sum(id), max(name) FROM {fresh_table}")
+    assert cur.fetchone() == (n, n * (n - 1) // 2, "n9999")
+
+
+def test_copy_from_bad_row_loads_nothing(conn, fresh_table):
+    cur = conn.cursor()
+    data = io.StringIO("1\ta\t1\nnot-a-number\tb\t2\n")
+    with pytest.raises(psycopg2.Error):
+        cur.copy_from(data, fresh_table)
+    cur.execute(f"SELECT count(*) FROM {fresh_table}")
+    assert cur.fetchone() == (0,)
+
+
+def test_copy_to_text(cur, fresh_table):
+    cur.execute(
+        f"INSERT INTO {fresh_table} VALUES (1, 'a\tb', 1.5), (2, NULL, NULL), (3, 'back\\slash', 0.25)"
+    )
+    out = io.StringIO()
+    cur.copy_expert(f"COPY (SELECT * FROM {fresh_table} ORDER BY id) TO STDOUT", out)
+    assert out.getvalue() == "1\ta\\tb\t1.5\n2\t\\N\t\\N\n3\tback\\\\slash\t0.25\n"
+
+
+def test_copy_to_csv_with_header(cur, fresh_table):
+    cur.execute(f"INSERT INTO {fresh_table} VALUES (1, 'x,\"y\"', 2), (2, '', NULL)")
+    out = io.StringIO()
+    cur.copy_expert(f"COPY {fresh_table} (id, name) TO STDOUT WITH (FORMAT csv, HEADER)", out)
+    lines = sorted(out.getvalue().splitlines()[1:])
+    assert out.getvalue().splitlines()[0] == "id,name"
+    assert lines == ['1,"x,""y"""', '2,""']
+
+
+def test_copy_to_binary_roundtrip_shape(cur):
+    out = io.BytesIO()
+    cur.copy_expert("COPY (SELECT 7::INTEGER AS a, NULL::BIGINT AS b) TO STDOUT (FORMAT binary)", out)
+    data = out.getvalue()
+    assert data[:11] == b"PGCOPY\n\xff\r\n\x00"
+    body = data[19:]
+    assert body == (b"\x00\x02" + b"\x00\x00\x00\x04\x00\x00\x00\x07" + b"\xff\xff\xff\xff"
+                    + b"\xff\xff")
+
+
+def test_copy_to_many_rows(cur):
+    out = io.StringIO()
+    cur.copy_expert("COPY (SELECT i FROM range(100000) t(i)) TO STDOUT", out)
+    lines = out.getvalue().splitlines()
+    assert len(lines) == 100000
+    assert lines[-1] == "99999"
+    assert cur.rowcount == 100000
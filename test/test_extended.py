@@ -5,10 +5,20 @@ psycopg2 uses the extended protocol whenever the query has Python parameters
 ``executemany``, and server-side cursors-like workflows.
 """
 
+import datetime
+import struct
+import uuid
+
 import psycopg2
 import pytest
 
 
+@pytest.fixture(scope="module")
+def appender_server(spawn_server):
+    """A server appending the rows of prepared single-row INSERTs."""
+    return spawn_server("--insert-appender")
+
+
 def test_parameterized_scalar(cur):
     cur.execute("SELECT %s::int + %s::int", (10, 20))
     assert cur.fetchone() == (30,)
@@ -83,3 +93,332 @@ def test_mixed_null_and_value_parameters(cur, fresh_table):
     )
     cur.execute(f"SELECT id, name, v FROM {fresh_table}")
     assert cur.fetchone() == (1, None, 1.5)
+
+
+def test_execute_max_rows_suspends_portal(postduck_server):
+    query = b"SELECT i FROM generate_series(1, 5000) AS t(i)\0"
+    execute = (b"E", b"\0" + struct.pack("!i", 2048))
+    replies = postduck_server.roundtrip([
+        (b"P", b"\0" + query + struct.pack("!h", 0)),
+        (b"B", b"\0\0" + struct.pack("!hhh", 0, 0, 0)),
+        execute, execute, execute,
+    ])
+    kinds = b"".join(k for k, _ in replies)
+    assert kinds == (b"12" + b"D" * 2048 + b"s" + b"D" * 2048 + b"s"
+                     + b"D" * 904 + b"C")
+    rows = [int(body[6:]) for k, body in replies if k == b"D"]
+    assert rows == list(range(1, 5001))
+    assert replies[-1][1] == b"SELECT 904\0"
+
+
+def _bind_text(*params):
+    body = b"\0\0" + struct.pack("!hh", 0, len(params))
+    for p in params:
+        data = str(p).encode()
+        body += struct.pack("!i", len(data)) + data
+    return (b"B", body + struct.pack("!h", 0))
+
+
+def _bind_binary(*params):
+    body = b"\0\0" + struct.pack("!hh", 1, 1) + struct.pack("!h", len(params))
+    for p in params:
+        body += struct.pack("!i", len(p)) + p
+    return (b"B", body + struct.pack("!h", 0))
+
+
+def _error_fields(body):
+    return {f[:1]: f[1:].decode() for f in body.split(b"\0") if f}
+
+
+def _binary_int4_array(*items):
+    body = struct.pack("!iiIii", 1, None in items, 23, len(items), 1)
+    for i in items:
+        body += struct.pack("!i", -1) if i is None else struct.pack("!ii", 4, i)
+    return body
+
+
+def test_pipelined_inserts_batched(postduck_server, cur):
+    cur.execute("CREATE TABLE pipe_batch (id INTEGER PRIMARY KEY, name VARCHAR)")
+    try:
+        insert = b"INSERT INTO pipe_batch (id, name) VALUES ($1, $2)\0"
+        messages = [(b"P", b"\0" + insert + struct.pack("!h", 0))]
+        for i in range(300):
+            messages += [_bind_text(i, f"n{i}"), (b"E", b"\0" + struct.pack("!i", 0))]
+        replies = postduck_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"1" + b"2C" * 300
+        assert all(body == b"INSERT 0 1\0" for k, body in replies if k == b"C")
+        cur.execute("SELECT count(*), max(name) FROM pipe_batch")
+        assert cur.fetchone() == (300, "n99")
+
+        # A failing Execute reports after the earlier tags and undoes the window
+        messages = [(b"P", b"\0" + insert + struct.pack("!h", 0))]
+        for i in (1000, 1001, 5, 1002):
+            messages += [_bind_text(i, "x"), (b"E", b"\0" + struct.pack("!i", 0))]
+        replies = postduck_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"1" + b"2C2C2E"
+        cur.execute("SELECT count(*) FROM pipe_batch")
+        assert cur.fetchone() == (300,)
+    finally:
+        cur.execute("DROP TABLE pipe_batch")
+
+
+def test_reparsed_statement_reuses_plan(postduck_server):
+    query = b"SELECT $1::INTEGER + 1\0"
+    parse = (b"P", b"\0" + query + struct.pack("!hI", 1, 23))
+    execute = (b"E", b"\0" + struct.pack("!i", 0))
+    messages = []
+    for i in range(3):
+        messages += [parse, _bind_text(i), execute]
+    messages.append((b"Q", b"SHOW postduck_statement_cache\0"))
+    replies = postduck_server.roundtrip(messages)
+    rows = [body for k, body in replies if k == b"D"]
+    assert [int(r[6:]) for r in rows[:3]] == [1, 2, 3]
+    # hits, misses, evictions, entries as text columns
+    fields, pos = [], 2
+    for _ in range(4):
+        n = struct.unpack("!i", rows[3][pos:pos + 4])[0]
+        fields.append(int(rows[3][pos + 4:pos + 4 + n]))
+        pos += 4 + n
+    assert fields == [2, 1, 0, 1]
+
+
+def test_untyped_parameters_describe_and_execute(postduck_server):
+    query = b"SELECT $1 * 2 AS doubled, upper($2) AS name\0"
+    describe = (b"D", b"P\0")
+    execute = (b"E", b"\0" + struct.pack("!i", 0))
+    replies = postduck_server.roundtrip([
+        (b"P", b"\0" + query + struct.pack("!h", 0)),
+        _bind_text(21, "a"), describe, execute,
+        _bind_text(4, "b"), describe, execute,
+    ])
+    assert b"".join(k for k, _ in replies) == b"12TDC2TDC"
+    cells = []
+    for k, body in replies:
+        if k == b"D":
+            pos, row = 2, []
+            for _ in range(2):
+                n = struct.unpack("!i", body[pos:pos + 4])[0]
+                row.append(body[pos + 4:pos + 4 + n])
+                pos += 4 + n
+            cells.append(row)
+    assert cells == [[b"42", b"A"], [b"8", b"B"]]
+
+
+def test_result_formats_per_bind(postduck_server):
+    """Binds asking for text and binary results alternate on one statement;
+    each gets its own RowDescription and encoding."""
+    query = b"SELECT $1::INTEGER * 2 AS n, 'x' AS s\0"
+    describe = (b"D", b"P\0")
+    execute = (b"E", b"\0" + struct.pack("!i", 0))
+
+    def bind(value, *formats):
+        data = str(value).encode()
+        body = b"\0\0" + struct.pack("!hhi", 0, 1, len(data)) + data
+        return (b"B", body + struct.pack("!h", len(formats))
+                + b"".join(struct.pack("!h", f) for f in formats))
+
+    messages = [(b"P", b"\0" + query + struct.pack("!hI", 1, 23)), (b"D", b"S\0")]
+    for i in range(3):
+        messages += [bind(i, 0), describe, execute, bind(i, 1), describe, execute,
+                     bind(i, 1, 0), describe, execute]
+    replies = postduck_server.roundtrip(messages)
+    assert b"".join(k for k, _ in replies) == b"1tT" + b"2TDC" * 9
+
+    def formats(body):
+        ncols, pos, out = struct.unpack("!h", body[:2])[0], 2, []
+        for _ in range(ncols):
+            pos = body.index(b"\0", pos) + 1 + 16
+            out.append(struct.unpack("!h", body[pos:pos + 2])[0])
+            pos += 2
+        return out
+
+    descriptions = [formats(body) for k, body in replies if k == b"T"]
+    assert descriptions == [[0, 0]] + [[0, 0], [1, 1], [1, 0]] * 3
+    rows = [body for k, body in replies if k == b"D"]
+    for i in range(3):
+        text, binary, mixed = rows[3 * i:3 * i + 3]
+        assert text == struct.pack("!hi", 2, len(str(2 * i))) + str(2 * i).encode() + struct.pack("!i", 1) + b"x"
+        assert binary == struct.pack("!hii", 2, 4, 2 * i) + struct.pack("!i", 1) + b"x"
+        assert mixed == binary
+
+
+def test_pipelined_inserts_appended(appender_server):
+    conn = appender_server.connect()
+    conn.autocommit = True
+    cur = conn.cursor()
+    cur.execute("CREATE TABLE pipe_append (id INTEGER PRIMARY KEY, name VARCHAR, v DOUBLE)")
+    try:
+        execute = (b"E", b"\0" + struct.pack("!i", 0))
+        insert = b"INSERT INTO pipe_append VALUES ($1, $2, $3)\0"
+        messages = [(b"P", b"\0" + insert + struct.pack("!h", 0))]
+        for i in range(300):
+            messages += [_bind_text(i, f"n{i}", i / 2), execute]
+        replies = appender_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"1" + b"2C" * 300
+        assert all(body == b"INSERT 0 1\0" for k, body in replies if k == b"C")
+        cur.execute("SELECT count(*), max(name), sum(v) FROM pipe_append")
+        assert cur.fetchone() == (300, "n99", sum(i / 2 for i in range(300)))
+
+        # A duplicate key reports after the earlier tags and undoes the window
+        messages = [(b"P", b"\0" + insert + struct.pack("!h", 0))]
+        for i in (1000, 1001, 5, 1002):
+            messages += [_bind_text(i, "x", 0), execute]
+        replies = appender_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"1" + b"2C2C2E"
+        cur.execute("SELECT count(*) FROM pipe_append")
+        assert cur.fetchone() == (300,)
+
+        # Columns in another order than the table's are inserted, not appended
+        reordered = b"INSERT INTO pipe_append (name, id, v) VALUES ($1, $2, $3)\0"
+        replies = appender_server.roundtrip([
+            (b"P", b"\0" + reordered + struct.pack("!h", 0)),
+            _bind_text("r", 2000, 1.5), execute,
+        ])
+        assert b"".join(k for k, _ in replies) == b"12C"
+        cur.execute("SELECT name, v FROM pipe_append WHERE id = 2000")
+        assert cur.fetchone() == ("r", 1.5)
+
+        # Inside a transaction the rows follow its ROLLBACK
+        conn.autocommit = False
+        cur.executemany("INSERT INTO pipe_append VALUES (%s, %s, %s)",
+                        [(3000 + i, "t", 0.0) for i in range(10)])
+        conn.rollback()
+        conn.autocommit = True
+        cur.execute("SELECT count(*) FROM pipe_append WHERE id >= 3000")
+        assert cur.fetchone() == (0,)
+    finally:
+        cur.execute("DROP TABLE pipe_append")
+        conn.close()
+
+
+def test_pipelined_insert_failure_in_transaction(postduck_server, cur):
+    """Inside the client's transaction the Executes before a failing one
+    still get their tags, ahead of the error."""
+    cur.execute("CREATE TABLE pipe_txn (id INTEGER PRIMARY KEY, name VARCHAR)")
+    try:
+        execute = (b"E", b"\0" + struct.pack("!i", 0))
+        insert = b"INSERT INTO pipe_txn (id, name) VALUES ($1, $2)\0"
+        messages = [(b"P", b"\0BEGIN\0" + struct.pack("!h", 0)), _bind_text(), execute,
+                    (b"P", b"\0" + insert + struct.pack("!h", 0))]
+        for i in (1, 2, 1, 3):
+            messages += [_bind_text(i, "x"), execute]
+        replies = postduck_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"12C" + b"1" + b"2C2C2E"
+        assert [body for k, body in replies if k == b"C"][1:] == [b"INSERT 0 1\0"] * 2
+        cur.execute("SELECT count(*) FROM pipe_txn")
+        assert cur.fetchone() == (0,)
+    finally:
+        cur.execute("DROP TABLE pipe_txn")
+
+
+def test_pipelined_upsert_conflicting_within_batch(postduck_server, cur):
+    """Rows of one window that conflict with each other fail as a multi-row
+    INSERT; the row-by-row replay that follows is kept."""
+    cur.execute("CREATE TABLE pipe_upsert (id INTEGER PRIMARY KEY, name VARCHAR)")
+    try:
+        execute = (b"E", b"\0" + struct.pack("!i", 0))
+        upsert = (b"INSERT INTO pipe_upsert VALUES ($1, $2) "
+                  b"ON CONFLICT (id) DO UPDATE SET name = excluded.name\0")
+        messages = [(b"P", b"\0" + upsert + struct.pack("!h", 0))]
+        for i, name in ((1, "a"), (2, "b"), (1, "c"), (3, "d")):
+            messages += [_bind_text(i, name), execute]
+        replies = postduck_server.roundtrip(messages)
+        assert b"".join(k for k, _ in replies) == b"1" + b"2C" * 4
+        assert all(body == b"INSERT 0 1\0" for k, body in replies if k == b"C")
+        cur.execute("SELECT id, name FROM pipe_upsert ORDER BY id")
+        assert cur.fetchall() == [(1, "c"), (2, "b"), (3, "d")]
+    finally:
+        cur.execute("DROP TABLE pipe_upsert")
+
+
+def test_binary_numeric_special_values(postduck_server):
+    def numeric(ndigits, sign, digits=b""):
+        return struct.pack("!hhHh", ndigits, 0, sign, 0) + digits
+
+    query = b"SELECT $1::DOUBLE > 1e308, $2::DOUBLE < -1e308\0"
+    parse = (b"P", b"\0" + query + struct.pack("!hII", 2, 1700, 1700))
+    execute = (b"E", b"\0" + struct.pack("!i", 0))
+    replies = postduck_server.roundtrip([
+        parse, _bind_binary(numeric(0, 0xD000), numeric(0, 0xF000)), execute])
+    assert b"".join(k for k, _ in replies) == b"12DC"
+    assert replies[2][1] == struct.pack("!hi", 2, 1) + b"t" + struct.pack("!i", 1) + b"t"
+
+    # Digits missing from the payload are an error, not NaN
+    replies = postduck_server.roundtrip([
+        parse, _bind_binary(numeric(2, 0), numeric(0, 0)), execute])
+    assert b"".join(k for k, _ in replies) == b"1E"
+    assert _error_fields(replies[1][1])[b"C"] == "22P02"
+
+
+def test_untyped_binary_parameters_take_the_expected_type(postduck_server, cur):
+    """Binary parameters sent with type OID 0 are read in the wire format of
+    the type the statement expects."""
+    cur.execute("CREATE TABLE bin_untyped (d DATE, n INTEGER[])")
+    try:
+        insert = b"INSERT INTO bin_untyped VALUES ($1, $2)\0"
+        replies = postduck_server.roundtrip([
+            (b"P", b"\0" + insert + struct.pack("!h", 0)),
+            _bind_binary(struct.pack("!i", 8825), _binary_int4_array(1, None, 3)),
+            (b"E", b"\0" + struct.pack("!i", 0)),
+        ])
+        assert b"".join(k for k, _ in replies) == b"12C"
+        cur.execute("SELECT d, n FROM bin_untyped")
+        assert cur.fetchall() == [(datetime.date(2024, 2, 29), [1, None, 3])]
+    finally:
+        cur.execute("DROP TABLE bin_untyped")
+
+
+def test_binary_parameters(postduck_server):
+    ts = datetime.datetime(2024, 2, 29, 12, 34, 56, 789000) - datetime.datetime(2000, 1, 1)
+    value = uuid.UUID("a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11")
+    query = (b"SELECT $1 IS NOT DISTINCT FROM DATE '2024-02-29',"
+             b" $2 IS NOT DISTINCT FROM TIMESTAMP '2024-02-29 12:34:56.789',"
+             b" $3 IS NOT DISTINCT FROM '" + str(value).encode() + b"'::UUID,"
+             b" $4 IS NOT DISTINCT FROM [1, NULL, 3]\0")
+    replies = postduck_server.roundtrip([
+        (b"P", b"\0" + query + struct.pack("!hIIII", 4, 1082, 1114, 2950, 1007)),
+        _bind_binary(struct.pack("!i", 8825), struct.pack("!q", ts // datetime.timedelta(microseconds=1)),
+                     value.bytes, _binary_int4_array(1, None, 3)),
+        (b"E", b"\0" + struct.pack("!i", 0)),
+    ])
+    assert b"".join(k for k, _ in replies) == b"12DC"
+    assert replies[2][1] == struct.pack("!h", 4) + (struct.pack("!i", 1) + b"t") * 4
+
+
+def test_unconvertible_parameter_is_22P02(postduck_server):
+    parse = (b"P", b"\0SELECT $1::DATE\0" + struct.pack("!hI", 1, 1082))
+    execute = (b"E", b"\0" + struct.pack("!i", 0))
+    for bind in (_bind_text("not a date"), _bind_binary(b"\0\0\1")):
+        replies = postduck_server.roundtrip([parse, bind, execute])
+        assert b"".join(k for k, _ in replies) == b"1E"
+        assert _error_fields(replies[1][1])[b"C"] == "22P02"
+
+
+def test_binary_result_encodings(postduck_server):
+    """Result format 1 sends each type in PostgreSQL's binary layout."""
+    value = uuid.UUID("a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11")
+    query = (b"SELECT DATE '2024-02-29', TIMESTAMP '2024-02-29 12:34:56.789',"
+             b" 12345.678::DECIMAL(10,3), -0.05::DECIMAL(4,2),"
+             b" '" + str(value).encode() + b"'::UUID,"
+             b" INTERVAL '1 year 2 months 3 days 04:05:06.5',"
+             b" [1, NULL, 3]::INTEGER[]\0")
+    replies = postduck_server.roundtrip([
+        (b"P", b"\0" + query + struct.pack("!h", 0)),
+        (b"B", b"\0\0" + struct.pack("!hhhh", 0, 0, 1, 1)),
+        (b"E", b"\0" + struct.pack("!i", 0)),
+    ])
+    assert b"".join(k for k, _ in replies) == b"12DC"
+    ts = datetime.datetime(2024, 2, 29, 12, 34, 56, 789000) - datetime.datetime(2000, 1, 1)
+    cells = [
+        struct.pack("!i", 8825),
+        struct.pack("!q", ts // datetime.timedelta(microseconds=1)),
+        # ndigits, weight, sign, dscale, then base-10000 digits
+        struct.pack("!hhHh", 3, 1, 0, 3) + struct.pack("!hhh", 1, 2345, 6780),
+        struct.pack("!hhHh", 1, -1, 0x4000, 2) + struct.pack("!h", 500),
+        value.bytes,
+        # microseconds, days, months
+        struct.pack("!qii", 14706500000, 3, 14),
+        _binary_int4_array(1, None, 3),
+    ]
+    assert replies[2][1] == struct.pack("!h", len(cells)) + b"".join(
+        struct.pack("!i", len(c)) + c for c in cells)
@@ -0,0 +1,106 @@
+"""pg_catalog queries, answered from the mirror refreshed after DDL."""
+
+import pytest
+
+
+@pytest.fixture(scope="module")
+def catalog_server(spawn_server):
+    """A server answering pg_catalog queries from its mirror."""
+    return spawn_server("--catalog-mirror")
+
+
+@pytest.fixture
+def cur(catalog_server):
+    conn = catalog_server.connect()
+    conn.autocommit = True
+    try:
+        yield conn.cursor()
+    finally:
+        conn.close()
+
+
+def _relnames(cur, prefix):
+    cur.execute("SELECT relname FROM pg_catalog.pg_class WHERE relname LIKE %s ORDER BY relname",
+                (prefix + "%",))
+    return [r[0] for r in cur.fetchall()]
+
+
+def test_mirror_is_attached(cur):
+    cur.execute("SELECT table_name FROM duckdb_tables() WHERE database_name = 'postduck_catalog' "
+                "ORDER BY table_name")
+    assert [r[0] for r in cur.fetchall()] == [
+        "pg_attribute", "pg_class", "pg_index", "pg_namespace", "pg_proc", "pg_type"]
+
+
+def test_catalog_follows_ddl(cur):
+    cur.execute("CREATE TABLE pgc_orders (id INTEGER, total DOUBLE)")
+    try:
+        assert _relnames(cur, "pgc_") == ["pgc_orders"]
+        cur.execute("SELECT a.attname FROM pg_attribute a JOIN pg_class c ON a.attrelid = c.oid "
+                    "WHERE c.relname = 'pgc_orders' AND a.attnum > 0 ORDER BY a.attnum")
+        assert [r[0] for r in cur.fetchall()] == ["id", "total"]
+        cur.execute("ALTER TABLE pgc_orders ADD COLUMN note VARCHAR")
+        cur.execute("SELECT count(*) FROM pg_attribute a JOIN pg_class c ON a.attrelid = c.oid "
+                    "WHERE c.relname = 'pgc_orders' AND a.attnum > 0")
+        assert cur.fetchone() == (3,)
+    finally:
+        cur.execute("DROP TABLE pgc_orders")
+    assert _relnames(cur, "pgc_") == []
+
+
+def test_ddl_in_transaction_shows_after_commit(catalog_server):
+    writer = catalog_server.connect()
+    reader = catalog_server.connect()
+    reader.autocommit = True
+    try:
+        writer.cursor().execute("CREATE TABLE pgc_pending (id INTEGER)")
+        assert _relnames(reader.cursor(), "pgc_pending") == []
+        writer.commit()
+        assert _relnames(reader.cursor(), "pgc_pending") == ["pgc_pending"]
+        reader.cursor().execute("DROP TABLE pgc_pending")
+    finally:
+        writer.close()
+        reader.close()
+
+
+def test_own_uncommitted_ddl_is_visible(catalog_server):
+    """A migration checks the catalog between its own statements."""
+    conn = catalog_server.connect()
+    try:
+        cur = conn.cursor()
+        cur.execute("CREATE TABLE pgc_migrating (id INTEGER)")
+        assert _relnames(cur, "pgc_migrating") == ["pgc_migrating"]
+        cur.execute("ALTER TABLE pgc_migrating ADD COLUMN added VARCHAR")
+        cur.execute("SELECT count(*) FROM pg_attribute a JOIN pg_class c ON a.attrelid = c.oid "
+                    "WHERE c.relname = 'pgc_migrating' AND a.attnum > 0")
+        assert cur.fetchone() == (2,)
+        conn.rollback()
+        assert _relnames(cur, "pgc_migrating") == []
+        # Back on the mirror once the transaction is over
+        conn.autocommit = True
+        cur.execute("SELECT current_setting('search_path')")
+        assert "postduck_catalog" in cur.fetchone()[0]
+    finally:
+        conn.close()
+
+
+def test_own_temp_table_is_visible(catalog_server):
+    """Temporary tables are not mirrored; their session reads the views."""
+    conn = catalog_server.connect()
+    conn.autocommit = True
+    other = catalog_server.connect()
+    other.autocommit = True
+    try:
+        cur = conn.cursor()
+        cur.execute("CREATE TEMP TABLE pgc_scratch (id INTEGER, note VARCHAR)")
+        assert _relnames(cur, "pgc_scratch") == ["pgc_scratch"]
+        cur.execute("SELECT a.attname FROM pg_attribute a JOIN pg_class c ON a.attrelid = c.oid "
+                    "WHERE c.relname = 'pgc_scratch' AND a.attnum > 0 ORDER BY a.attnum")
+        assert [r[0] for r in cur.fetchall()] == ["id", "note"]
+        # Still there after later statements, and only for this session
+        cur.execute("SELECT 1")
+        assert _relnames(cur, "pgc_scratch") == ["pgc_scratch"]
+        assert _relnames(other.cursor(), "pgc_scratch") == []
+    finally:
+        conn.close()
+        other.close()
@@ -0,0 +1,117 @@
+"""Transaction pooling (the ``pooled_server`` runs with --pool-size 2)."""
+
+import struct
+
+import pytest
+
+
+@pytest.fixture(scope="module")
+def pooled_server(spawn_server):
+    """A second server sharing two DuckDB connections among its clients."""
+    return spawn_server("--pool-size", "2")
+
+
+def _pool_stats(cur):
+    cur.execute("SHOW postduck_connection_pool")
+    names = [d[0] for d in cur.description]
+    return dict(zip(names, cur.fetchone()))
+
+
+def test_more_clients_than_connections(pooled_server):
+    conns = [pooled_server.connect() for _ in range(5)]
+    try:
+        for c in conns:
+            c.autocommit = True
+        conns[0].cursor().execute("CREATE TABLE pool_many (id INTEGER)")
+        for round_ in range(3):
+            for i, c in enumerate(conns):
+                c.cursor().execute("INSERT INTO pool_many VALUES (%s)", (round_ * 10 + i,))
+        cur = conns[-1].cursor()
+        cur.execute("SELECT count(*) FROM pool_many")
+        assert cur.fetchone() == (15,)
+        assert _pool_stats(cur)["open"] <= 2
+        cur.execute("DROP TABLE pool_many")
+    finally:
+        for c in conns:
+            c.close()
+
+
+def test_transaction_keeps_its_connection(pooled_server):
+    writer = pooled_server.connect()
+    reader = pooled_server.connect()
+    reader.autocommit = True
+    try:
+        rcur = reader.cursor()
+        rcur.execute("CREATE TABLE pool_txn (id INTEGER)")
+        wcur = writer.cursor()
+        wcur.execute("INSERT INTO pool_txn VALUES (1)")
+        rcur.execute("SELECT count(*) FROM pool_txn")
+        assert rcur.fetchone() == (0,)
+        wcur.execute("SELECT count(*) FROM pool_txn")
+        assert wcur.fetchone() == (1,)
+        writer.commit()
+        rcur.execute("SELECT count(*) FROM pool_txn")
+        assert rcur.fetchone() == (1,)
+        rcur.execute("DROP TABLE pool_txn")
+    finally:
+        writer.close()
+        reader.close()
+
+
+def test_prepared_statement_follows_the_session(pooled_server):
+    sock = pooled_server.wire()
+    other = pooled_server.connect()
+    try:
+        query = b"SELECT $1::INTEGER * 3\0"
+        replies = sock.roundtrip([(b"P", b"s\0" + query + struct.pack("!hI", 1, 23))])
+        assert [k for k, _ in replies] == [b"1"]
+
+        # Hold the connection the statement was prepared on in another transaction
+        other.cursor().execute("SELECT 1")
+        bind = b"\0s\0" + struct.pack("!hhi", 0, 1, 2) + b"14" + struct.pack("!h", 0)
+        replies = sock.roundtrip([(b"B", bind), (b"E", b"\0" + struct.pack("!i", 0))])
+        assert [k for k, _ in replies] == [b"2", b"D", b"C"]
+        assert replies[1][1][6:] == b"42"
+    finally:
+        other.close()
+        sock.close()
+
+
+def test_validation_query_borrows_no_connection(pooled_server):
+    c = pooled_server.connect()
+    c.autocommit = True
+    try:
+        cur = c.cursor()
+        before = _pool_stats(cur)["acquires"]
+        for _ in range(5):
+            cur.execute("SELECT 1")
+            assert cur.fetchone() == (1,)
+        # Only the SHOW reading the stats borrowed one
+        assert _pool_stats(cur)["acquires"] == before + 1
+    finally:
+        c.close()
+
+
+def test_set_stays_with_its_session(pooled_server):
+    conns = [pooled_server.connect() for _ in range(3)]
+    try:
+        for c in conns:
+            c.autocommit = True
+        setter, others = conns[0].cursor(), [c.cursor() for c in conns[1:]]
+        others[0].execute("SELECT current_setting('search_path')")
+        default = others[0].fetchone()
+        setter.execute("CREATE SCHEMA IF NOT EXISTS pool_set")
+        setter.execute("SET search_path = 'pool_set'")
+        # With two connections for three clients every one of them gets to
+        # borrow the connection the SET ran on
+        for _ in range(3):
+            for cur in others:
+                cur.execute("SELECT current_setting('search_path')")
+                assert cur.fetchone() == default
+            setter.execute("SELECT current_setting('search_path')")
+            assert setter.fetchone() == ("pool_set",)
+        setter.execute("RESET search_path")
+        setter.execute("DROP SCHEMA pool_set")
+    finally:
+        for c in conns:
+            c.close()
@@ -0,0 +1,48 @@
+"""Socket I/O spread over several reactors (``reactor_server``)."""
+
+import threading
+
+import pytest
+
+
+@pytest.fixture(scope="module")
+def reactor_server(spawn_server):
+    """A server doing socket I/O on three SO_REUSEPORT reactors."""
+    return spawn_server("--reactors", "3", "--reuse-port")
+
+
+def test_concurrent_clients_across_reactors(reactor_server):
+    errors = []
+
+    def client(n):
+        try:
+            c = reactor_server.connect()
+            c.autocommit = True
+            try:
+                cur = c.cursor()
+                for i in range(20):
+                    cur.execute("SELECT %s::int * 2", (n * 100 + i,))
+                    assert cur.fetchone() == ((n * 100 + i) * 2,)
+                cur.execute("SELECT i FROM generate_series(1, 50000) AS t(i)")
+                assert len(cur.fetchall()) == 50000
+            finally:
+                c.close()
+        except Exception as exc:  # surfaced in the main thread
+            errors.append(exc)
+
+    threads = [threading.Thread(target=client, args=(n,)) for n in range(12)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert errors == []
+
+
+def test_backend_pids_unique_across_reactors(reactor_server):
+    conns = [reactor_server.connect() for _ in range(6)]
+    try:
+        pids = {c.get_backend_pid() for c in conns}
+        assert len(pids) == 6
+    finally:
+        for c in conns:
+            c.close()
@@ -0,0 +1,86 @@
+"""Server-wide result cache, on a server started with --result-cache."""
+
+import pytest
+
+
+@pytest.fixture(scope="module")
+def cache_server(spawn_server):
+    """A server keeping a 16 MB shared result cache."""
+    return spawn_server("--result-cache", "16")
+
+
+@pytest.fixture()
+def conn(cache_server):
+    c = cache_server.connect()
+    c.autocommit = True
+    try:
+        yield c
+    finally:
+        c.close()
+
+
+def _cache_stats(cur):
+    cur.execute("SHOW postduck_result_cache")
+    names = [d[0] for d in cur.description]
+    return dict(zip(names, cur.fetchone()))
+
+
+def test_repeated_select_is_served_from_cache(cache_server, cur, fresh_table):
+    cur.execute(f"INSERT INTO {fresh_table} VALUES (1, 'a', 1.5), (2, 'b', 2.5)")
+    query = f"SELECT id, name FROM {fresh_table} ORDER BY id"
+    cur.execute(query)
+    first = cur.fetchall()
+    before = _cache_stats(cur)
+
+    other = cache_server.connect()
+    other.autocommit = True
+    try:
+        ocur = other.cursor()
+        ocur.execute(query)
+        assert ocur.fetchall() == first
+    finally:
+        other.close()
+    assert _cache_stats(cur)["hits"] == before["hits"] + 1
+
+
+def test_write_from_other_session_invalidates(cache_server, cur, fresh_table):
+    cur.execute(f"INSERT INTO {fresh_table} VALUES (1, 'a', 1.5)")
+    query = f"SELECT count(*) FROM {fresh_table}"
+    cur.execute(query)
+    assert cur.fetchone() == (1,)
+
+    other = cache_server.connect()
+    other.autocommit = True
+    try:
+        other.cursor().execute(f"INSERT INTO {fresh_table} VALUES (2, 'b', 2.5)")
+    finally:
+        other.close()
+    cur.execute(query)
+    assert cur.fetchone() == (2,)
+
+
+def test_parameters_are_part_of_the_key(cur, fresh_table):
+    cur.execute(f"INSERT INTO {fresh_table} VALUES (1, 'a', 1.5), (2, 'b', 2.5)")
+    query = f"SELECT name FROM {fresh_table} WHERE id = %s"
+    for _ in range(2):
+        cur.execute(query, (1,))
+        assert cur.fetchall() == [("a",)]
+        cur.execute(query, (2,))
+        assert cur.fetchall() == [("b",)]
+
+
+def test_transaction_sees_its_own_writes(cache_server, fresh_table):
+    c = cache_server.connect()
+    try:
+        cur = c.cursor()
+        query = f"SELECT count(*) FROM {fresh_table}"
+        cur.execute(query)
+        assert cur.fetchone() == (0,)
+        cur.execute(f"INSERT INTO {fresh_table} VALUES (1, 'a', 1.5)")
+        cur.execute(query)
+        assert cur.fetchone() == (1,)
+        c.rollback()
+        cur.execute(query)
+        assert cur.fetchone() == (0,)
+    finally:
+        c.close()
@@ -0,0 +1,63 @@
+"""Query rewriting: bootstrap queries, PostgreSQL-only commands and
+statement forms DuckDB lacks."""
+
+import psycopg2
+import pytest
+
+
+def test_bootstrap_queries_ignore_case_and_semicolons(cur):
+    cur.execute("select VERSION() ;")
+    assert "PostDuck" in cur.fetchone()[0]
+    cur.execute("SHOW TRANSACTION ISOLATION LEVEL")
+    assert cur.fetchone() == ("read committed",)
+
+
+def test_set_after_comment_is_noop(cur):
+    cur.execute("/* driver */ SET SESSION extra_float_digits = 3")
+    cur.execute("-- reset\nRESET extra_float_digits")
+    cur.execute("SELECT 1")
+    assert cur.fetchone() == (1,)
+
+
+def test_multi_table_drop_and_truncate(conn):
+    conn.autocommit = True
+    cur = conn.cursor()
+    cur.execute("CREATE TABLE rw_a (id INTEGER)")
+    cur.execute("CREATE TABLE rw_b (id INTEGER)")
+    cur.execute("INSERT INTO rw_a VALUES (1)")
+    cur.execute("INSERT INTO rw_b VALUES (2)")
+    cur.execute("TRUNCATE TABLE rw_a, rw_b")
+    cur.execute("SELECT (SELECT count(*) FROM rw_a) + (SELECT count(*) FROM rw_b)")
+    assert cur.fetchone() == (0,)
+    cur.execute("DROP TABLE IF EXISTS rw_a, rw_b")
+    cur.execute("SELECT count(*) FROM duckdb_tables() WHERE table_name IN ('rw_a', 'rw_b')")
+    assert cur.fetchone() == (0,)
+
+
+def test_large_insert_passes_through(cur, fresh_table):
+    values = ", ".join(f"({i}, 'row {i}')" for i in range(3000))
+    cur.execute(f"  INSERT INTO {fresh_table} (id, name) VALUES {values};  ")
+    cur.execute(f"SELECT count(*) FROM {fresh_table}")
+    assert cur.fetchone() == (3000,)
+
+
+def test_constant_answers(cur):
+    cur.execute("SELECT 1")
+    assert cur.fetchone() == (1,)
+    assert cur.description[0].type_code == 23
+    cur.execute("select current_schema();")
+    assert [d[0] for d in cur.description] == ["current_schema"]
+    assert cur.fetchone() == ("main",)
+    cur.execute("SHOW server_version")
+    assert cur.fetchone() == ("14.0 (PostDuck)",)
+
+
+def test_constant_answer_in_failed_transaction(conn):
+    conn.autocommit = False
+    cur = conn.cursor()
+    with pytest.raises(psycopg2.Error):
+        cur.execute("SELECT * FROM no_such_table_rw")
+    with pytest.raises(psycopg2.Error) as excinfo:
+        cur.execute("SELECT 1")
+    assert excinfo.value.pgcode == "25P02"
+    conn.rollback()
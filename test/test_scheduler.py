@@ -0,0 +1,97 @@
+"""Workload classes (``workload_server`` defines class "tiny")."""
+
+import threading
+import time
+
+import psycopg2
+import pytest
+
+
+@pytest.fixture(scope="module")
+def workload_server(spawn_server):
+    """A server with a one-worker, one-slot workload class for application_name=tiny."""
+    return spawn_server("--workload-class", "tiny:threads=1,queue=1,application_name=tiny")
+
+
+def _class_stats(server):
+    c = server.connect()
+    try:
+        cur = c.cursor()
+        cur.execute("SHOW postduck_workload_classes")
+        names = [d[0] for d in cur.description]
+        return {row[0]: dict(zip(names, row)) for row in cur.fetchall()}
+    finally:
+        c.close()
+
+
+def test_class_selected_by_application_name(workload_server):
+    before = _class_stats(workload_server)
+    c = workload_server.connect(application_name="tiny")
+    try:
+        cur = c.cursor()
+        cur.execute("SELECT 1")
+        assert cur.fetchone() == (1,)
+    finally:
+        c.close()
+    after = _class_stats(workload_server)
+    assert after["tiny"]["admitted"] > before["tiny"]["admitted"]
+    assert after["tiny"]["threads"] == 1
+
+
+def test_full_queue_rejects_with_53000(workload_server):
+    busy = workload_server.connect(application_name="tiny")
+    waiting = workload_server.connect(application_name="tiny")
+    extra = workload_server.connect(application_name="tiny")
+    busy.autocommit = waiting.autocommit = extra.autocommit = True
+    results = {}
+
+    def run(name, conn, sql):
+        try:
+            cur = conn.cursor()
+            cur.execute(sql)
+            results[name] = cur.fetchall()
+        except psycopg2.Error as exc:
+            results[name] = exc
+
+    # Occupy the only worker, then fill the one queue slot
+    t1 = threading.Thread(target=run, args=("busy", busy, "SELECT count(*) FROM range(100000000000)"))
+    t1.start()
+    time.sleep(0.5)
+    t2 = threading.Thread(target=run, args=("waiting", waiting, "SELECT 2"))
+    t2.start()
+    time.sleep(0.5)
+    try:
+        with pytest.raises(psycopg2.OperationalError) as info:
+            extra.cursor().execute("SELECT 3")
+        assert info.value.pgcode == "53000"
+    finally:
+        busy.cancel()
+        t1.join()
+        t2.join()
+    assert results["waiting"] == [(2,)]
+    assert isinstance(results["busy"], psycopg2.Error)
+    # The rejected session stays usable
+    cur = extra.cursor()
+    cur.execute("SELECT 3")
+    assert cur.fetchone() == (3,)
+    for c in (busy, waiting, extra):
+        c.close()
+
+
+def test_stalled_stream_does_not_hold_the_worker(workload_server):
+    """A client that stops reading a large result parks its stream instead
+    of blocking the class's only worker."""
+    sock = workload_server.wire(application_name="tiny")
+    other = workload_server.connect(application_name="tiny")
+    try:
+        sock.send([(b"Q", b"SELECT i, repeat('x', 200) FROM range(5000000) AS t(i)\0")])
+        time.sleep(0.5)  # the stream fills the socket and stalls
+
+        result = []
+        t = threading.Thread(target=lambda: result.append(other.cursor().execute("SELECT 7")), daemon=True)
+        t.start()
+        t.join(timeout=10)
+        assert not t.is_alive(), "query queued behind a stalled stream"
+    finally:
+        sock.close()
+        other.close()
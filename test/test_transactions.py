@@ -84,3 +84,44 @@ def test_set_unknown_guc_is_noop(cur):
     # Still be able to run queries afterwards.
     cur.execute("SELECT 1")
     assert cur.fetchone() == (1,)
+
+
+def test_ready_for_query_reports_transaction_state(postduck_server):
+    from psycopg2.extensions import (TRANSACTION_STATUS_IDLE,
+                                     TRANSACTION_STATUS_INERROR,
+                                     TRANSACTION_STATUS_INTRANS)
+
+    c = postduck_server.connect()
+    try:
+        c.autocommit = True
+        cur = c.cursor()
+        assert c.info.transaction_status == TRANSACTION_STATUS_IDLE
+        cur.execute("BEGIN")
+        assert c.info.transaction_status == TRANSACTION_STATUS_INTRANS
+        with pytest.raises(psycopg2.Error):
+            cur.execute("SELECT * FROM no_such_table_67890")
+        assert c.info.transaction_status == TRANSACTION_STATUS_INERROR
+        with pytest.raises(psycopg2.Error) as excinfo:
+            cur.execute("SELECT 1")
+        assert excinfo.value.pgcode == "25P02"
+        cur.execute("COMMIT")  # rolls the failed transaction back
+        assert cur.statusmessage == "ROLLBACK"
+        assert c.info.transaction_status == TRANSACTION_STATUS_IDLE
+        cur.execute("SELECT 1")
+        assert cur.fetchone() == (1,)
+    finally:
+        c.close()
+
+
+def test_redundant_transaction_control_warns(cur):
+    conn = cur.connection
+    cur.execute("COMMIT")
+    assert cur.statusmessage == "COMMIT"
+    cur.execute("BEGIN")
+    cur.execute("BEGIN")
+    assert cur.statusmessage == "BEGIN"
+    cur.execute("ROLLBACK")
+    cur.execute("ROLLBACK")
+    notices = "".join(conn.notices)
+    assert "there is no transaction in progress" in notices
+    assert "there is already a transaction in progress" in notices
@@ -119,3 +119,18 @@ def test_row_description_oids_are_postgres_compatible(cur):
     assert isinstance(row[1], float)
     assert isinstance(row[2], str)
     assert isinstance(row[3], datetime.date)
+
+
+def test_list_as_pg_array(cur):
+    """Lists of scalars are advertised with PG array OIDs and rendered as
+    array literals, so psycopg2 hands back Python lists."""
+    cur.execute("SELECT [1, 2, NULL]::INT[], ['a', 'b c', NULL, '']::VARCHAR[]")
+    ints, texts = cur.fetchone()
+    assert ints == [1, 2, None]
+    assert texts == ["a", "b c", None, ""]
+
+
+def test_blob_as_bytea(cur):
+    cur.execute("SELECT '\\x00\\xFFA'::BLOB")
+    (b,) = cur.fetchone()
+    assert bytes(b) == b"\x00\xffA"